@@ -0,0 +1,313 @@
+// Headless simulation benchmark over seeded scenarios, for tracking
+// regressions across commits:
+//  - cars:      1, 100, 1000 (one CarFleet driven by an MLP controller)
+//  - obstacles: 15, 500, 5000 (baked into the static tree)
+//  - rays:      10, 64 per car
+// Reports steps/s, ns per World::step, ns per b2World::Step with its
+// b2Profile breakdown, and ns per raycast, as JSON.
+// Usage: carphysics_bench [nbSteps] [output.json]
+// Without output file, the JSON goes to the standard output.
+
+#include <carfleet.hpp>
+#include <mlpcontroller.hpp>
+#include <rayfan.hpp>
+#include <world.hpp>
+
+#include <omp.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Scenario
+    {
+        uint32_t nbCars;
+        uint32_t nbObstacles;
+        uint32_t nbRays;
+        uint32_t seed;
+    };
+
+    struct Result
+    {
+        Scenario scenario;
+        uint32_t worldSize;
+        uint32_t nbSteps;
+        uint32_t placedCars;        // Fewer than asked if the world is crowded
+        uint32_t aliveAtEnd;
+        double stepsPerSec;
+        double nsPerStep;
+        double nsPerB2Step;
+        double nsPerRaycast;
+        b2Profile profile;          // Mean per step, in ns
+    };
+
+    double elapsedNs(std::chrono::steady_clock::time_point start)
+    {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    void accumulate(b2Profile & sum, b2Profile const & p)
+    {
+        sum.step += p.step;
+        sum.collide += p.collide;
+        sum.solve += p.solve;
+        sum.solveInit += p.solveInit;
+        sum.solveVelocity += p.solveVelocity;
+        sum.solvePosition += p.solvePosition;
+        sum.broadphase += p.broadphase;
+        sum.solveTOI += p.solveTOI;
+    }
+
+    // Same density of obstacles (or cars) in every scenario
+    uint32_t worldSize(Scenario const & s)
+    {
+        float32 n = static_cast<float32>(std::max(s.nbObstacles, s.nbCars));
+        return std::max(100u, static_cast<uint32_t>(40.0f * std::sqrt(n)));
+    }
+
+    // Spawn poses clear of the obstacles and of each other, fewer cars than
+    // asked if the world is too crowded
+    void placeCars(World const & w, Scenario const & s, uint32_t size, CarFleet & fleet)
+    {
+        float32 const margin = 4.0f;
+
+        CarDef def;
+        def.width = 2.0;
+        def.height = 3.0;
+        def.acceleration = 8.0;
+        for(auto i = 0u; i < s.nbRays; ++i)
+        {
+            def.raycastAngles.push_back(-b2_pi + 2.0f * b2_pi * i / s.nbRays);
+        }
+
+        b2AABB area;
+        area.lowerBound.Set(margin, margin);
+        area.upperBound.Set(size - margin, size - margin);
+
+        std::vector<CarDef> const poses = w.findSpawnPoses(def, area, s.nbCars, s.seed);
+        if(poses.size() < s.nbCars)
+        {
+            std::cerr << "only " << poses.size() << " free poses for " << s.nbCars << " cars" << std::endl;
+        }
+
+        for(auto const & pose: poses)
+        {
+            fleet.add(pose);
+        }
+    }
+
+    // Casts the sensors of every alive car, as CarFleet::sense does
+    double raycastNs(World const & w, CarFleet const & fleet, uint32_t nbRays)
+    {
+        uint32_t nbCasts = 0;
+        for(uint32_t i = 0; i < fleet.size(); ++i)
+        {
+            if(fleet.isAlive(i)) nbCasts += nbRays;
+        }
+        if(nbCasts == 0) return 0.0;
+
+        uint32_t const nbRepeats = std::max(1u, 200000u / nbCasts);
+
+        RayFan fan;
+        auto start = std::chrono::steady_clock::now();
+        for(uint32_t r = 0; r < nbRepeats; ++r)
+        {
+            for(uint32_t i = 0; i < fleet.size(); ++i)
+            {
+                if(!fleet.isAlive(i)) continue;
+
+                CarDef const & def = fleet.getDefinition(i);
+                b2Body const * body = fleet.getBody(i);
+
+                b2Vec2 point1 = body->GetWorldCenter();
+                fan.reset(point1, nbRays, body);
+                for(uint32_t k = 0; k < nbRays; ++k)
+                {
+                    float32 angle = def.raycastAngles[k] + body->GetAngle() + M_PI/2.0;
+                    b2Vec2 point2 = b2Vec2(std::cos(angle), std::sin(angle));
+                    point2 *= def.raycastDist;
+                    point2 += point1;
+                    fan.setEnd(k, point2);
+                }
+
+                w.rayCast(&fan);
+            }
+        }
+
+        return elapsedNs(start) / (static_cast<double>(nbRepeats) * nbCasts);
+    }
+
+    Result run(Scenario const & s, uint32_t nbSteps)
+    {
+        Result result;
+        result.scenario = s;
+        result.worldSize = worldSize(s);
+        result.nbSteps = nbSteps;
+
+        #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+        World w(8, 3, nullptr);
+        #else
+        World w(8, 3);
+        #endif
+
+        w.addBorders(result.worldSize, result.worldSize);
+        w.randomize(result.worldSize, result.worldSize, s.nbObstacles, s.seed);
+        w.bakeStaticGeometry();
+
+        std::mt19937 rng(s.seed);
+
+        MlpController controller({s.nbRays, 16});
+        std::uniform_real_distribution<float32> weightDistribution(-1.0f, 1.0f);
+        std::vector<float32> weights(controller.getWeightCount());
+        for(auto & weight: weights) weight = weightDistribution(rng);
+        controller.setWeights(weights);
+
+        std::shared_ptr<CarFleet> fleet = w.create<CarFleet>();
+        placeCars(w, s, result.worldSize, *fleet);
+        result.placedCars = fleet->size();
+        fleet->setController(&controller);
+        w.addFleet(fleet, false);
+
+        // Rays from the spawn poses, every car is alive
+        result.nsPerRaycast = raycastNs(w, *fleet, s.nbRays);
+
+        b2Profile sum = b2Profile();
+        auto start = std::chrono::steady_clock::now();
+        for(uint32_t i = 0; i < nbSteps; ++i)
+        {
+            w.step();
+            accumulate(sum, w.getProfile());
+        }
+        double totalNs = elapsedNs(start);
+
+        // Box2D reports milliseconds
+        float32 const toNs = 1.0e6f / nbSteps;
+        result.profile.step = sum.step * toNs;
+        result.profile.collide = sum.collide * toNs;
+        result.profile.solve = sum.solve * toNs;
+        result.profile.solveInit = sum.solveInit * toNs;
+        result.profile.solveVelocity = sum.solveVelocity * toNs;
+        result.profile.solvePosition = sum.solvePosition * toNs;
+        result.profile.broadphase = sum.broadphase * toNs;
+        result.profile.solveTOI = sum.solveTOI * toNs;
+
+        result.aliveAtEnd = fleet->getAliveCount();
+        result.nsPerStep = totalNs / nbSteps;
+        result.stepsPerSec = 1.0e9 / result.nsPerStep;
+        result.nsPerB2Step = result.profile.step;
+
+        return result;
+    }
+
+    void writeJson(std::ostream & out, std::vector<Result> const & results, uint32_t nbSteps)
+    {
+        out << "{\n";
+        out << "  \"benchmark\": \"carphysics_bench\",\n";
+        #if defined(NDEBUG)
+        out << "  \"assertions\": false,\n";
+        #else
+        out << "  \"assertions\": true,\n";
+        #endif
+        out << "  \"threads\": " << omp_get_max_threads() << ",\n";
+        out << "  \"steps\": " << nbSteps << ",\n";
+        out << "  \"scenarios\": [\n";
+
+        for(auto i = 0u; i < results.size(); ++i)
+        {
+            Result const & r = results[i];
+            Scenario const & s = r.scenario;
+
+            out << "    {\n";
+            out << "      \"name\": \"cars" << s.nbCars << "_obstacles" << s.nbObstacles
+                << "_rays" << s.nbRays << "\",\n";
+            out << "      \"cars\": " << s.nbCars << ",\n";
+            out << "      \"obstacles\": " << s.nbObstacles << ",\n";
+            out << "      \"rays\": " << s.nbRays << ",\n";
+            out << "      \"seed\": " << s.seed << ",\n";
+            out << "      \"world_size\": " << r.worldSize << ",\n";
+            out << "      \"placed_cars\": " << r.placedCars << ",\n";
+            out << "      \"alive_at_end\": " << r.aliveAtEnd << ",\n";
+            out << "      \"steps_per_sec\": " << r.stepsPerSec << ",\n";
+            out << "      \"ns_per_step\": " << r.nsPerStep << ",\n";
+            out << "      \"ns_per_b2_step\": " << r.nsPerB2Step << ",\n";
+            out << "      \"ns_per_raycast\": " << r.nsPerRaycast << ",\n";
+            out << "      \"b2_profile_ns\": {\n";
+            out << "        \"collide\": " << r.profile.collide << ",\n";
+            out << "        \"solve\": " << r.profile.solve << ",\n";
+            out << "        \"solve_init\": " << r.profile.solveInit << ",\n";
+            out << "        \"solve_velocity\": " << r.profile.solveVelocity << ",\n";
+            out << "        \"solve_position\": " << r.profile.solvePosition << ",\n";
+            out << "        \"solve_toi\": " << r.profile.solveTOI << ",\n";
+            out << "        \"broadphase\": " << r.profile.broadphase << "\n";
+            out << "      }\n";
+            out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+
+        out << "  ]\n";
+        out << "}\n";
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t nbSteps = argc > 1 ? std::atoi(argv[1]) : 100;
+    std::string outputPath = argc > 2 ? argv[2] : "";
+
+    if(nbSteps == 0)
+    {
+        std::cerr << "Usage: carphysics_bench [nbSteps] [output.json]" << std::endl;
+        return 1;
+    }
+
+    std::vector<Scenario> scenarios;
+    uint32_t seed = 1;
+    for(uint32_t nbCars: {1u, 100u, 1000u})
+    {
+        for(uint32_t nbObstacles: {15u, 500u, 5000u})
+        {
+            for(uint32_t nbRays: {10u, 64u})
+            {
+                Scenario s;
+                s.nbCars = nbCars;
+                s.nbObstacles = nbObstacles;
+                s.nbRays = nbRays;
+                s.seed = seed++;
+                scenarios.push_back(s);
+            }
+        }
+    }
+
+    std::vector<Result> results;
+    for(auto const & s: scenarios)
+    {
+        std::cerr << "cars: " << s.nbCars << ", obstacles: " << s.nbObstacles
+                  << ", rays: " << s.nbRays << std::endl;
+        results.push_back(run(s, nbSteps));
+    }
+
+    if(outputPath.empty())
+    {
+        writeJson(std::cout, results, nbSteps);
+        return 0;
+    }
+
+    std::ofstream file(outputPath);
+    if(!file)
+    {
+        std::cerr << "Cannot write " << outputPath << std::endl;
+        return 1;
+    }
+    writeJson(file, results, nbSteps);
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+// Scalar against wide (SIMD) contact solver.
+// Validation first: columns of boxes stacked on the ground, which have a
+// known rest state. Both solvers must bring them to rest, upright, at their
+// stacked height, with every box touching the one below and the penetration
+// within tolerance. The run fails otherwise.
+// Then timing, on a pile of boxes settling in a container under gravity:
+// one large island, most contacts resting. Cars die on their first contact,
+// so the car scenes have almost none. The pile is chaotic, its energies and
+// penetrations are reported but are not comparable from a solver to the
+// other.
+// Usage: carphysics_contact_solver_bench [nbBoxes] [nbSteps]
+
+#include <Box2D/Box2D.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+    float32 const TIME_STEP = 1.0f / 60.0f;
+    int32 const VELOCITY_ITERATIONS = 8;
+    int32 const POSITION_ITERATIONS = 3;
+
+    // Validation columns, spaced so that they never touch each other
+    uint32_t const NB_COLUMNS = 16;
+    uint32_t const COLUMN_HEIGHT = 10;
+    float32 const COLUMN_SPACING = 2.0f;
+    uint32_t const SETTLE_STEPS = 300;
+
+    // Validation tolerances, at the end of the run but the penetration
+    float32 const MAX_ENERGY = 1e-4f;           // Kinetic energy of all the boxes (J)
+    float32 const MAX_PENETRATION = 0.01f;      // Beyond the linear slop, over the whole run (m)
+    float32 const MAX_DRIFT = 0.01f;            // Horizontal, from the column axis (m)
+    float32 const MAX_TILT = 0.01f;             // (rad)
+    float32 const MAX_HEIGHT_ERROR = 0.02f;     // Top of each column (m)
+
+    // Box2D keeps the polygons apart by their skins, less the linear slop
+    float32 const REST_GAP = 2.0f * b2_polygonRadius - b2_linearSlop;
+
+    struct Result
+    {
+        double ms;
+        double solveVelocityMs;
+        float32 finalEnergy;
+        float32 meanEnergy;             // Over the last quarter of the run
+        float32 maxPenetration;         // Over the whole run
+        float32 finalPenetration;
+        float32 meanHeight;
+        uint32_t contacts;
+    };
+
+    float32 kineticEnergy(b2World const & world)
+    {
+        float32 energy = 0.0f;
+        for(b2Body const * b = world.GetBodyList(); b; b = b->GetNext())
+        {
+            if(b->GetType() != b2_dynamicBody) continue;
+
+            b2Vec2 const v = b->GetLinearVelocity();
+            float32 const w = b->GetAngularVelocity();
+            energy += 0.5f * b->GetMass() * b2Dot(v, v) + 0.5f * b->GetInertia() * w * w;
+        }
+        return energy;
+    }
+
+    // Deepest overlap of the touching contacts, beyond the linear slop
+    float32 penetration(b2World & world, uint32_t & contacts)
+    {
+        float32 deepest = 0.0f;
+        contacts = 0;
+        for(b2Contact * c = world.GetContactList(); c; c = c->GetNext())
+        {
+            if(!c->IsTouching()) continue;
+            ++contacts;
+
+            b2WorldManifold m;
+            c->GetWorldManifold(&m);
+            for(int32 i = 0; i < c->GetManifold()->pointCount; ++i)
+            {
+                deepest = std::max(deepest, -m.separations[i] - b2_linearSlop);
+            }
+        }
+        return deepest;
+    }
+
+    struct Validation
+    {
+        float32 energy;
+        float32 maxPenetration;
+        float32 drift;
+        float32 tilt;
+        float32 heightError;
+        uint32_t contacts;
+    };
+
+    // Unit boxes stacked in columns, at their rest height from the start
+    Validation runColumns(bool wide)
+    {
+        b2World world(b2Vec2(0.0f, -10.0f));
+        world.SetWideContactSolver(wide);
+        world.SetAllowSleeping(false);
+
+        b2BodyDef groundDef;
+        b2Body * ground = world.CreateBody(&groundDef);
+        b2EdgeShape edge;
+        edge.Set(b2Vec2(-COLUMN_SPACING, 0.0f), b2Vec2(NB_COLUMNS * COLUMN_SPACING, 0.0f));
+        ground->CreateFixture(&edge, 0.0f);
+
+        b2PolygonShape box;
+        box.SetAsBox(0.5f, 0.5f);
+
+        b2FixtureDef fixtureDef;
+        fixtureDef.shape = &box;
+        fixtureDef.density = 1.0f;
+        fixtureDef.friction = 0.6f;
+
+        for(uint32_t c = 0; c < NB_COLUMNS; ++c)
+        {
+            for(uint32_t r = 0; r < COLUMN_HEIGHT; ++r)
+            {
+                b2BodyDef def;
+                def.type = b2_dynamicBody;
+                def.position.Set(c * COLUMN_SPACING, 0.5f + r + (r + 1) * REST_GAP);
+                world.CreateBody(&def)->CreateFixture(&fixtureDef);
+            }
+        }
+
+        Validation v = Validation();
+        for(uint32_t s = 0; s < SETTLE_STEPS; ++s)
+        {
+            world.Step(TIME_STEP, VELOCITY_ITERATIONS, POSITION_ITERATIONS);
+            v.maxPenetration = std::max(v.maxPenetration, penetration(world, v.contacts));
+        }
+        v.energy = kineticEnergy(world);
+
+        // Bodies are listed from the last created one
+        uint32_t i = NB_COLUMNS * COLUMN_HEIGHT;
+        for(b2Body const * b = world.GetBodyList(); b; b = b->GetNext())
+        {
+            if(b->GetType() != b2_dynamicBody) continue;
+            --i;
+
+            uint32_t const c = i / COLUMN_HEIGHT;
+            uint32_t const r = i % COLUMN_HEIGHT;
+            v.drift = std::max(v.drift, std::abs(b->GetPosition().x - c * COLUMN_SPACING));
+            v.tilt = std::max(v.tilt, std::abs(b->GetAngle()));
+            if(r + 1 == COLUMN_HEIGHT)
+            {
+                float32 const restHeight = COLUMN_HEIGHT * (1.0f + REST_GAP);
+                v.heightError = std::max(v.heightError, std::abs(b->GetPosition().y + 0.5f - restHeight));
+            }
+        }
+
+        return v;
+    }
+
+    // Prints the validation of a solver, true if it passed
+    bool validate(char const * name, Validation const & v)
+    {
+        uint32_t const expectedContacts = NB_COLUMNS * COLUMN_HEIGHT;
+        bool const passed = v.energy <= MAX_ENERGY && v.maxPenetration <= MAX_PENETRATION
+                         && v.drift <= MAX_DRIFT && v.tilt <= MAX_TILT
+                         && v.heightError <= MAX_HEIGHT_ERROR && v.contacts == expectedContacts;
+
+        std::cout << "  " << name << ": energy " << v.energy << " (max " << MAX_ENERGY << ")"
+                  << ", penetration " << v.maxPenetration << " (max " << MAX_PENETRATION << ")"
+                  << ", drift " << v.drift << " (max " << MAX_DRIFT << ")"
+                  << ", tilt " << v.tilt << " (max " << MAX_TILT << ")"
+                  << ", height error " << v.heightError << " (max " << MAX_HEIGHT_ERROR << ")"
+                  << ", contacts " << v.contacts << " (expected " << expectedContacts << ")"
+                  << (passed ? ", passed" : ", FAILED") << std::endl;
+        return passed;
+    }
+
+    void buildPile(b2World & world, uint32_t nbBoxes)
+    {
+        uint32_t const columns = static_cast<uint32_t>(std::sqrt(static_cast<float32>(nbBoxes)));
+        float32 const width = 1.2f * columns + 2.0f;
+        float32 const height = 1.2f * (nbBoxes / columns + 1) + 10.0f;
+
+        b2BodyDef groundDef;
+        b2Body * ground = world.CreateBody(&groundDef);
+        b2EdgeShape edge;
+        edge.Set(b2Vec2(0.0f, 0.0f), b2Vec2(width, 0.0f));
+        ground->CreateFixture(&edge, 0.0f);
+        edge.Set(b2Vec2(0.0f, 0.0f), b2Vec2(0.0f, height));
+        ground->CreateFixture(&edge, 0.0f);
+        edge.Set(b2Vec2(width, 0.0f), b2Vec2(width, height));
+        ground->CreateFixture(&edge, 0.0f);
+
+        b2PolygonShape box;
+        box.SetAsBox(0.5f, 0.5f);
+
+        b2FixtureDef fixtureDef;
+        fixtureDef.shape = &box;
+        fixtureDef.density = 1.0f;
+        fixtureDef.friction = 0.6f;
+
+        for(uint32_t i = 0; i < nbBoxes; ++i)
+        {
+            b2BodyDef def;
+            def.type = b2_dynamicBody;
+            // Slightly staggered rows, so that the pile does not stay a grid
+            def.position.Set(1.5f + 1.2f * (i % columns) + 0.1f * ((i / columns) % 2), 1.0f + 1.2f * (i / columns));
+            world.CreateBody(&def)->CreateFixture(&fixtureDef);
+        }
+    }
+
+    Result runPile(bool wide, uint32_t nbBoxes, uint32_t nbSteps)
+    {
+        b2World world(b2Vec2(0.0f, -10.0f));
+        world.SetWideContactSolver(wide);
+        world.SetAllowSleeping(false);
+        buildPile(world, nbBoxes);
+
+        Result r = Result();
+        uint32_t const tail = std::max(1u, nbSteps / 4);
+
+        auto start = std::chrono::steady_clock::now();
+        for(uint32_t s = 0; s < nbSteps; ++s)
+        {
+            world.Step(TIME_STEP, VELOCITY_ITERATIONS, POSITION_ITERATIONS);
+            r.solveVelocityMs += world.GetProfile().solveVelocity;
+
+            r.finalEnergy = kineticEnergy(world);
+            r.finalPenetration = penetration(world, r.contacts);
+            r.maxPenetration = std::max(r.maxPenetration, r.finalPenetration);
+            if(s >= nbSteps - tail) r.meanEnergy += r.finalEnergy / tail;
+        }
+        r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        for(b2Body const * b = world.GetBodyList(); b; b = b->GetNext())
+        {
+            if(b->GetType() == b2_dynamicBody) r.meanHeight += b->GetPosition().y / nbBoxes;
+        }
+
+        return r;
+    }
+
+    void print(char const * name, Result const & r)
+    {
+        std::cout << "  " << name << ": " << r.ms << " ms, solve velocity " << r.solveVelocityMs << " ms"
+                  << ", energy " << r.finalEnergy << " (mean " << r.meanEnergy << ")"
+                  << ", penetration " << r.finalPenetration << " (max " << r.maxPenetration << ")"
+                  << ", mean height " << r.meanHeight << ", contacts " << r.contacts << std::endl;
+    }
+
+    void compare(Result const & scalar, Result const & wide)
+    {
+        std::cout << "  velocity solve speedup: " << scalar.solveVelocityMs / wide.solveVelocityMs << std::endl;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t nbBoxes = argc > 1 ? std::atoi(argv[1]) : 1000;
+    uint32_t nbSteps = argc > 2 ? std::atoi(argv[2]) : 600;
+
+    if(nbBoxes == 0 || nbSteps == 0)
+    {
+        std::cerr << "Usage: carphysics_contact_solver_bench [nbBoxes] [nbSteps]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "validation: " << NB_COLUMNS << " columns of " << COLUMN_HEIGHT << " boxes, "
+              << SETTLE_STEPS << " steps" << std::endl;
+    bool const scalarPassed = validate("scalar", runColumns(false));
+    bool const widePassed = validate("wide", runColumns(true));
+
+    std::cout << "pile of " << nbBoxes << " boxes, " << nbSteps << " steps" << std::endl;
+    Result scalar = runPile(false, nbBoxes, nbSteps);
+    Result wide = runPile(true, nbBoxes, nbSteps);
+    print("scalar", scalar);
+    print("wide", wide);
+    compare(scalar, wide);
+
+    return scalarPassed && widePassed ? 0 : 1;
+}
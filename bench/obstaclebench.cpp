@@ -0,0 +1,190 @@
+// Random tracks of many obstacles: times ObstacleGenerator with each of its
+// rejection rules, then World::randomize with the boxes added one by one
+// and with the boxes baked into the static tree at once, deactivated (see
+// World::bakeStaticGeometry).
+// The rules are checked by brute force on a smaller track.
+// Usage: carphysics_obstacle_bench [nbObstacles] [areaPerObstacle]
+
+#include <obstaclegenerator.hpp>
+#include <world.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+    float32 const MIN_GAP = 3.0;
+    float32 const GRID_CELL_SIZE = 4.0;
+    uint32_t const NB_KEEP_OUT = 100;
+    uint32_t const CHECK_COUNT = 1000;
+
+    ObstacleDef makeDef(uint32_t nbObstacles, float32 areaPerObstacle)
+    {
+        uint32_t const side = static_cast<uint32_t>(std::sqrt(nbObstacles * areaPerObstacle));
+
+        ObstacleDef def;
+        def.width = side;
+        def.height = side;
+        def.count = nbObstacles;
+        def.seed = 1;
+        return def;
+    }
+
+    void addKeepOut(ObstacleDef & def)
+    {
+        for(uint32_t i = 0; i < NB_KEEP_OUT; ++i)
+        {
+            def.keepOut.push_back(b2Vec2(def.width * ((i % 10) + 0.5f) / 10.0f, def.height * ((i / 10) + 0.5f) / 10.0f));
+        }
+    }
+
+    void printRejections(ObstacleGenerator::Rejections const & r)
+    {
+        std::cout << "rejected: gap " << r.gap << ", keep out " << r.keepOut
+                  << ", reachability " << r.reachability << ", dropped " << r.dropped << std::endl;
+    }
+
+    void timeGenerator(char const * name, ObstacleDef const & def)
+    {
+        ObstacleGenerator generator(def);
+
+        auto start = std::chrono::steady_clock::now();
+        generator.generate();
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << "  " << name << ": "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << " ms, "
+                  << generator.getObstacles().size() << " boxes, ";
+        printRejections(generator.getRejections());
+    }
+
+    void timeWorld(char const * name, ObstacleDef const & def)
+    {
+        #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+        World w(8, 3, nullptr);
+        #else
+        World w(8, 3);
+        #endif
+
+        // Baked boxes only skip the broad-phase when deactivated
+        if(def.bake) w.bakeStaticGeometry(true);
+
+        auto start = std::chrono::steady_clock::now();
+        w.randomize(def);
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << "  " << name << ": "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << " ms, "
+                  << w.getStaticTree().getNodeCount() << " static tree nodes" << std::endl;
+    }
+
+    b2PolygonShape makeShape(ObstacleGenerator::Obstacle const & o, b2Transform & xf)
+    {
+        b2PolygonShape shape;
+        shape.SetAsBox(o.width / 2.0f, o.height / 2.0f);
+        xf.Set(o.position, o.angle);
+        return shape;
+    }
+
+    // Returns the number of broken rules, over all pairs of boxes
+    uint32_t check(ObstacleDef const & def)
+    {
+        ObstacleGenerator generator(def);
+        std::vector<ObstacleGenerator::Obstacle> const & obstacles = generator.generate();
+
+        uint32_t nbErrors = 0;
+        b2SimplexCache cache;
+        for(std::size_t i = 0; i < obstacles.size(); ++i)
+        {
+            b2Transform xfA;
+            b2PolygonShape const shapeA = makeShape(obstacles[i], xfA);
+
+            b2DistanceProxy proxyA;
+            proxyA.Set(&shapeA, 0);
+            for(auto const & p: def.keepOut)
+            {
+                b2CircleShape point;
+                point.m_p = p;
+
+                b2DistanceProxy proxyB;
+                proxyB.Set(&point, 0);
+
+                b2DistanceInput input;
+                input.proxyA = proxyA;
+                input.proxyB = proxyB;
+                input.transformA = xfA;
+                input.transformB.SetIdentity();
+                input.useRadii = false;
+
+                b2DistanceOutput output;
+                cache.count = 0;
+                b2Distance(&output, &cache, &input);
+                nbErrors += output.distance < def.keepOutRadius ? 1 : 0;
+            }
+
+            for(std::size_t j = i + 1; j < obstacles.size(); ++j)
+            {
+                b2Transform xfB;
+                b2PolygonShape const shapeB = makeShape(obstacles[j], xfB);
+
+                b2DistanceProxy proxyB;
+                proxyB.Set(&shapeB, 0);
+
+                b2DistanceInput input;
+                input.proxyA = proxyA;
+                input.proxyB = proxyB;
+                input.transformA = xfA;
+                input.transformB = xfB;
+                input.useRadii = false;
+
+                b2DistanceOutput output;
+                cache.count = 0;
+                b2Distance(&output, &cache, &input);
+                nbErrors += output.distance <= def.minGap ? 1 : 0;
+            }
+        }
+
+        return nbErrors;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t nbObstacles    = argc > 1 ? std::atoi(argv[1]) : 100000;
+    float32 areaPerObstacle = argc > 2 ? std::atof(argv[2]) : 1000.0f;
+
+    if(nbObstacles == 0 || areaPerObstacle <= 0.0f)
+    {
+        std::cerr << "Usage: carphysics_obstacle_bench [nbObstacles] [areaPerObstacle]" << std::endl;
+        return 1;
+    }
+
+    ObstacleDef def = makeDef(nbObstacles, areaPerObstacle);
+    std::cout << "obstacles: " << nbObstacles << ", track: " << def.width << "x" << def.height << std::endl;
+
+    std::cout << "generator" << std::endl;
+    timeGenerator("no rule", def);
+    def.minGap = MIN_GAP;
+    timeGenerator("gap", def);
+    addKeepOut(def);
+    timeGenerator("gap, keep out", def);
+    def.gridCellSize = GRID_CELL_SIZE;
+    timeGenerator("gap, keep out, reachability", def);
+
+    std::cout << "world, every rule" << std::endl;
+    timeWorld("added", def);
+    def.bake = true;
+    timeWorld("baked", def);
+
+    ObstacleDef checkDef = makeDef(CHECK_COUNT, areaPerObstacle);
+    checkDef.minGap = MIN_GAP;
+    addKeepOut(checkDef);
+    checkDef.gridCellSize = GRID_CELL_SIZE;
+    uint32_t const nbErrors = check(checkDef);
+    std::cout << "check on " << CHECK_COUNT << " obstacles: " << nbErrors << " broken rules" << std::endl;
+
+    return nbErrors == 0 ? 0 : 1;
+}
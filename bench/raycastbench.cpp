@@ -0,0 +1,395 @@
+// Compares the sensor ray paths:
+//  - list walk: per-ray RaycastCallback walking the owner fixture and joint lists
+//  - owner id:  per-ray RaycastCallback comparing the fixture user data
+//  - self filter alone: both callbacks above on the fixtures the rays
+//    report, without the b2World::RayCast around them
+//  - bundled:   RayFan, all the rays of a car with a single tree walk
+//  - baked:     RayFan once the obstacles are baked into the static tree
+//  - field:     RayFan sphere tracing the distance field, exact tree windows
+// All hits must match the list walk (b2World::RayCast) exactly. Cars are
+// placed on free poses (World::findSpawnPoses), fewer of them on crowded tracks.
+// Usage: carphysics_raycast_bench [nbCars] [nbObstacles] [nbRays] [nbRepeats] [cellSize]
+// Without nbRays (or with 0), runs 10, 32 and 64 rays per car.
+
+#include <car.hpp>
+#include <rayfan.hpp>
+#include <raycastcallback.hpp>
+#include <world.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    class BenchCar : public Car
+    {
+    public:
+        explicit BenchCar(CarDef const & def) : Car(def) {}
+
+        b2Body const * body() const { return m_body; }
+    };
+
+    // Self filtering as it was done before owner ids
+    class ListWalkCallback : public b2RayCastCallback
+    {
+    public:
+        explicit ListWalkCallback(b2Body const * owner)
+            : owner(owner)
+            , fixture(nullptr)
+            , fraction(1.0f)
+        {
+
+        }
+
+        float32 ReportFixture(b2Fixture * f, b2Vec2 const &, b2Vec2 const &, float32 fr) override
+        {
+            for(b2Fixture const * o = owner->GetFixtureList(); o; o = o->GetNext())
+            {
+                if(o == f) return -1;
+            }
+
+            for(b2JointEdge const * j = owner->GetJointList(); j; j = j->next)
+            {
+                for(b2Fixture const * o = j->joint->GetBodyB()->GetFixtureList(); o; o = o->GetNext())
+                {
+                    if(o == f) return -1;
+                }
+            }
+
+            fixture = f;
+            fraction = fr;
+            return fr;
+        }
+
+        b2Body const * owner;
+        b2Fixture * fixture;
+        float32 fraction;
+    };
+
+    // Every fixture b2World::RayCast reports along a ray, without clipping it
+    class ReportCollector : public b2RayCastCallback
+    {
+    public:
+        explicit ReportCollector(std::vector<b2Fixture *> & fixtures)
+            : fixtures(fixtures)
+        {
+
+        }
+
+        float32 ReportFixture(b2Fixture * f, b2Vec2 const &, b2Vec2 const &, float32) override
+        {
+            fixtures.push_back(f);
+            return 1.0f;
+        }
+
+        std::vector<b2Fixture *> & fixtures;
+    };
+
+    // Self filter alone: a callback on the fixtures reported to each car,
+    // outside of the tree walk. Returns ns per report, and the number of
+    // self hits filtered out.
+    template <typename Callback, typename Owner>
+    double timeFilter(std::vector<std::vector<b2Fixture *>> const & reports, std::vector<Owner> const & owners,
+                      uint32_t nbRepeats, std::size_t & nbSelf)
+    {
+        b2Vec2 const point(0.0f, 0.0f);
+        std::size_t nbReports = 0;
+        nbSelf = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(auto r = 0u; r < nbRepeats; ++r)
+        {
+            for(auto c = 0u; c < reports.size(); ++c)
+            {
+                Callback callback(owners[c]);
+                for(b2Fixture * f: reports[c])
+                {
+                    nbSelf += callback.ReportFixture(f, point, point, 0.5f) < 0.0f ? 1 : 0;
+                }
+                nbReports += reports[c].size();
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count() / std::max<std::size_t>(nbReports, 1);
+    }
+
+    void rayEnds(BenchCar const & car, std::vector<b2Vec2> & ends)
+    {
+        CarDef const & def = car.getDefiniton();
+        b2Vec2 point1 = car.body()->GetWorldCenter();
+
+        ends.resize(def.raycastAngles.size());
+        for(auto i = 0u; i < def.raycastAngles.size(); ++i)
+        {
+            float32 angle = def.raycastAngles[i] + car.body()->GetAngle() + M_PI/2.0;
+            b2Vec2 point2 = b2Vec2(std::cos(angle), std::sin(angle));
+            point2 *= def.raycastDist;
+            point2 += point1;
+            ends[i] = point2;
+        }
+    }
+
+    double elapsedNs(std::chrono::steady_clock::time_point start)
+    {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    uint32_t countMismatches(std::vector<float32> const & a, std::vector<float32> const & b)
+    {
+        uint32_t mismatches = 0;
+        for(auto i = 0u; i < a.size(); ++i)
+        {
+            if(a[i] < b[i] || a[i] > b[i]) ++mismatches;
+        }
+        return mismatches;
+    }
+
+    // Casts every sensor fan nbRepeats times, returns the time taken
+    double castFans(World const & w, std::vector<std::shared_ptr<BenchCar>> const & cars, uint32_t nbRays, uint32_t nbRepeats, std::vector<float32> & fractions)
+    {
+        RayFan fan;
+        std::vector<b2Vec2> ends;
+        fractions.resize(cars.size() * nbRays);
+
+        auto start = std::chrono::steady_clock::now();
+        for(auto r = 0u; r < nbRepeats; ++r)
+        {
+            for(auto c = 0u; c < cars.size(); ++c)
+            {
+                rayEnds(*cars[c], ends);
+                fan.reset(cars[c]->body()->GetWorldCenter(), nbRays, cars[c]->getOwner());
+                for(auto i = 0u; i < nbRays; ++i)
+                {
+                    fan.setEnd(i, ends[i]);
+                }
+                w.rayCast(&fan);
+                for(auto i = 0u; i < nbRays; ++i)
+                {
+                    fractions[c * nbRays + i] = fan.getFraction(i);
+                }
+            }
+        }
+        return elapsedNs(start);
+    }
+
+    uint32_t run(uint32_t nbCars, uint32_t nbObstacles, uint32_t nbRays, uint32_t nbRepeats, float32 cellSize)
+    {
+        uint32_t const width = 400;
+        uint32_t const height = 400;
+
+        #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+        World w(8, 3, nullptr);
+        #else
+        World w(8, 3);
+        #endif
+
+        w.addBorders(width, height);
+        w.randomize(width, height, nbObstacles, 42);
+
+        CarDef def;
+        def.width = 2.0;
+        def.height = 3.0;
+        def.acceleration = 8.0;
+        for(auto i = 0u; i < nbRays; ++i)
+        {
+            def.raycastAngles.push_back(-b2_pi + 2.0f * b2_pi * i / nbRays);
+        }
+
+        // Cars on free poses only: rays starting inside an obstacle are
+        // not what a running car casts
+        b2AABB area;
+        area.lowerBound.Set(5.0f, 5.0f);
+        area.upperBound.Set(width - 5.0f, height - 5.0f);
+        std::vector<CarDef> const poses = w.findSpawnPoses(def, area, nbCars, 7);
+        if(poses.size() < nbCars)
+        {
+            std::cout << "only " << poses.size() << " free poses for " << nbCars << " cars" << std::endl;
+            nbCars = static_cast<uint32_t>(poses.size());
+        }
+
+        std::vector<std::shared_ptr<BenchCar>> cars;
+        for(auto const & pose: poses)
+        {
+            cars.push_back(w.create<BenchCar>(pose));
+            w.addDrawable(cars.back());
+        }
+
+        std::vector<b2Vec2> ends;
+        std::vector<float32> listWalk(nbCars * nbRays);
+        std::vector<float32> ownerId(nbCars * nbRays);
+        std::vector<float32> bundled(nbCars * nbRays);
+
+        // Per-ray path, fixture and joint list walk
+        auto start = std::chrono::steady_clock::now();
+        for(auto r = 0u; r < nbRepeats; ++r)
+        {
+            for(auto c = 0u; c < nbCars; ++c)
+            {
+                rayEnds(*cars[c], ends);
+                b2Vec2 point1 = cars[c]->body()->GetWorldCenter();
+                for(auto i = 0u; i < nbRays; ++i)
+                {
+                    ListWalkCallback callback(cars[c]->body());
+                    w.rayCast(&callback, point1, ends[i]);
+                    listWalk[c * nbRays + i] = callback.fraction;
+                }
+            }
+        }
+        double listWalkNs = elapsedNs(start);
+
+        // Per-ray path, owner id
+        start = std::chrono::steady_clock::now();
+        for(auto r = 0u; r < nbRepeats; ++r)
+        {
+            for(auto c = 0u; c < nbCars; ++c)
+            {
+                rayEnds(*cars[c], ends);
+                b2Vec2 point1 = cars[c]->body()->GetWorldCenter();
+                for(auto i = 0u; i < nbRays; ++i)
+                {
+                    RaycastCallback callback(cars[c]->getOwner());
+                    w.rayCast(&callback, point1, ends[i]);
+                    ownerId[c * nbRays + i] = callback.fixture ? callback.fraction : 1.0f;
+                }
+            }
+        }
+        double ownerIdNs = elapsedNs(start);
+
+        // Self filters alone, on what the rays of each car report
+        std::vector<std::vector<b2Fixture *>> reports(nbCars);
+        std::vector<b2Body const *> bodies;
+        std::vector<void const *> owners;
+        for(auto c = 0u; c < nbCars; ++c)
+        {
+            rayEnds(*cars[c], ends);
+            ReportCollector collector(reports[c]);
+            for(auto i = 0u; i < nbRays; ++i)
+            {
+                w.rayCast(&collector, cars[c]->body()->GetWorldCenter(), ends[i]);
+            }
+            bodies.push_back(cars[c]->body());
+            owners.push_back(cars[c]->getOwner());
+        }
+        std::size_t nbListWalkSelf = 0;
+        std::size_t nbOwnerIdSelf = 0;
+        double const listWalkFilterNs = timeFilter<ListWalkCallback>(reports, bodies, 10 * nbRepeats, nbListWalkSelf);
+        double const ownerIdFilterNs = timeFilter<RaycastCallback>(reports, owners, 10 * nbRepeats, nbOwnerIdSelf);
+
+        // Bundled path
+        RayFan fan;
+        start = std::chrono::steady_clock::now();
+        for(auto r = 0u; r < nbRepeats; ++r)
+        {
+            for(auto c = 0u; c < nbCars; ++c)
+            {
+                rayEnds(*cars[c], ends);
+                fan.reset(cars[c]->body()->GetWorldCenter(), nbRays, cars[c]->getOwner());
+                for(auto i = 0u; i < nbRays; ++i)
+                {
+                    fan.setEnd(i, ends[i]);
+                }
+                w.rayCast(&fan);
+                for(auto i = 0u; i < nbRays; ++i)
+                {
+                    bundled[c * nbRays + i] = fan.getFraction(i);
+                }
+            }
+        }
+        double bundledNs = elapsedNs(start);
+
+        // Bundled path, obstacles and borders in the static tree
+        w.bakeStaticGeometry(true);
+        std::vector<float32> baked(nbCars * nbRays);
+        start = std::chrono::steady_clock::now();
+        for(auto r = 0u; r < nbRepeats; ++r)
+        {
+            for(auto c = 0u; c < nbCars; ++c)
+            {
+                rayEnds(*cars[c], ends);
+                fan.reset(cars[c]->body()->GetWorldCenter(), nbRays, cars[c]->getOwner());
+                for(auto i = 0u; i < nbRays; ++i)
+                {
+                    fan.setEnd(i, ends[i]);
+                }
+                w.rayCast(&fan);
+                for(auto i = 0u; i < nbRays; ++i)
+                {
+                    baked[c * nbRays + i] = fan.getFraction(i);
+                }
+            }
+        }
+        double bakedNs = elapsedNs(start);
+
+        // Sphere traced, exact windows
+        start = std::chrono::steady_clock::now();
+        w.bakeDistanceField(cellSize);
+        double fieldBuildMs = elapsedNs(start) / 1e6;
+
+        std::vector<float32> field;
+        double fieldNs = castFans(w, cars, nbRays, nbRepeats, field);
+
+        uint32_t mismatches = countMismatches(listWalk, ownerId) + countMismatches(listWalk, bundled)
+            + countMismatches(listWalk, baked) + countMismatches(listWalk, field)
+            + (nbListWalkSelf == nbOwnerIdSelf ? 0 : 1);
+
+        double nbCasts = static_cast<double>(nbRepeats) * nbCars * nbRays;
+
+        std::cout << "cars: " << nbCars << ", obstacles: " << nbObstacles << ", rays: " << nbRays << std::endl;
+        std::cout << "  list walk: " << listWalkNs / nbCasts << " ns/ray" << std::endl;
+        std::cout << "  owner id:  " << ownerIdNs / nbCasts << " ns/ray" << std::endl;
+        std::cout << "  self filter alone: list walk " << listWalkFilterNs << " ns/report, owner id "
+                  << ownerIdFilterNs << " ns/report, " << nbOwnerIdSelf / (10 * nbRepeats) << " self hits" << std::endl;
+        std::cout << "  bundled:   " << bundledNs / nbCasts << " ns/ray" << std::endl;
+        std::cout << "  baked:     " << bakedNs / nbCasts << " ns/ray" << std::endl;
+        std::cout << "  field:     " << fieldNs / nbCasts << " ns/ray" << std::endl;
+        std::cout << "  field of " << w.getDistanceField().getWidth() << "x" << w.getDistanceField().getHeight()
+                  << " samples, " << w.getDistanceField().getMemorySize() / 1024 << " KiB, built in " << fieldBuildMs << " ms" << std::endl;
+        std::cout << "  mismatches: " << mismatches << " / " << 4 * listWalk.size() << std::endl;
+
+        return mismatches;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t nbCars      = argc > 1 ? std::atoi(argv[1]) : 100;
+    uint32_t nbObstacles = argc > 2 ? std::atoi(argv[2]) : 500;
+    uint32_t nbRays      = argc > 3 ? std::atoi(argv[3]) : 0;
+    uint32_t nbRepeats   = argc > 4 ? std::atoi(argv[4]) : 20;
+    float32 cellSize     = argc > 5 ? std::atof(argv[5]) : 0.5f;
+
+    if(nbRays > RayFan::MAX_RAYS)
+    {
+        std::cerr << "At most " << RayFan::MAX_RAYS << " rays per car" << std::endl;
+        return 1;
+    }
+
+    if(cellSize <= 0.0f)
+    {
+        std::cerr << "The cell size must be positive" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> rayCounts;
+    if(nbRays > 0)
+    {
+        rayCounts.push_back(nbRays);
+    }
+    else
+    {
+        rayCounts = {10, 32, 64};
+    }
+
+    uint32_t mismatches = 0;
+    for(auto n: rayCounts)
+    {
+        mismatches += run(nbCars, nbObstacles, n, nbRepeats, cellSize);
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,167 @@
+// Sensor lookup table of a random track: times the bake, the save and the
+// cached open (mapped), then the exact fans of random poses against the
+// table ones, and reports the interpolation errors.
+// The mapped table must give the same fractions as the baked one.
+// Usage: carphysics_sensor_table_bench [nbObstacles] [cellSize] [nbHeadings] [bits] [cacheDirectory]
+
+#include <rayfan.hpp>
+#include <sensortable.hpp>
+#include <world.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    uint32_t const TRACK_SIZE = 100;
+    uint32_t const NB_RAYS = 16;
+    uint32_t const NB_POSES = 100000;
+    uint32_t const NB_ERROR_POSES = 20000;
+    float32 const RAYCAST_DIST = 50.0f;
+
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    // Casts a fan per pose, through the table if the world has one
+    double castPoses(World const & w, SensorTableDef const & def, std::vector<b2Vec3> const & poses, std::vector<float32> & fractions)
+    {
+        RayFan fan;
+        fractions.resize(poses.size() * NB_RAYS);
+
+        auto start = std::chrono::steady_clock::now();
+        for(auto p = 0u; p < poses.size(); ++p)
+        {
+            b2Vec2 const point1(poses[p].x, poses[p].y);
+            fan.reset(point1, NB_RAYS, nullptr);
+            for(auto i = 0u; i < NB_RAYS; ++i)
+            {
+                float32 angle = def.raycastAngles[i] + poses[p].z + M_PI/2.0;
+                b2Vec2 point2 = b2Vec2(std::cos(angle), std::sin(angle));
+                point2 *= def.raycastDist;
+                point2 += point1;
+                fan.setEnd(i, point2);
+            }
+
+            w.rayCast(&fan, poses[p].z);
+            for(auto i = 0u; i < NB_RAYS; ++i)
+            {
+                fractions[p * NB_RAYS + i] = fan.getFraction(i);
+            }
+        }
+        return elapsedMs(start);
+    }
+
+    uint32_t countMismatches(SensorTable const & a, SensorTable const & b, std::vector<b2Vec3> const & poses)
+    {
+        uint32_t mismatches = 0;
+        float32 fa[NB_RAYS];
+        float32 fb[NB_RAYS];
+        for(auto const & pose: poses)
+        {
+            a.lookUp(b2Vec2(pose.x, pose.y), pose.z, fa);
+            b.lookUp(b2Vec2(pose.x, pose.y), pose.z, fb);
+            for(auto i = 0u; i < NB_RAYS; ++i)
+            {
+                if(fa[i] < fb[i] || fa[i] > fb[i]) ++mismatches;
+            }
+        }
+        return mismatches;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t nbObstacles   = argc > 1 ? std::atoi(argv[1]) : 50;
+    float32 cellSize       = argc > 2 ? std::atof(argv[2]) : 1.0f;
+    uint32_t nbHeadings    = argc > 3 ? std::atoi(argv[3]) : 32;
+    uint32_t bits          = argc > 4 ? std::atoi(argv[4]) : 16;
+    std::string directory  = argc > 5 ? argv[5] : ".";
+
+    if(cellSize <= 0.0f || nbHeadings == 0 || (bits != 8 && bits != 16))
+    {
+        std::cerr << "Usage: carphysics_sensor_table_bench [nbObstacles] [cellSize] [nbHeadings] [bits] [cacheDirectory]" << std::endl;
+        return 1;
+    }
+
+    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+    World w(8, 3, nullptr);
+    #else
+    World w(8, 3);
+    #endif
+
+    w.addBorders(TRACK_SIZE, TRACK_SIZE);
+    w.randomize(TRACK_SIZE, TRACK_SIZE, nbObstacles, 42);
+    w.bakeStaticGeometry(true);
+
+    SensorTableDef def;
+    def.area.lowerBound.Set(0.0f, 0.0f);
+    def.area.upperBound.Set(TRACK_SIZE, TRACK_SIZE);
+    def.cellSize = cellSize;
+    def.nbHeadings = nbHeadings;
+    def.bits = bits;
+    def.seed = 42;
+    def.raycastDist = RAYCAST_DIST;
+    for(auto i = 0u; i < NB_RAYS; ++i)
+    {
+        def.raycastAngles.push_back(-b2_pi + 2.0f * b2_pi * i / NB_RAYS);
+    }
+
+    std::cout << "obstacles: " << nbObstacles << ", cell: " << cellSize << ", headings: " << nbHeadings
+              << ", bits: " << bits << ", rays: " << NB_RAYS << std::endl;
+
+    StaticTree const & tree = w.getStaticTree();
+    std::string const path = directory + "/" + SensorTable::getCacheName(def);
+
+    auto start = std::chrono::steady_clock::now();
+    SensorTable baked;
+    baked.build(tree, def);
+    std::cout << "  bake: " << elapsedMs(start) << " ms, "
+              << baked.getMemorySize() / (1024.0 * 1024.0) << " MiB" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    bool const saved = baked.save(path);
+    std::cout << "  save: " << elapsedMs(start) << " ms, " << (saved ? path : "failed") << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    std::shared_ptr<SensorTable> cached = std::make_shared<SensorTable>();
+    bool const loaded = cached->open(directory, tree, def);
+    std::cout << "  open: " << elapsedMs(start) << " ms, " << (loaded ? "loaded" : "built")
+              << (cached->isMapped() ? ", mapped" : "") << std::endl;
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float32> posDistribution(0.0f, TRACK_SIZE);
+    std::uniform_real_distribution<float32> angleDistribution(-b2_pi, b2_pi);
+    std::vector<b2Vec3> poses(NB_POSES);
+    for(auto & pose: poses)
+    {
+        pose.Set(posDistribution(rng), posDistribution(rng), angleDistribution(rng));
+    }
+
+    std::vector<float32> exact;
+    std::vector<float32> table;
+    double const exactMs = castPoses(w, def, poses, exact);
+    w.setSensorTable(cached);
+    double const tableMs = castPoses(w, def, poses, table);
+
+    double const nbRays = static_cast<double>(NB_POSES) * NB_RAYS;
+    std::cout << "  cast: " << exactMs * 1e6 / nbRays << " ns/ray" << std::endl;
+    std::cout << "  table: " << tableMs * 1e6 / nbRays << " ns/ray" << std::endl;
+
+    SensorTable::Errors const errors = cached->measure(tree, NB_ERROR_POSES, 3);
+    std::cout << "  errors over " << errors.nbRays << " rays: mean " << errors.mean << ", median " << errors.median
+              << ", p99 " << errors.p99 << ", max " << errors.max << ", over a cell " << 100.0f * errors.overCell << "%" << std::endl;
+
+    uint32_t const mismatches = countMismatches(baked, *cached, poses);
+    std::cout << "mismatches (mapped vs baked): " << mismatches << std::endl;
+
+    return saved && loaded && mismatches == 0 ? 0 : 1;
+}
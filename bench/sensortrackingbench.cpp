@@ -0,0 +1,217 @@
+// Sensor fans of cars driving random arcs over a baked track, from free
+// poses (World::findSpawnPoses) and never into an obstacle, step after step,
+// cast in two ways:
+//  - exact:  World::rayCast, from scratch every step
+//  - hinted: sensor tracking, last static fixture of each ray first
+// Hinted fractions must match the exact ones, else the bench fails. The
+// hint hit rate comes from the trackers, whatever CAR_PHYSICS_STATS.
+// Usage: carphysics_sensor_tracking_bench [nbCars] [nbObstacles] [nbSteps]
+
+#include <car.hpp>
+#include <rayfan.hpp>
+#include <sensortracker.hpp>
+#include <world.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+    uint32_t const TRACK_SIZE = 200;
+    uint32_t const NB_RAYS = 16;
+    float32 const RAYCAST_DIST = 50.0f;
+    float32 const TIME_STEP = 0.01f;
+    float32 const MARGIN = 10.0f;
+
+    struct Pose
+    {
+        b2Vec2 position;
+        float32 angle;
+    };
+
+    // Poses of every car at every step, step major. Cars start on free
+    // poses, fewer of them on crowded tracks, and a car whose next pose
+    // would overlap an obstacle or leave the track backs up along its arc
+    // instead, or stays in place.
+    std::vector<Pose> drive(World const & w, uint32_t & nbCars, uint32_t nbSteps)
+    {
+        CarDef def;
+        def.width = 2.0;
+        def.height = 3.0;
+
+        b2AABB area;
+        area.lowerBound.Set(MARGIN, MARGIN);
+        area.upperBound.Set(TRACK_SIZE - MARGIN, TRACK_SIZE - MARGIN);
+        std::vector<CarDef> const starts = w.findSpawnPoses(def, area, nbCars, 7);
+        if(starts.size() < nbCars)
+        {
+            std::cout << "only " << starts.size() << " free poses for " << nbCars << " cars" << std::endl;
+            nbCars = static_cast<uint32_t>(starts.size());
+        }
+
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float32> speedDistribution(0.0f, 15.0f);
+        std::uniform_real_distribution<float32> yawDistribution(-0.3f, 0.3f);
+
+        std::vector<CarDef> cars(starts);
+        std::vector<float32> speeds(nbCars);
+        std::vector<float32> yawRates(nbCars);
+        for(auto c = 0u; c < nbCars; ++c)
+        {
+            speeds[c] = speedDistribution(rng);
+            yawRates[c] = yawDistribution(rng);
+        }
+
+        std::vector<Pose> poses;
+        for(auto s = 0u; s < nbSteps; ++s)
+        {
+            for(auto c = 0u; c < nbCars; ++c)
+            {
+                CarDef next = cars[c];
+                for(auto attempt = 0u; attempt < 2; ++attempt)
+                {
+                    next.initAngle = cars[c].initAngle + yawRates[c] * TIME_STEP;
+                    next.initPos = cars[c].initPos + speeds[c] * TIME_STEP * b2Vec2(-std::sin(next.initAngle), std::cos(next.initAngle));
+
+                    bool const inside = next.initPos.x > MARGIN && next.initPos.x < TRACK_SIZE - MARGIN
+                                     && next.initPos.y > MARGIN && next.initPos.y < TRACK_SIZE - MARGIN;
+                    if(inside && w.isSpawnFree(next))
+                    {
+                        cars[c] = next;
+                        break;
+                    }
+
+                    speeds[c] = -speeds[c];
+                    yawRates[c] = -yawRates[c];
+                }
+
+                Pose pose;
+                pose.position = cars[c].initPos;
+                pose.angle = cars[c].initAngle;
+                poses.push_back(pose);
+            }
+        }
+        return poses;
+    }
+
+    // Casts every pose, with a tracker per car unless trackers is empty.
+    // Returns the time taken.
+    double castPoses(World const & w, std::vector<Pose> const & poses, std::vector<SensorTracker> & trackers,
+                     std::vector<float32> const & angles, std::vector<float32> & fractions)
+    {
+        RayFan fan;
+        fractions.resize(poses.size() * NB_RAYS);
+
+        auto start = std::chrono::steady_clock::now();
+        for(auto p = 0u; p < poses.size(); ++p)
+        {
+            b2Vec2 const point1 = poses[p].position;
+            fan.reset(point1, NB_RAYS, nullptr);
+            for(auto i = 0u; i < NB_RAYS; ++i)
+            {
+                float32 angle = angles[i] + poses[p].angle + M_PI/2.0;
+                b2Vec2 point2 = b2Vec2(std::cos(angle), std::sin(angle));
+                point2 *= RAYCAST_DIST;
+                point2 += point1;
+                fan.setEnd(i, point2);
+            }
+
+            if(trackers.empty())
+            {
+                w.rayCast(&fan);
+            }
+            else
+            {
+                w.rayCast(&fan, &trackers[p % trackers.size()]);
+            }
+
+            for(auto i = 0u; i < NB_RAYS; ++i)
+            {
+                fractions[p * NB_RAYS + i] = fan.getFraction(i);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    void printCounters(std::vector<SensorTracker> const & trackers)
+    {
+        SensorTracker::Counters total = SensorTracker::Counters();
+        for(auto const & tracker: trackers)
+        {
+            total.nbHinted += tracker.getCounters().nbHinted;
+            total.nbHits += tracker.getCounters().nbHits;
+        }
+
+        double const nbHinted = static_cast<double>(total.nbHinted);
+        double const nbHits = static_cast<double>(total.nbHits);
+        std::cout << ", hint hit rate " << 100.0 * nbHits / std::max(nbHinted, 1.0) << "% of "
+                  << total.nbHinted << " hinted" << std::endl;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t nbCars     = argc > 1 ? std::atoi(argv[1]) : 100;
+    uint32_t nbObstacles = argc > 2 ? std::atoi(argv[2]) : 300;
+    uint32_t nbSteps    = argc > 3 ? std::atoi(argv[3]) : 500;
+
+    if(nbCars == 0 || nbSteps == 0)
+    {
+        std::cerr << "Usage: carphysics_sensor_tracking_bench [nbCars] [nbObstacles] [nbSteps]" << std::endl;
+        return 1;
+    }
+
+    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+    World w(8, 3, nullptr);
+    #else
+    World w(8, 3);
+    #endif
+
+    w.addBorders(TRACK_SIZE, TRACK_SIZE);
+    w.randomize(TRACK_SIZE, TRACK_SIZE, nbObstacles, 42);
+    w.bakeStaticGeometry(true);
+
+    std::vector<float32> angles;
+    for(auto i = 0u; i < NB_RAYS; ++i)
+    {
+        angles.push_back(-b2_pi + 2.0f * b2_pi * i / NB_RAYS);
+    }
+
+    std::vector<Pose> const poses = drive(w, nbCars, nbSteps);
+    if(nbCars == 0)
+    {
+        std::cerr << "No free pose on the track" << std::endl;
+        return 1;
+    }
+    double const nbRays = static_cast<double>(poses.size()) * NB_RAYS;
+
+    std::cout << "cars: " << nbCars << ", obstacles: " << nbObstacles << ", steps: " << nbSteps
+              << ", rays: " << NB_RAYS << std::endl;
+
+    std::vector<SensorTracker> trackers;
+    std::vector<float32> exact;
+    double const exactNs = castPoses(w, poses, trackers, angles, exact);
+    std::cout << "  exact: " << exactNs / nbRays << " ns/ray" << std::endl;
+
+    trackers.assign(nbCars, SensorTracker());
+    w.setSensorTracking(true);
+    std::vector<float32> hinted;
+    double const hintedNs = castPoses(w, poses, trackers, angles, hinted);
+    std::cout << "  hinted: " << hintedNs / nbRays << " ns/ray";
+    printCounters(trackers);
+
+    uint32_t mismatches = 0;
+    for(auto i = 0u; i < exact.size(); ++i)
+    {
+        if(hinted[i] < exact[i] || hinted[i] > exact[i]) ++mismatches;
+    }
+    std::cout << "mismatches (hinted vs exact): " << mismatches << " / " << exact.size() << std::endl;
+
+    return mismatches == 0 ? 0 : 1;
+}
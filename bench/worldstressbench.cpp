@@ -0,0 +1,168 @@
+// Many worlds created, stepped and destroyed concurrently, the way
+// SimulationBatch runs them: stresses the memory behind Box2D.
+// Each round runs nbWorlds worlds (borders, obstacles, cars driven by an
+// MLP controller) on all the threads, then destroys them. Runs the rounds
+// with plain malloc (ThreadAllocator caches disabled), then with the per
+// thread caches, and reports worlds/s and where the memory came from.
+// Contention only shows with several cores, see the threads line.
+// Usage: carphysics_world_stress_bench [nbWorlds] [nbRounds] [nbSteps] [firstTouch]
+
+#include <car.hpp>
+#include <mlpcontroller.hpp>
+#include <threadallocator.hpp>
+#include <world.hpp>
+
+#include <omp.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+    uint32_t const WORLD_SIZE = 200;
+    uint32_t const NB_OBSTACLES = 200;
+    uint32_t const NB_CARS = 50;
+
+    struct Round
+    {
+        double ms;
+        ThreadAllocator::Counters counters;   // Summed over the worlds
+    };
+
+    void accumulate(ThreadAllocator::Counters & sum, ThreadAllocator::Counters const & before, ThreadAllocator::Counters const & after)
+    {
+        sum.allocations += after.allocations - before.allocations;
+        sum.cacheHits += after.cacheHits - before.cacheHits;
+        sum.systemAllocations += after.systemAllocations - before.systemAllocations;
+        sum.systemFrees += after.systemFrees - before.systemFrees;
+    }
+
+    void runWorld(uint32_t seed, uint32_t nbSteps, Controller const * controller)
+    {
+        #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+        World w(8, 3, nullptr);
+        #else
+        World w(8, 3);
+        #endif
+
+        w.addBorders(WORLD_SIZE, WORLD_SIZE);
+        w.randomize(WORLD_SIZE, WORLD_SIZE, NB_OBSTACLES, seed);
+
+        CarDef def;
+        def.width = 2.0;
+        def.height = 3.0;
+        def.acceleration = 8.0;
+        for(auto i = 0u; i < 10; ++i)
+        {
+            def.raycastAngles.push_back(-b2_pi + 2.0f * b2_pi * i / 10);
+        }
+
+        // Cars on a grid, the ones spawned on an obstacle die at once
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float32> angleDistribution(-b2_pi, b2_pi);
+        for(auto i = 0u; i < NB_CARS; ++i)
+        {
+            def.initPos = b2Vec2(10.0f + 18.0f * (i % 10), 10.0f + 36.0f * (i / 10));
+            def.initAngle = angleDistribution(rng);
+            w.addRequiredDrawable(w.create<Car>(def, controller));
+        }
+
+        w.simulate(nbSteps);
+    }
+
+    Round runRound(uint32_t round, uint32_t nbWorlds, uint32_t nbSteps, Controller const * controller)
+    {
+        std::vector<ThreadAllocator::Counters> counters(nbWorlds, ThreadAllocator::Counters());
+
+        auto start = std::chrono::steady_clock::now();
+
+        #pragma omp parallel for schedule(dynamic, 1)
+        for(uint32_t i = 0; i < nbWorlds; ++i)
+        {
+            ThreadAllocator::Counters before = ThreadAllocator::getThreadCounters();
+            runWorld(round * nbWorlds + i + 1, nbSteps, controller);
+            accumulate(counters[i], before, ThreadAllocator::getThreadCounters());
+        }
+
+        auto end = std::chrono::steady_clock::now();
+
+        Round result;
+        result.ms = std::chrono::duration<double, std::milli>(end - start).count();
+        result.counters = ThreadAllocator::Counters();
+        for(auto const & c: counters)
+        {
+            accumulate(result.counters, ThreadAllocator::Counters(), c);
+        }
+
+        return result;
+    }
+
+    // Empties the caches of every thread
+    void releaseCaches()
+    {
+        #pragma omp parallel
+        {
+            ThreadAllocator::releaseThreadCache();
+        }
+    }
+
+    void run(char const * name, std::size_t cacheLimit, uint32_t nbWorlds, uint32_t nbRounds, uint32_t nbSteps, Controller const * controller)
+    {
+        releaseCaches();
+        ThreadAllocator::setCacheLimit(cacheLimit);
+
+        std::cout << name << std::endl;
+
+        double totalMs = 0.0;
+        for(uint32_t r = 0; r < nbRounds; ++r)
+        {
+            Round round = runRound(r, nbWorlds, nbSteps, controller);
+            totalMs += round.ms;
+
+            std::cout << "  round " << r << ": " << round.ms << " ms, "
+                      << 1000.0 * nbWorlds / round.ms << " worlds/s, "
+                      << round.counters.allocations << " b2 allocations, "
+                      << round.counters.systemAllocations << " from malloc, "
+                      << round.counters.cacheHits << " from cache" << std::endl;
+        }
+
+        std::cout << "  total: " << totalMs << " ms, "
+                  << 1000.0 * nbWorlds * nbRounds / totalMs << " worlds/s" << std::endl;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t nbWorlds   = argc > 1 ? std::atoi(argv[1]) : 64;
+    uint32_t nbRounds   = argc > 2 ? std::atoi(argv[2]) : 3;
+    uint32_t nbSteps    = argc > 3 ? std::atoi(argv[3]) : 50;
+    bool firstTouch     = argc > 4 ? std::atoi(argv[4]) != 0 : false;
+
+    if(nbWorlds == 0 || nbRounds == 0)
+    {
+        std::cerr << "Usage: carphysics_world_stress_bench [nbWorlds] [nbRounds] [nbSteps] [firstTouch]" << std::endl;
+        return 1;
+    }
+
+    std::cout << "worlds: " << nbWorlds << ", rounds: " << nbRounds << ", steps: " << nbSteps
+              << ", threads: " << omp_get_max_threads() << ", first touch: " << firstTouch << std::endl;
+
+    std::mt19937 rng(0);
+    MlpController controller({10, 16});
+    std::uniform_real_distribution<float32> weightDistribution(-1.0f, 1.0f);
+    std::vector<float32> weights(controller.getWeightCount());
+    for(auto & weight: weights) weight = weightDistribution(rng);
+    controller.setWeights(weights);
+
+    ThreadAllocator::setFirstTouch(firstTouch);
+
+    std::size_t const cacheLimit = ThreadAllocator::getCacheLimit();
+    run("malloc", 0, nbWorlds, nbRounds, nbSteps, &controller);
+    run("thread cache", cacheLimit, nbWorlds, nbRounds, nbSteps, &controller);
+
+    return 0;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Memory of the simulation objects of a world: chunks carved by size
+// classes, like b2BlockAllocator. Freed blocks go back to the free list of
+// their class, chunks are only given back when the arena is destroyed, all
+// at once. Not thread safe: objects are created and released by serial code.
+class Arena
+{
+public:
+    static std::size_t const CHUNK_SIZE = 64 * 1024;
+    static std::size_t const ALIGNMENT = 16;
+
+    // Larger blocks are plain heap allocations
+    static std::size_t const MAX_BLOCK_SIZE = 4096;
+
+    Arena();
+
+    Arena(Arena const & other) = delete;
+    Arena & operator=(Arena const & other) = delete;
+
+    ~Arena();
+
+    void * allocate(std::size_t size);
+    void deallocate(void * p, std::size_t size);
+
+    uint32_t getChunkCount() const;
+
+    // Bytes of the blocks in use, rounded up to their size class
+    std::size_t getBytesInUse() const;
+
+protected:
+    static std::size_t const NB_SIZE_CLASSES = MAX_BLOCK_SIZE / ALIGNMENT;
+
+    struct Block
+    {
+        Block * next;
+    };
+
+    static std::size_t getSizeClass(std::size_t size);
+
+protected:
+    Block * m_freeLists[NB_SIZE_CLASSES];
+    std::vector<char *> m_chunks;
+
+    // Unused end of the last chunk
+    char * m_top;
+    std::size_t m_remaining;
+
+    std::size_t m_bytesInUse;
+};
+
+// Standard allocator on an arena, for std::allocate_shared. Every object
+// keeps the arena alive, so it may outlive the world that created it.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(std::shared_ptr<Arena> const & arena);
+
+    template <typename U>
+    ArenaAllocator(ArenaAllocator<U> const & other);
+
+    T * allocate(std::size_t n);
+    void deallocate(T * p, std::size_t n);
+
+    std::shared_ptr<Arena> const & getArena() const;
+
+private:
+    std::shared_ptr<Arena> m_arena;
+};
+
+template <typename T>
+ArenaAllocator<T>::ArenaAllocator(std::shared_ptr<Arena> const & arena)
+    : m_arena(arena)
+{
+
+}
+
+template <typename T>
+template <typename U>
+ArenaAllocator<T>::ArenaAllocator(ArenaAllocator<U> const & other)
+    : m_arena(other.getArena())
+{
+
+}
+
+template <typename T>
+T * ArenaAllocator<T>::allocate(std::size_t n)
+{
+    static_assert(alignof(T) <= Arena::ALIGNMENT, "Over aligned type");
+    return static_cast<T *>(m_arena->allocate(n * sizeof(T)));
+}
+
+template <typename T>
+void ArenaAllocator<T>::deallocate(T * p, std::size_t n)
+{
+    m_arena->deallocate(p, n * sizeof(T));
+}
+
+template <typename T>
+std::shared_ptr<Arena> const & ArenaAllocator<T>::getArena() const
+{
+    return m_arena;
+}
+
+template <typename T, typename U>
+bool operator==(ArenaAllocator<T> const & a, ArenaAllocator<U> const & b)
+{
+    return a.getArena() == b.getArena();
+}
+
+template <typename T, typename U>
+bool operator!=(ArenaAllocator<T> const & a, ArenaAllocator<U> const & b)
+{
+    return !(a == b);
+}
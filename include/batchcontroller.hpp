@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+#include <Box2D/Box2D.h>
+
+#include <controller.hpp>
+
+// Controller evaluating many cars at once from their sensor matrix, instead
+// of one virtual call per car. Can still drive a single Car, as a batch of one.
+class BatchController : public Controller
+{
+public:
+    BatchController() = default;
+    virtual ~BatchController();
+
+    // sensors: nbCars rows of nbSensors collision distances
+    // flags: nbCars outputs, values of Car::Flags
+    // Called concurrently for different worlds: must be thread safe.
+    virtual void updateBatch(
+        float32 const * sensors, uint32_t nbCars, uint32_t nbSensors, int32_t * flags
+    ) const = 0;
+
+    virtual uint32_t updateFlags(Car * c) const override;
+};
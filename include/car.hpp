@@ -6,9 +6,18 @@
 
 #include <controller.hpp>
 #include <drawable.hpp>
+#include <fixedvector.hpp>
+#include <idletracker.hpp>
+#include <rayfan.hpp>
+#include <sensortracker.hpp>
 #include <tire.hpp>
 #include <world.hpp>
 
+class CarPool;
+
+// One value per sensor, the sensors of a car are cast as a single fan: at
+// most RayFan::MAX_RAYS, a CarDef with more can not be built (see FixedVector)
+typedef FixedVector<float32, RayFan::MAX_RAYS> SensorArray;
 
 struct CarDef
 {
@@ -20,7 +29,13 @@ struct CarDef
     float32 maxSteeringAngle;
     float32 steeringRate;
     float32 raycastDist;
-    std::vector<float32> raycastAngles;
+    SensorArray raycastAngles;
+    IdleDef idle;
+
+    // Static hits read from the sensor table of the world when it has the
+    // ray set of the car, instead of cast: approximate, see
+    // World::setSensorTable
+    bool sensorTable;
 
     CarDef()
         : width(0.0)
@@ -32,6 +47,8 @@ struct CarDef
         , steeringRate(maxSteeringAngle/30.0)
         , raycastDist(50.0)
         , raycastAngles()
+        , idle()
+        , sensorTable(false)
     {
 
     }
@@ -61,32 +78,62 @@ public:
     b2Vec2 getInitPos() const;
 
     double getAngle() const;
-    std::vector<float32> const & getCollisionDists() const;
+    SensorArray const & getCollisionDists() const;
 
     void setController(Controller const * c);
 
-    virtual void update(World const * w) override;
+    virtual void sense(World const * w) override;
+    virtual void act(World const * w) override;
     virtual void die(World const * w) override;
 
+    // Found idle since spawned or woken up: sleeping, or dead when the
+    // policy terminates idle cars
+    bool isIdle() const;
+    virtual bool isSleeping() const override;
+
+    virtual void saveState(Snapshot & s) const override;
+    virtual void restoreState(Snapshot const & s, std::size_t & offset) override;
+
     // Clone the car with its initial parameters
     std::shared_ptr<Car> cloneInitial() const;
 
+    // Position of tire (x, y) in the car frame, x and y in {0, 1}, y = 1 for the front
+    static b2Vec2 getTireAnchor(CarDef const & def, uint32_t x, uint32_t y);
+
+    // Same in the world frame, at the initial pose
+    static b2Vec2 getTireInitPos(CarDef const & def, uint32_t x, uint32_t y);
+
 
     friend std::ostream & operator<<(std::ostream & os, Car const & car);
 
 
 protected:
+    friend class CarPool;
+
+    virtual void define(DrawableDef & def) const override;
     virtual void setBody(b2Body * body, World * w) override;
 
     void doRaycast(World const * w) const;
 
+    // Puts the car and its tires to sleep, see IdleDef::SLEEP
+    void sleep();
+
+    // Chassis fixture (and vertices) from the definition
+    void reshape();
+
+    // Puts a recycled rig back at the initial pose of def, at rest, and
+    // gives its tires back to the world. The car itself is not added.
+    void rearm(CarDef const & def, Controller const * controller, World * w);
+
+    virtual bool recycle() override;
+
 private:
     virtual void onRemoveFromWorld(b2World * w) override;
 
 
 protected:
     /// Car definition ///
-    CarDef const m_def;
+    CarDef m_def;
 
     /// Car controller ///
     Controller const * m_controller;
@@ -95,12 +142,22 @@ protected:
     float32 m_power;
     b2RevoluteJoint * m_fljoint;
     b2RevoluteJoint * m_frjoint;
-    std::vector<std::shared_ptr<Tire>> m_tireList;
+    FixedVector<std::shared_ptr<Tire>, 4> m_tireList;
     uint32_t m_nbMotorWheels;
 
     /// Dynamic parameters ///
     int32_t m_flags;
     b2Vec2 m_position;
     float32 m_steeringAngle;
-    mutable std::vector<float32> m_collisionDists;
+    mutable SensorArray m_collisionDists;
+    mutable RayFan m_rayFan;
+    mutable SensorTracker m_sensorTracker;
+
+    /// Idle detection ///
+    IdleTracker m_idleTracker;
+    bool m_idle;
+
+    /// Pool the car belongs to, if any ///
+    CarPool * m_pool;
+    uint32_t m_poolIndex;
 };
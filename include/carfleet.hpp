@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+#include <batchcontroller.hpp>
+#include <car.hpp>
+#include <rayfan.hpp>
+#include <sensortracker.hpp>
+
+#if CAR_PHYSICS_GRAPHIC_MODE_SFML
+#include <SFML/Graphics/ConvexShape.hpp>
+#endif
+
+class Snapshot;
+class World;
+
+// Many cars stored as structure of arrays instead of one Car (and four Tire)
+// objects each. Behaves like the same number of Car objects added to a World,
+// but the update runs as tight loops over contiguous arrays.
+// All the cars of a fleet share the same sensor layout (raycast angles).
+// Dead cars keep their index, their bodies are destroyed.
+class CarFleet
+{
+public:
+    CarFleet();
+
+    CarFleet(CarFleet const & other) = delete;
+    CarFleet & operator=(CarFleet const & other) = delete;
+
+    ~CarFleet();
+
+    // Returns the index of the new car
+    uint32_t add(CarDef const & def);
+
+    uint32_t size() const;
+    uint32_t getAliveCount() const;
+    bool isAlive(uint32_t i) const;
+
+    // Sleeping cars are alive, see IdleDef::SLEEP
+    uint32_t getSleepingCount() const;
+    bool isSleeping(uint32_t i) const;
+
+    CarDef const & getDefinition(uint32_t i) const;
+    b2Vec2 getPos(uint32_t i) const;
+
+    // Chassis body, nullptr once the car died (unless dead bodies are kept)
+    b2Body const * getBody(uint32_t i) const;
+
+    // Flags stay the same until changed, like a Car without controller.
+    // Flag values are the ones of Car::Flags.
+    int32_t getFlags(uint32_t i) const;
+    void setFlags(uint32_t i, int32_t flags);
+
+    // Drives every car from the sensor matrix, once per step, after the
+    // raycasts. Overrides the flags set by hand. nullptr to disable.
+    void setController(BatchController const * controller);
+    BatchController const * getController() const;
+
+    uint32_t getSensorCount() const;
+
+    // Sensor distances of car i (getSensorCount() floats)
+    float32 const * getCollisionDists(uint32_t i) const;
+
+    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+    void getShapes(float scale, std::vector<sf::ConvexShape> & shapes) const;
+    #endif
+
+protected:
+    friend class World;
+
+    // Called by World
+    void attach(b2World * w);
+    void detach();
+    void sense(World const * w);
+    void act(World const * w);
+
+    void createBodies(uint32_t i);
+    void kill(uint32_t i);
+    void sleep(uint32_t i);
+
+    // See World::snapshot
+    void saveState(Snapshot & s) const;
+    void restoreState(Snapshot const & s, std::size_t & offset);
+    void setActive(uint32_t i, bool flag);
+
+protected:
+    b2World * m_world;
+
+    /// Construction parameters ///
+    std::vector<CarDef> m_defs;
+    SensorArray m_raycastAngles;
+    uint32_t m_nbSensors;
+
+    /// Per car arrays ///
+    std::vector<uint8_t> m_alive; // 0: dead, 1: alive, 2: dying, 3: sleeping
+    std::vector<int32_t> m_flags;
+    std::vector<float32> m_steering;
+    std::vector<float32> m_steeringRate;
+    std::vector<float32> m_maxSteering;
+    std::vector<float32> m_power;
+    std::vector<b2Vec2> m_positions;
+    std::vector<b2Body *> m_bodies;
+    std::vector<b2RevoluteJoint *> m_frontJoints; // 2 per car: left, right
+    std::vector<b2Body *> m_tires;                // 4 per car, rear ones first
+    std::vector<float32> m_collisionDists;        // m_nbSensors per car
+    std::vector<IdleTracker> m_idleTrackers;
+    std::vector<SensorTracker> m_sensorTrackers;
+
+    /// Sensors, one ray fan per thread ///
+    std::vector<RayFan> m_rayFans;
+
+    BatchController const * m_controller;
+
+    // Dead cars are deactivated instead of destroyed, for World::restore
+    bool m_keepDeadBodies;
+    uint32_t m_aliveCount;
+    uint32_t m_sleepingCount;
+};
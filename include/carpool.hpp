@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <car.hpp>
+
+class Controller;
+class World;
+
+// Cars that are reused instead of destroyed. A dead car of the pool keeps
+// its rig (body, tires and joints) deactivated, spawn re-arms it at the new
+// pose and definition: once enough rigs exist, spawning allocates nothing.
+// Dead cars are only given back while the world keeps no dead bodies for
+// snapshots. A pool lives within the lifetime of its world.
+class CarPool
+{
+public:
+    explicit CarPool(World * w);
+
+    CarPool(CarPool const & other) = delete;
+    CarPool & operator=(CarPool const & other) = delete;
+
+    ~CarPool();
+
+    // Adds a car at def.initPos to the world, reusing a dead one if any
+    std::shared_ptr<Car> spawn(CarDef const & def, Controller const * controller = nullptr, bool required = false);
+
+    // Rigs created so far, and the dead ones among them
+    uint32_t size() const;
+    uint32_t getFreeCount() const;
+
+protected:
+    friend class Car;
+
+    // Called by Car::recycle
+    void release(uint32_t index);
+
+protected:
+    World * m_world;
+    std::vector<std::shared_ptr<Car>> m_cars;
+    std::vector<uint32_t> m_free;
+};
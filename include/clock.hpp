@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+class World;
+
+// Stepping policy of World::run: how many fixed steps to simulate and when
+// to stop. The physics always advances by the same fixed duration per step,
+// so the policy only changes the pacing, never the results.
+class Clock
+{
+public:
+    Clock() = default;
+    virtual ~Clock();
+
+    // Called once before the first step
+    virtual void start();
+
+    // Number of steps to simulate now, stepDuration is in seconds
+    virtual uint32_t advance(double stepDuration) = 0;
+
+    // Called before each step with the number of steps already done
+    virtual bool keepRunning(World const & w, uint64_t stepCount);
+};
+
+// Follows the wall clock: sleeps until the next step is due
+class RealTimeClock : public Clock
+{
+public:
+    RealTimeClock();
+
+    virtual void start() override;
+    virtual uint32_t advance(double stepDuration) override;
+
+protected:
+    std::chrono::steady_clock::time_point m_lastTime;
+
+    // Seconds of wall time not simulated yet
+    double m_accumulator;
+};
+
+// Steps as fast as possible, never sleeps
+class FastClock : public Clock
+{
+public:
+    FastClock() = default;
+
+    virtual uint32_t advance(double stepDuration) override;
+};
+
+// Steps as fast as possible, at most nbSteps times
+class FixedStepsClock : public FastClock
+{
+public:
+    explicit FixedStepsClock(uint64_t nbSteps);
+
+    virtual bool keepRunning(World const & w, uint64_t stepCount) override;
+
+protected:
+    uint64_t m_nbSteps;
+};
+
+// Steps as fast as possible until the predicate returns true
+class PredicateClock : public FastClock
+{
+public:
+    typedef std::function<bool(World const &, uint64_t)> Predicate;
+
+    explicit PredicateClock(Predicate const & stop);
+
+    virtual bool keepRunning(World const & w, uint64_t stepCount) override;
+
+protected:
+    Predicate m_stop;
+};
@@ -7,6 +7,7 @@ class Controller
 public:
     Controller() = default;
 
-    // Must return the flags the car owning it should update to
+    // Must return the flags the car owning it should update to.
+    // Called concurrently for the cars of a world: must be thread safe.
     virtual uint32_t updateFlags(Car * c) const = 0;
 };
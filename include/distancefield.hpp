@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+class StaticTree;
+
+// Distance to the primitives of a StaticTree, sampled on a regular grid
+// over their bounds. Samples within a few cells of a primitive are exact,
+// farther ones come from a Euclidean distance transform and are lowered so
+// that they never exceed the true distance: sphere tracing the field can
+// not skip over geometry. Samples are quantized to a byte, so that a ray
+// walks the field from cache, and keep their closest primitive: near the
+// geometry, distances are computed on it.
+// The tree must outlive the field and not be rebuilt in between.
+class DistanceField
+{
+public:
+    // Samples closer than this many cells to a primitive are exact
+    static uint32_t const BAND_CELLS = 4;
+
+    // Resolution of the quantized samples, they saturate at 255 quanta
+    static uint32_t const QUANTA_PER_CELL = 8;
+
+    // Polygon primitive in the world frame, count is 0 for other shapes
+    struct Polygon
+    {
+        b2Vec2 vertices[b2_maxPolygonVertices];
+        b2Vec2 normals[b2_maxPolygonVertices];
+        int32 count;
+    };
+
+    DistanceField();
+
+    DistanceField(DistanceField const & other) = delete;
+    DistanceField & operator=(DistanceField const & other) = delete;
+
+    ~DistanceField();
+
+    // Samples the tree every cellSize, on its threads (OpenMP)
+    void build(StaticTree const & tree, float32 cellSize);
+    void clear();
+
+    bool empty() const;
+    float32 getCellSize() const;
+    uint32_t getWidth() const;
+    uint32_t getHeight() const;
+
+    // Bytes taken by the samples and the polygons
+    std::size_t getMemorySize() const;
+
+    // Never above the distance from p to the closest primitive
+    float32 getLowerBound(b2Vec2 const & p) const;
+
+    // Signed distance to the closest primitive of the samples around p,
+    // negative inside a polygon, and that primitive. Out of the band of
+    // every primitive: the lower bound, and -1.
+    float32 getDistance(b2Vec2 const & p, int32 & primitive) const;
+
+    // Sphere traces p1 + t (p2 - p1) for t in [start, end], stepping by the
+    // lower bound. Returns the first t where the bound drops under
+    // threshold: [start, t] is then free of primitives. Returns end if the
+    // whole segment is free.
+    float32 march(b2Vec2 const & p1, b2Vec2 const & p2, float32 start, float32 end, float32 threshold) const;
+
+protected:
+    // Clips the segment to the sampled area, false if it misses it
+    bool clip(b2Vec2 const & p1, b2Vec2 const & d, float32 & start, float32 & end) const;
+
+    uint32_t getNearestSample(b2Vec2 const & p) const;
+
+    // Closest primitives of the four samples around p, without repeats
+    uint32_t getCandidates(b2Vec2 const & p, int32 * candidates) const;
+
+    float32 getPrimitiveDistance(int32 i, b2Vec2 const & p) const;
+
+    // Exact distances and closest primitives around each primitive
+    void computeBand(std::vector<float32> & distances);
+
+    // Fills the quantized samples
+    void computeFarField(std::vector<float32> & distances);
+
+protected:
+    StaticTree const * m_tree;
+    std::vector<Polygon> m_polygons;    // One per primitive
+
+    b2Vec2 m_origin;        // Position of the first sample
+    float32 m_cellSize;
+    float32 m_invCellSize;
+    float32 m_quantum;
+    float32 m_halfDiagonal; // Farthest a point is from its nearest sample
+    uint32_t m_width;       // Samples per row
+    uint32_t m_height;      // Rows
+
+    // Row major, one per sample
+    std::vector<uint8_t> m_bounds;      // Lower bounds, in quanta
+    std::vector<int32> m_primitives;    // Closest one, -1 out of the band
+};
@@ -1,15 +1,29 @@
 #pragma once
 
-#include <vector>
+#include <cstddef>
+#include <utility>
 #include <Box2D/Box2D.h>
 
+#include <fixedvector.hpp>
+
 #if CAR_PHYSICS_GRAPHIC_MODE_SFML
 #include <SFML/Graphics/ConvexShape.hpp>
 #endif
 
 class Renderer;
+class Snapshot;
 class World;
 
+// Everything the body of a drawable is created from. Only needed by
+// World::addDrawable, so drawables build it on demand (Drawable::define)
+// instead of keeping one for their whole life.
+struct DrawableDef
+{
+    b2BodyDef body;
+    b2PolygonShape shape;
+    b2FixtureDef fixture;
+};
+
 class Drawable
 {
 public:
@@ -23,10 +37,32 @@ public:
 
     virtual ~Drawable();
 
+    // Sense then act
     virtual void update(World const * w);
 
+    // Read-only stage: may only query the world and modify this drawable.
+    // Called concurrently for all the drawables of a world.
+    virtual void sense(World const * w);
+
+    // Applies forces and changes the world. Called serially, in list order.
+    virtual void act(World const * w);
+
     virtual void die(World const * w);
 
+    // A sleeping drawable has nothing to do until something wakes it up,
+    // required ones no longer keep the world running (see IdleDef)
+    virtual bool isSleeping() const;
+
+    // State changed by the simulation, see World::snapshot.
+    // Restored in the same order it was saved.
+    virtual void saveState(Snapshot & s) const;
+    virtual void restoreState(Snapshot const & s, std::size_t & offset);
+
+    // Drawable the fixtures belong to, for sensors: itself unless it is part
+    // of another one (e.g. the tires of a car). Stamped as fixture user data.
+    Drawable * getOwner() const;
+    void setOwner(Drawable * owner);
+
     #if CAR_PHYSICS_GRAPHIC_MODE_SFML
     virtual sf::ConvexShape getShape(float scale);
     #endif
@@ -34,25 +70,37 @@ public:
 protected:
     friend class World;
 
-    b2BodyDef const * getBodyDef() const;
+    // Body and single fixture of the drawable, the fixture shape is set
+    // to def.shape afterwards
+    virtual void define(DrawableDef & def) const;
+
+    // Creates the body from define(), fixtures stamped with the owner. An
+    // inactive body has no broad-phase proxy.
+    b2Body * createBody(b2World * w, bool active = true) const;
+
     b2Body * getBody();
     virtual void setBody(b2Body * body, World * w = nullptr);
 
     bool isColliding() const;
 
+    // At rest at the given pose, and back in the broad-phase
+    void resetBody(b2Vec2 const & position, float32 angle);
+
     bool isMarkedForDeath() const;
     void setMarkedForDeath(bool death);
 
     virtual void onRemoveFromWorld(b2World * w);
 
+    // Called by World instead of onRemoveFromWorld once dead: true if the
+    // drawable keeps its body, deactivated, to be reused (see CarPool)
+    virtual bool recycle();
+
 
 protected:
-    b2PolygonShape m_shape;
     b2Body * m_body;
-    b2BodyDef m_bodyDef;
-    b2FixtureDef m_fixtureDef;
 
 private:
+    Drawable * m_owner;
     bool m_markedForDeath;
 
 protected:
@@ -60,6 +108,6 @@ protected:
     sf::Color m_color;
 
     //Vector of vertices in CCW order.
-    std::vector<std::pair<float, float>> m_vertices;
+    FixedVector<std::pair<float, float>, b2_maxPolygonVertices> m_vertices;
     #endif
 };
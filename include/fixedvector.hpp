@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+
+// Vector whose elements are stored inline, up to a fixed capacity: no heap
+// allocation, and the elements are copied along with the object holding it.
+// The N elements always exist, removed ones are reset to T(). Growing past
+// the capacity throws std::length_error, in release builds too.
+template <typename T, std::size_t N>
+class FixedVector
+{
+public:
+    typedef T value_type;
+    typedef T * iterator;
+    typedef T const * const_iterator;
+
+    FixedVector();
+    FixedVector(std::initializer_list<T> values);
+
+    FixedVector & operator=(std::initializer_list<T> values);
+
+    static std::size_t capacity();
+    std::size_t size() const;
+    bool empty() const;
+
+    void clear();
+    void push_back(T const & value);
+    void pop_back();
+    void resize(std::size_t n, T const & value = T());
+    void assign(std::size_t n, T const & value);
+
+    template <typename It>
+    void assign(It first, It last);
+
+    T & operator[](std::size_t i);
+    T const & operator[](std::size_t i) const;
+
+    T * data();
+    T const * data() const;
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // Element wise, without operator== so that floats compare silently
+    bool operator==(FixedVector const & other) const;
+    bool operator!=(FixedVector const & other) const;
+
+protected:
+    T m_data[N];
+    std::size_t m_size;
+};
+
+template <typename T, std::size_t N>
+FixedVector<T, N>::FixedVector()
+    : m_data()
+    , m_size(0)
+{
+
+}
+
+template <typename T, std::size_t N>
+FixedVector<T, N>::FixedVector(std::initializer_list<T> values)
+    : m_data()
+    , m_size(0)
+{
+    this->assign(values.begin(), values.end());
+}
+
+template <typename T, std::size_t N>
+FixedVector<T, N> & FixedVector<T, N>::operator=(std::initializer_list<T> values)
+{
+    this->assign(values.begin(), values.end());
+    return *this;
+}
+
+template <typename T, std::size_t N>
+std::size_t FixedVector<T, N>::capacity()
+{
+    return N;
+}
+
+template <typename T, std::size_t N>
+std::size_t FixedVector<T, N>::size() const
+{
+    return m_size;
+}
+
+template <typename T, std::size_t N>
+bool FixedVector<T, N>::empty() const
+{
+    return m_size == 0;
+}
+
+template <typename T, std::size_t N>
+void FixedVector<T, N>::clear()
+{
+    this->resize(0);
+}
+
+template <typename T, std::size_t N>
+void FixedVector<T, N>::push_back(T const & value)
+{
+    if(m_size >= N) throw std::length_error("FixedVector is full");
+    m_data[m_size++] = value;
+}
+
+template <typename T, std::size_t N>
+void FixedVector<T, N>::pop_back()
+{
+    assert(m_size > 0 && "FixedVector is empty");
+    m_data[--m_size] = T();
+}
+
+template <typename T, std::size_t N>
+void FixedVector<T, N>::resize(std::size_t n, T const & value)
+{
+    if(n > N) throw std::length_error("FixedVector capacity exceeded");
+    for(std::size_t i = n; i < m_size; ++i)
+    {
+        m_data[i] = T();
+    }
+    for(std::size_t i = m_size; i < n; ++i)
+    {
+        m_data[i] = value;
+    }
+    m_size = n;
+}
+
+template <typename T, std::size_t N>
+void FixedVector<T, N>::assign(std::size_t n, T const & value)
+{
+    this->clear();
+    this->resize(n, value);
+}
+
+template <typename T, std::size_t N>
+template <typename It>
+void FixedVector<T, N>::assign(It first, It last)
+{
+    this->clear();
+    for(; first != last; ++first)
+    {
+        this->push_back(*first);
+    }
+}
+
+template <typename T, std::size_t N>
+T & FixedVector<T, N>::operator[](std::size_t i)
+{
+    assert(i < m_size);
+    return m_data[i];
+}
+
+template <typename T, std::size_t N>
+T const & FixedVector<T, N>::operator[](std::size_t i) const
+{
+    assert(i < m_size);
+    return m_data[i];
+}
+
+template <typename T, std::size_t N>
+T * FixedVector<T, N>::data()
+{
+    return m_data;
+}
+
+template <typename T, std::size_t N>
+T const * FixedVector<T, N>::data() const
+{
+    return m_data;
+}
+
+template <typename T, std::size_t N>
+typename FixedVector<T, N>::iterator FixedVector<T, N>::begin()
+{
+    return m_data;
+}
+
+template <typename T, std::size_t N>
+typename FixedVector<T, N>::iterator FixedVector<T, N>::end()
+{
+    return m_data + m_size;
+}
+
+template <typename T, std::size_t N>
+typename FixedVector<T, N>::const_iterator FixedVector<T, N>::begin() const
+{
+    return m_data;
+}
+
+template <typename T, std::size_t N>
+typename FixedVector<T, N>::const_iterator FixedVector<T, N>::end() const
+{
+    return m_data + m_size;
+}
+
+template <typename T, std::size_t N>
+bool FixedVector<T, N>::operator==(FixedVector const & other) const
+{
+    if(m_size != other.m_size) return false;
+
+    for(std::size_t i = 0; i < m_size; ++i)
+    {
+        if(m_data[i] < other.m_data[i] || other.m_data[i] < m_data[i]) return false;
+    }
+    return true;
+}
+
+template <typename T, std::size_t N>
+bool FixedVector<T, N>::operator!=(FixedVector const & other) const
+{
+    return !(*this == other);
+}
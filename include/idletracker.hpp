@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+#include <Box2D/Box2D.h>
+
+// Idle detection of a car, off while steps is 0. A car is idle once, for
+// steps steps in a row, it drove slower than minSpeed or stayed within
+// minProgress of the same point (stuck, or going round in circles).
+struct IdleDef
+{
+    enum Policy
+    {
+        SLEEP,      // Its bodies sleep, no sensing nor control until woken up
+        TERMINATE,  // It dies, as on a crash
+    };
+
+    uint32_t steps;
+    float32 minSpeed;
+    float32 minProgress;
+    Policy policy;
+
+    IdleDef()
+        : steps(0)
+        , minSpeed(0.1)
+        , minProgress(0.5)
+        , policy(SLEEP)
+    {
+
+    }
+};
+
+// Idle detection state of one car, updated once per step
+class IdleTracker
+{
+public:
+    IdleTracker();
+
+    // Starts over from the given position
+    void reset(b2Vec2 const & position);
+
+    // True when the car is idle
+    bool update(IdleDef const & def, b2Vec2 const & position, b2Vec2 const & velocity);
+
+protected:
+    b2Vec2 m_anchor;
+    uint32_t m_anchorSteps;
+    uint32_t m_slowSteps;
+};
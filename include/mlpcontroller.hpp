@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <batchcontroller.hpp>
+
+// Dense multi-layer perceptron: tanh on the hidden layers, linear output.
+// The output layer has one neuron per Car::Flags bit (LEFT, RIGHT, FORWARD,
+// BACKWARD), a flag is set when its neuron is positive.
+// Each layer is one matrix product over all the cars of the batch.
+class MlpController : public BatchController
+{
+public:
+    enum Kernel
+    {
+        SCALAR,
+        SSE,
+        AVX2,
+    };
+
+    static uint32_t const NB_OUTPUTS = 4;
+
+    // layerSizes: number of inputs, then the size of each hidden layer.
+    // The output layer is added.
+    explicit MlpController(std::vector<uint32_t> const & layerSizes);
+
+    ~MlpController();
+
+    // Weights of each layer, row major (one row per neuron, one column per
+    // input) followed by the biases of the layer
+    uint32_t getWeightCount() const;
+    void setWeights(std::vector<float32> const & weights);
+
+    // Best kernel the CPU runs by default. AVX2 contracts into FMAs, its
+    // outputs may differ from the SSE ones in the last bits: set SSE for
+    // runs that are identical on every machine.
+    void setKernel(Kernel kernel);
+    Kernel getKernel() const;
+    static bool hasKernel(Kernel kernel);
+
+    virtual void updateBatch(
+        float32 const * sensors, uint32_t nbCars, uint32_t nbSensors, int32_t * flags
+    ) const override;
+
+protected:
+    struct Layer
+    {
+        uint32_t nbInputs;
+        uint32_t nbOutputs;
+        uint32_t stride;                // nbOutputs padded to 8
+        std::vector<float32> weights;   // Transposed: nbInputs rows of stride
+        std::vector<float32> biases;    // stride
+    };
+
+    // out = in * W + b, nbRows rows
+    void multiply(Layer const & layer, float32 const * in, uint32_t inStride, uint32_t nbRows, float32 * out) const;
+
+protected:
+    std::vector<Layer> m_layers;
+    Kernel m_kernel;
+};
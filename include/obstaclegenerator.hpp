@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+// Random box obstacles of a track, see World::randomize. The defaults draw
+// boxes anywhere, overlapping or not, as the first versions did: a seed
+// gives the same track as it used to.
+struct ObstacleDef
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t count;
+    uint32_t seed;                  // 0 picks one from the time
+
+    // Sides of the boxes, |normal(meanSize, sizeDeviation)|
+    float32 meanSize;
+    float32 sizeDeviation;
+
+    // Rejection rules, a rejected box is drawn again
+    float32 minGap;                 // Between boxes, negative: boxes may overlap
+    std::vector<b2Vec2> keepOut;    // Spawn points, no box within keepOutRadius
+    float32 keepOutRadius;
+    float32 gridCellSize;           // Free cells of this grid stay connected, 0: no check
+    uint32_t maxTries;              // Draws per box before leaving it out
+
+    // Bodies go straight to the static tree, see World::bakeStaticGeometry
+    bool bake;
+
+    ObstacleDef()
+        : width(100)
+        , height(80)
+        , count(15)
+        , seed(0)
+        , meanSize(10.0)
+        , sizeDeviation(5.0)
+        , minGap(-1.0)
+        , keepOut()
+        , keepOutRadius(5.0)
+        , gridCellSize(0.0)
+        , maxTries(20)
+        , bake(false)
+    {
+
+    }
+};
+
+// Places the boxes of an ObstacleDef. Boxes already placed are found through
+// a uniform spatial hash, so each draw is checked against its neighbours
+// only. The reachability rule keeps the free cells of a coarse grid in one
+// connected component: no box may close a pocket or cut the track in two,
+// every spawn point can reach every other one.
+class ObstacleGenerator
+{
+public:
+    struct Obstacle
+    {
+        b2Vec2 position;
+        float32 angle;
+        float32 width;
+        float32 height;
+    };
+
+    // Draws rejected by each rule, and boxes left out after maxTries draws
+    struct Rejections
+    {
+        uint32_t gap;
+        uint32_t keepOut;
+        uint32_t reachability;
+        uint32_t dropped;
+    };
+
+    explicit ObstacleGenerator(ObstacleDef const & def);
+
+    ObstacleGenerator(ObstacleGenerator const & other) = delete;
+    ObstacleGenerator & operator=(ObstacleGenerator const & other) = delete;
+
+    ~ObstacleGenerator();
+
+    std::vector<Obstacle> const & generate();
+
+    std::vector<Obstacle> const & getObstacles() const;
+    Rejections const & getRejections() const;
+
+protected:
+    ObstacleDef m_def;
+    std::vector<Obstacle> m_obstacles;
+    Rejections m_rejections;
+};
@@ -14,16 +14,11 @@ public:
      * @return fraction.
      */
     float32 ReportFixture(b2Fixture* fixture, const b2Vec2& point,const b2Vec2& normal, float32 fraction);
-    explicit RaycastCallback(const b2Body* owner);
+    explicit RaycastCallback(const void* owner);
     ~RaycastCallback();
-    const b2Body* owner;
+    const void* owner; // Fixtures with this user data are ignored
     b2Fixture* fixture;
     b2Vec2 point;
     b2Vec2 normal;
     float32 fraction;
-
-private:
-    b2Fixture* oldFixture;
-    float32 oldFraction;
-
 };
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+class DistanceField;
+class SensorTable;
+class SensorTracker;
+class StaticTree;
+
+// Bundle of rays sharing the same origin, cast with a single walk of the
+// broad-phase tree. Each ray keeps its own max fraction, clipped as hits
+// come in, so the result is the closest hit of every ray, exactly as
+// b2World::RayCast with a closest-hit callback would report it.
+// Fixtures whose user data is the owner are ignored (see Drawable::getOwner).
+class RayFan
+{
+public:
+    // Rays are stored inline, a fan never allocates
+    static uint32_t const MAX_RAYS = 64;
+
+    RayFan();
+
+    RayFan(RayFan const & other) = delete;
+    RayFan & operator=(RayFan const & other) = delete;
+
+    ~RayFan();
+
+    // Start a new fan of nbRays rays from origin, at most MAX_RAYS
+    void reset(b2Vec2 const & origin, uint32_t nbRays, void const * owner);
+
+    // Ray i goes from the origin to end
+    void setEnd(uint32_t i, b2Vec2 const & end);
+
+    // Bodies in skipped, sorted by address, are left out: the baked ones,
+    // cast with the static tree
+    void cast(b2World const * w, std::vector<b2Body *> const * skipped = nullptr);
+
+    // Hits keep adding up: casting against the static tree after the world
+    // gives the closest hit of both
+    void cast(StaticTree const * tree);
+
+    // Same hits as cast(tree), with the tree walked on short windows only:
+    // each ray is sphere traced through the field until it gets close to
+    // the geometry, the exact cast then starts from there
+    void cast(DistanceField const * field, StaticTree const * tree);
+
+    // Static hits interpolated in the table for a car of this body angle,
+    // instead of cast: the fan must be of its ray set, see SensorTable
+    void lookUp(SensorTable const * table, float32 angle);
+
+    // Casts every ray on the static fixture it hit last, see SensorTracker.
+    // nbHinted rays had one, nbHits of them hit it again.
+    void castHints(SensorTracker const & tracker, uint32_t & nbHinted, uint32_t & nbHits);
+
+    b2Vec2 const & getOrigin() const;
+    b2Vec2 getEnd(uint32_t i) const;
+
+    uint32_t size() const;
+
+    // Fraction of the ray length where the closest hit is, 1 if no hit
+    float32 getFraction(uint32_t i) const;
+
+    // Closest fixture hit, nullptr if no hit or a hit from a table
+    b2Fixture * getFixture(uint32_t i) const;
+    int32 getChildIndex(uint32_t i) const;
+
+    // b2DynamicTree::Traverse callbacks
+    bool TraverseNode(b2AABB const & aabb);
+    bool TraverseProxy(int32 proxyId);
+
+    // StaticTree::traverse callback
+    bool TraverseFixture(b2Fixture * fixture, int32 childIndex);
+
+protected:
+    void castPolygon(b2Fixture * fixture, b2PolygonShape const * shape, b2Transform const & xf);
+    void castShape(b2Fixture * fixture, int32 childIndex);
+
+protected:
+    b2BroadPhase const * m_broadPhase;
+    std::vector<b2Body *> const * m_skipped;
+    void const * m_owner;
+
+    b2Vec2 m_origin;
+    uint32_t m_nbRays;
+    uint32_t m_nbGroups;
+
+    // Structure of arrays, padded to a multiple of 4 rays
+    float32 m_endX[MAX_RAYS];
+    float32 m_endY[MAX_RAYS];
+    float32 m_invDirX[MAX_RAYS];
+    float32 m_invDirY[MAX_RAYS];
+    float32 m_fractions[MAX_RAYS];
+    float32 m_starts[MAX_RAYS];     // Rays are only tested beyond, 0 unless casting windows
+    b2Fixture * m_fixtures[MAX_RAYS];
+    int32 m_childIndices[MAX_RAYS];
+
+    // Rays overlapping the last tested node, one 4 bits mask per group
+    int32_t m_nodeMasks[MAX_RAYS / 4];
+};
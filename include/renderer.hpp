@@ -7,6 +7,7 @@
 #include <memory>
 #include <SFML/Graphics.hpp>
 
+class CarFleet;
 class Drawable;
 
 class Renderer
@@ -17,6 +18,12 @@ public:
 
     bool update(std::vector<std::shared_ptr<Drawable> > const & actorList, bool draw = true);
 
+    bool update(
+        std::vector<std::shared_ptr<Drawable> > const & actorList,
+        std::vector<std::shared_ptr<CarFleet> > const & fleetList,
+        bool draw = true
+    );
+
 protected:
     sf::RenderWindow m_window;
     uint32_t m_scale; // pixels per meter
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+class StaticTree;
+
+// Poses sampled by a SensorTable, and the rays of the cars it serves
+struct SensorTableDef
+{
+    b2AABB area;                        // Of the car centers
+    float32 cellSize;
+    uint32_t nbHeadings;                // Over a full turn
+    uint32_t bits;                      // Per distance, 8 or 16
+    uint32_t seed;                      // Of the map, names the cache file
+
+    // Same as CarDef
+    float32 raycastDist;
+    std::vector<float32> raycastAngles;
+
+    SensorTableDef()
+        : area()
+        , cellSize(1.0)
+        , nbHeadings(64)
+        , bits(16)
+        , seed(0)
+        , raycastDist(50.0)
+        , raycastAngles()
+    {
+        area.lowerBound.SetZero();
+        area.upperBound.SetZero();
+    }
+};
+
+// Sensor fractions against the static geometry, precomputed on a grid of
+// car poses (x, y, body angle): a fan of the ray set is then a trilinear
+// interpolation of the eight poses around, instead of a cast. Other cars
+// are not in the table. Fractions are quantized, the file of a table is
+// its memory image: a cached table is mapped, not read.
+class SensorTable
+{
+public:
+    // Increased when the file layout changes, older files are rebuilt
+    static uint32_t const VERSION = 1;
+
+    // Distance errors of the interpolated rays, in world units
+    struct Errors
+    {
+        uint64_t nbRays;
+        float32 mean;
+        float32 median;
+        float32 p99;
+        float32 max;
+        float32 overCell;   // Share of the rays off by more than a cell
+    };
+
+    SensorTable();
+
+    SensorTable(SensorTable const & other) = delete;
+    SensorTable & operator=(SensorTable const & other) = delete;
+
+    ~SensorTable();
+
+    // Casts the fans of every pose on the tree, on its threads (OpenMP)
+    void build(StaticTree const & tree, SensorTableDef const & def);
+
+    // Writes the table, false if the file can not be written
+    bool save(std::string const & path) const;
+
+    // Maps a table saved for def and a tree of this checksum, false if the
+    // file is missing or was saved for anything else
+    bool load(std::string const & path, SensorTableDef const & def, uint64_t checksum);
+
+    // Loads the table of def from the cache directory, or builds it and
+    // saves it there. Returns true if it was loaded.
+    bool open(std::string const & directory, StaticTree const & tree, SensorTableDef const & def);
+
+    void clear();
+
+    bool empty() const;
+    bool isMapped() const;
+    SensorTableDef const & getDef() const;
+
+    // Bytes of the samples
+    std::size_t getMemorySize() const;
+
+    // File of def in a cache directory, from the seed and the ray set
+    static std::string getCacheName(SensorTableDef const & def);
+
+    // Of the primitive bounds, tells trees of different maps apart
+    static uint64_t getChecksum(StaticTree const & tree);
+
+    // True if cars of this ray set can use the table
+    bool matches(float32 raycastDist, float32 const * angles, uint32_t nbRays) const;
+
+    // True if a car centered at p is within the sampled area
+    bool contains(b2Vec2 const & p) const;
+
+    // Fractions of the rays of a car centered at p, of this body angle.
+    // p must be in the area.
+    void lookUp(b2Vec2 const & p, float32 angle, float32 * fractions) const;
+
+    // Compares the interpolated rays to exact casts on the tree, for
+    // nbPoses random poses of the area
+    Errors measure(StaticTree const & tree, uint32_t nbPoses, uint32_t seed) const;
+
+protected:
+    std::size_t getOffset(uint32_t x, uint32_t y, uint32_t heading) const;
+
+    template <typename T>
+    void interpolate(b2Vec2 const & p, float32 angle, float32 * fractions) const;
+
+    void unmap();
+
+protected:
+    SensorTableDef m_def;
+    uint64_t m_checksum;
+
+    float32 m_invCellSize;
+    float32 m_headingsPerRadian;
+    uint32_t m_width;       // Samples per row
+    uint32_t m_height;      // Rows
+    uint32_t m_nbRays;
+
+    // Row major, then by heading: the fractions of each pose side by side
+    std::vector<uint8_t> m_samples;
+    uint8_t const * m_data; // Samples, or the mapped file past its header
+
+    void * m_mapping;
+    std::size_t m_mappingSize;
+};
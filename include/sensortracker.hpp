@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+
+#include <Box2D/Box2D.h>
+
+#include <rayfan.hpp>
+
+class StaticTree;
+
+// Static fixtures hit by the sensor fan of a car, kept from one step to the
+// next: each ray tests its last one first, which shortens it before the
+// tree is walked (see World::setSensorTracking).
+// Hints are only used while the tree that gave them is not rebuilt.
+class SensorTracker
+{
+public:
+    // Totals since construction, whatever the build, see World::stats
+    struct Counters
+    {
+        uint64_t nbHinted;      // Rays with a hint
+        uint64_t nbHits;        // Of them, rays that hit it again
+    };
+
+    SensorTracker();
+    ~SensorTracker();
+
+    // Forgets the hints, the next fan walks the tree. Counters are kept.
+    void reset();
+
+    // True if the hints come from this version of the tree, for nbRays rays
+    bool isValid(StaticTree const * tree, uint32_t nbRays) const;
+
+    // Last static fixture hit by ray i, nullptr if none
+    b2Fixture * getFixture(uint32_t i) const;
+    int32 getChildIndex(uint32_t i) const;
+
+    // Keeps the hits of a fan cast on the static geometry alone
+    void record(RayFan const & fan, StaticTree const * tree);
+
+    void count(uint32_t nbHinted, uint32_t nbHits);
+    Counters const & getCounters() const;
+
+protected:
+    StaticTree const * m_tree;
+    uint32_t m_version;
+    uint32_t m_nbRays;
+
+    b2Fixture * m_fixtures[RayFan::MAX_RAYS];
+    int32 m_childIndices[RayFan::MAX_RAYS];
+
+    Counters m_counters;
+};
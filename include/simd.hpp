@@ -0,0 +1,146 @@
+#pragma once
+
+// Minimal 4-wide float vector used by the batched kernels.
+// SSE is used when available, otherwise a plain scalar implementation.
+
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CAR_PHYSICS_SIMD_SSE 1
+#else
+#define CAR_PHYSICS_SIMD_SSE 0
+#endif
+
+namespace simd
+{
+
+#if CAR_PHYSICS_SIMD_SSE
+
+struct f32x4
+{
+    __m128 v;
+};
+
+inline f32x4 load(float const * p)       { return f32x4{_mm_loadu_ps(p)}; }
+inline void store(float * p, f32x4 a)    { _mm_storeu_ps(p, a.v); }
+inline f32x4 set1(float x)               { return f32x4{_mm_set1_ps(x)}; }
+
+inline f32x4 operator+(f32x4 a, f32x4 b) { return f32x4{_mm_add_ps(a.v, b.v)}; }
+inline f32x4 operator-(f32x4 a, f32x4 b) { return f32x4{_mm_sub_ps(a.v, b.v)}; }
+inline f32x4 operator*(f32x4 a, f32x4 b) { return f32x4{_mm_mul_ps(a.v, b.v)}; }
+inline f32x4 operator/(f32x4 a, f32x4 b) { return f32x4{_mm_div_ps(a.v, b.v)}; }
+
+inline f32x4 min(f32x4 a, f32x4 b)       { return f32x4{_mm_min_ps(a.v, b.v)}; }
+inline f32x4 max(f32x4 a, f32x4 b)       { return f32x4{_mm_max_ps(a.v, b.v)}; }
+
+// Comparisons return a mask: all bits set in the lanes where true
+inline f32x4 operator<(f32x4 a, f32x4 b)  { return f32x4{_mm_cmplt_ps(a.v, b.v)}; }
+inline f32x4 operator<=(f32x4 a, f32x4 b) { return f32x4{_mm_cmple_ps(a.v, b.v)}; }
+inline f32x4 operator>(f32x4 a, f32x4 b)  { return f32x4{_mm_cmpgt_ps(a.v, b.v)}; }
+inline f32x4 operator==(f32x4 a, f32x4 b) { return f32x4{_mm_cmpeq_ps(a.v, b.v)}; }
+
+inline f32x4 operator&(f32x4 a, f32x4 b) { return f32x4{_mm_and_ps(a.v, b.v)}; }
+inline f32x4 operator|(f32x4 a, f32x4 b) { return f32x4{_mm_or_ps(a.v, b.v)}; }
+
+// ~a & b
+inline f32x4 andNot(f32x4 a, f32x4 b)    { return f32x4{_mm_andnot_ps(a.v, b.v)}; }
+
+// mask ? a : b
+inline f32x4 select(f32x4 mask, f32x4 a, f32x4 b)
+{
+    return f32x4{_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+}
+
+// One bit per lane
+inline int32_t bits(f32x4 mask)          { return _mm_movemask_ps(mask.v); }
+
+#else
+
+struct f32x4
+{
+    float v[4];
+};
+
+namespace detail
+{
+    union Lane
+    {
+        float f;
+        uint32_t u;
+    };
+
+    inline float fromBool(bool b)
+    {
+        Lane l;
+        l.u = b ? 0xffffffffu : 0u;
+        return l.f;
+    }
+
+    inline uint32_t toBits(float f)
+    {
+        Lane l;
+        l.f = f;
+        return l.u;
+    }
+
+    inline float fromBits(uint32_t u)
+    {
+        Lane l;
+        l.u = u;
+        return l.f;
+    }
+}
+
+#define CAR_PHYSICS_SIMD_LANES(expr) \
+    f32x4 r; for(int i = 0; i < 4; ++i) { r.v[i] = (expr); } return r;
+
+inline f32x4 load(float const * p)       { CAR_PHYSICS_SIMD_LANES(p[i]) }
+inline void store(float * p, f32x4 a)    { for(int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+inline f32x4 set1(float x)               { CAR_PHYSICS_SIMD_LANES(x) }
+
+inline f32x4 operator+(f32x4 a, f32x4 b) { CAR_PHYSICS_SIMD_LANES(a.v[i] + b.v[i]) }
+inline f32x4 operator-(f32x4 a, f32x4 b) { CAR_PHYSICS_SIMD_LANES(a.v[i] - b.v[i]) }
+inline f32x4 operator*(f32x4 a, f32x4 b) { CAR_PHYSICS_SIMD_LANES(a.v[i] * b.v[i]) }
+inline f32x4 operator/(f32x4 a, f32x4 b) { CAR_PHYSICS_SIMD_LANES(a.v[i] / b.v[i]) }
+
+inline f32x4 min(f32x4 a, f32x4 b)       { CAR_PHYSICS_SIMD_LANES(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+inline f32x4 max(f32x4 a, f32x4 b)       { CAR_PHYSICS_SIMD_LANES(a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+
+inline f32x4 operator<(f32x4 a, f32x4 b)  { CAR_PHYSICS_SIMD_LANES(detail::fromBool(a.v[i] < b.v[i])) }
+inline f32x4 operator<=(f32x4 a, f32x4 b) { CAR_PHYSICS_SIMD_LANES(detail::fromBool(a.v[i] <= b.v[i])) }
+inline f32x4 operator>(f32x4 a, f32x4 b)  { CAR_PHYSICS_SIMD_LANES(detail::fromBool(a.v[i] > b.v[i])) }
+inline f32x4 operator==(f32x4 a, f32x4 b) { CAR_PHYSICS_SIMD_LANES(detail::fromBool(!(a.v[i] < b.v[i]) && !(a.v[i] > b.v[i]))) }
+
+inline f32x4 operator&(f32x4 a, f32x4 b)
+{
+    CAR_PHYSICS_SIMD_LANES(detail::fromBits(detail::toBits(a.v[i]) & detail::toBits(b.v[i])))
+}
+
+inline f32x4 operator|(f32x4 a, f32x4 b)
+{
+    CAR_PHYSICS_SIMD_LANES(detail::fromBits(detail::toBits(a.v[i]) | detail::toBits(b.v[i])))
+}
+
+inline f32x4 andNot(f32x4 a, f32x4 b)
+{
+    CAR_PHYSICS_SIMD_LANES(detail::fromBits(~detail::toBits(a.v[i]) & detail::toBits(b.v[i])))
+}
+
+inline f32x4 select(f32x4 mask, f32x4 a, f32x4 b)
+{
+    CAR_PHYSICS_SIMD_LANES(detail::toBits(mask.v[i]) ? a.v[i] : b.v[i])
+}
+
+inline int32_t bits(f32x4 mask)
+{
+    int32_t r = 0;
+    for(int i = 0; i < 4; ++i) r |= (detail::toBits(mask.v[i]) ? 1 : 0) << i;
+    return r;
+}
+
+#undef CAR_PHYSICS_SIMD_LANES
+
+#endif // CAR_PHYSICS_SIMD_SSE
+
+} // namespace simd
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <car.hpp>
+#include <controller.hpp>
+
+
+// Track every world of a batch is built from
+struct TrackDef
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t nbObstacles;
+    uint32_t seed;
+    bool borders;
+
+    TrackDef()
+        : width(100)
+        , height(80)
+        , nbObstacles(15)
+        , seed(1)
+        , borders(true)
+    {
+
+    }
+};
+
+// Result of the evaluation of one car of the batch
+struct FitnessRecord
+{
+    uint32_t index;       // Index of the car in the batch
+    uint32_t steps;       // Number of steps the car survived
+    bool alive;           // Still alive after the last step
+    bool idle;            // Stopped early by idle detection (see IdleDef)
+    float32 distance;     // Length of the path driven
+    float32 displacement; // Distance between initial and final position
+    b2Vec2 finalPos;
+
+    FitnessRecord()
+        : index(0)
+        , steps(0)
+        , alive(false)
+        , idle(false)
+        , distance(0.0)
+        , displacement(0.0)
+        , finalPos(0.0, 0.0)
+    {
+
+    }
+};
+
+// Evaluates many cars, each one alone in its own World, over a pool of
+// OpenMP threads. Controllers are shared between threads and must therefore
+// be safe to call concurrently through Controller::updateFlags.
+class SimulationBatch
+{
+public:
+    explicit SimulationBatch(TrackDef const & track, uint32_t maxSteps = 5000);
+
+    SimulationBatch(SimulationBatch const & other) = delete;
+    SimulationBatch & operator=(SimulationBatch const & other) = delete;
+
+    ~SimulationBatch();
+
+    void add(CarDef const & def, Controller const * controller);
+    void clear();
+
+    uint32_t size() const;
+
+    // 0 means using every available core
+    void setThreadCount(uint32_t nbThreads);
+
+    std::vector<FitnessRecord> run() const;
+
+protected:
+    FitnessRecord evaluate(uint32_t index) const;
+
+protected:
+    TrackDef const m_track;
+    uint32_t m_maxSteps;
+    uint32_t m_nbThreads;
+
+    std::vector<CarDef> m_defs;
+    std::vector<Controller const *> m_controllers;
+};
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+class World;
+
+// State of a World between two steps, filled by World::snapshot and
+// restored by World::restore as many times as needed.
+// Bodies, joints, contacts and sensors are copied into flat buffers: taking
+// a snapshot again reuses their memory.
+class Snapshot
+{
+public:
+    Snapshot();
+    ~Snapshot();
+
+    void clear();
+
+    // Memory used by the state, in bytes
+    std::size_t getSize() const;
+
+    /// Flat buffer ///
+    template <typename T>
+    void write(T const * values, std::size_t count);
+
+    template <typename T>
+    void write(T const & value);
+
+    // Reads at offset, then advances it
+    template <typename T>
+    void read(std::size_t & offset, T * values, std::size_t count) const;
+
+    template <typename T>
+    void read(std::size_t & offset, T & value) const;
+
+    /// Box2D objects ///
+    // Motion state of the body and solver state of the revolute joints it
+    // is the body A of
+    void writeBody(b2Body const * body);
+    void readBody(std::size_t & offset, b2Body * body) const;
+
+protected:
+    friend class World;
+
+    struct ContactRecord
+    {
+        b2Fixture * fixtureA;
+        b2Fixture * fixtureB;
+        int32 indexA;
+        int32 indexB;
+        b2Manifold manifold;
+        bool touching;
+    };
+
+    static bool lessThan(ContactRecord const & a, ContactRecord const & b);
+
+    void writeContacts(b2World * w);
+
+    // Restores the contacts existing in the snapshot, destroys the others
+    void readContacts(b2World * w) const;
+
+    // Returns the number of contacts of the snapshot found in the world
+    std::size_t matchContacts(b2World * w) const;
+
+protected:
+    World const * m_world;
+
+    // Number of drawables ever added to the world when taken
+    std::size_t m_nbDrawables;
+
+    std::vector<uint8_t> m_buffer;
+    std::vector<ContactRecord> m_contacts; // Sorted
+
+    // Restore scratch: contacts of the snapshot found in the world
+    mutable std::vector<uint8_t> m_found;
+};
+
+template <typename T>
+void Snapshot::write(T const * values, std::size_t count)
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be saved");
+
+    std::size_t offset = m_buffer.size();
+    m_buffer.resize(offset + count * sizeof(T));
+    if(count) std::memcpy(m_buffer.data() + offset, values, count * sizeof(T));
+}
+
+template <typename T>
+void Snapshot::write(T const & value)
+{
+    this->write(&value, 1);
+}
+
+template <typename T>
+void Snapshot::read(std::size_t & offset, T * values, std::size_t count) const
+{
+    static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be restored");
+    assert(offset + count * sizeof(T) <= m_buffer.size() && "Reading past the snapshot");
+
+    if(count) std::memcpy(values, m_buffer.data() + offset, count * sizeof(T));
+    offset += count * sizeof(T);
+}
+
+template <typename T>
+void Snapshot::read(std::size_t & offset, T & value) const
+{
+    this->read(offset, &value, 1);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+// Uniform spatial hash: every item goes in the bucket of each grid cell its
+// bounds cover. Cells are hashed into a fixed number of buckets, so the grid
+// itself is unbounded. Items are dense indices, only ever added.
+class SpatialHash
+{
+public:
+    // The number of buckets is rounded up to a power of two
+    SpatialHash(float32 cellSize, uint32_t nbBuckets);
+
+    SpatialHash(SpatialHash const & other) = delete;
+    SpatialHash & operator=(SpatialHash const & other) = delete;
+
+    ~SpatialHash();
+
+    void insert(uint32_t item, b2AABB const & aabb);
+    void clear();
+
+    // callback->QueryItem(item) once for each item sharing a bucket with the
+    // cells of aabb, until it returns false. A superset of the items whose
+    // bounds overlap aabb: hashed cells collide.
+    template <typename T>
+    void query(T * callback, b2AABB const & aabb) const;
+
+protected:
+    struct Entry
+    {
+        uint32_t item;
+        int32 next;         // Next entry of the bucket, -1 at the end
+    };
+
+    int32 getCell(float32 v) const;
+    uint32_t getBucket(int32 x, int32 y) const;
+
+protected:
+    float32 m_invCellSize;
+    uint32_t m_mask;
+    std::vector<int32> m_heads;
+    std::vector<Entry> m_entries;
+
+    // Last query each item was reported to, an item may be in several of
+    // the visited buckets
+    mutable std::vector<uint32_t> m_stamps;
+    mutable uint32_t m_queryId;
+};
+
+template <typename T>
+void SpatialHash::query(T * callback, b2AABB const & aabb) const
+{
+    ++m_queryId;
+
+    int32 const x0 = this->getCell(aabb.lowerBound.x);
+    int32 const x1 = this->getCell(aabb.upperBound.x);
+    int32 const y0 = this->getCell(aabb.lowerBound.y);
+    int32 const y1 = this->getCell(aabb.upperBound.y);
+
+    for(int32 y = y0; y <= y1; ++y)
+    {
+        for(int32 x = x0; x <= x1; ++x)
+        {
+            for(int32 e = m_heads[this->getBucket(x, y)]; e >= 0; e = m_entries[e].next)
+            {
+                uint32_t const item = m_entries[e].item;
+                if(m_stamps[item] == m_queryId) continue;
+
+                m_stamps[item] = m_queryId;
+                if(!callback->QueryItem(item)) return;
+            }
+        }
+    }
+}
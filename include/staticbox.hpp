@@ -9,6 +9,14 @@ public:
     ~StaticBox();
 
 protected:
+    virtual void define(DrawableDef & def) const override;
+
+protected:
+    // Pose and size the body is created with. define() runs when the world
+    // adds the box, after construction: 20 bytes, where a kept DrawableDef
+    // takes 264.
+    b2Vec2 m_initPos;
+    float32 m_initAngle;
     float32 m_width;
     float32 m_height;
 };
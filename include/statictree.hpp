@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Box2D/Box2D.h>
+
+// Read-only bounding volume hierarchy over fixtures that never move, built
+// once with the surface area heuristic (perimeter in 2D).
+// Nodes are one cache line each and stored depth first: the first child of
+// an inner node is the next node, and every node knows where traversal goes
+// on when its subtree is skipped or done, so no stack is needed.
+class StaticTree
+{
+public:
+    static uint32_t const CACHE_LINE = 64;
+    static uint32_t const MAX_LEAF_SIZE = 10;
+
+    struct Node
+    {
+        b2AABB aabb;
+        int32 escape;                       // Next node once this subtree is done
+        int32 count;                        // Number of primitives, 0 for inner nodes
+        int32 primitives[MAX_LEAF_SIZE];
+    };
+
+    struct Primitive
+    {
+        b2Fixture * fixture;
+        int32 childIndex;
+    };
+
+    StaticTree();
+
+    StaticTree(StaticTree const & other) = delete;
+    StaticTree & operator=(StaticTree const & other) = delete;
+
+    ~StaticTree();
+
+    // Every child of every fixture becomes a primitive, at the current
+    // transform of its body
+    void build(std::vector<b2Fixture *> const & fixtures);
+    void clear();
+
+    bool empty() const;
+    uint32_t getNodeCount() const;
+    uint32_t getPrimitiveCount() const;
+    int32 getHeight() const;
+
+    // Changes with every build and clear: primitives of an older version
+    // may be gone
+    uint32_t getVersion() const;
+
+    Primitive const & getPrimitive(int32 i) const;
+    b2AABB const & getPrimitiveBounds(int32 i) const;
+
+    // Same contract as b2DynamicTree::Traverse, with
+    // callback->TraverseFixture(fixture, childIndex) for the primitives
+    template <typename T>
+    void traverse(T * callback) const;
+
+    // callback->QueryFixture(fixture, childIndex) for each primitive whose
+    // bounds overlap aabb, until it returns false
+    template <typename T>
+    void query(T * callback, b2AABB const & aabb) const;
+
+    // Same contract as b2World::RayCast
+    void rayCast(b2RayCastCallback * callback, b2RayCastInput const & input) const;
+
+protected:
+    // Appends the subtree of primitives [begin, end) of m_order
+    void buildNode(uint32_t begin, uint32_t end, std::vector<b2AABB> const & bounds);
+
+protected:
+    std::vector<Primitive> m_primitives;
+    std::vector<b2AABB> m_primitiveBounds;
+
+    // Build scratch: primitive indices, sorted per subtree
+    std::vector<int32> m_order;
+
+    // Nodes, aligned on a cache line in m_storage
+    std::vector<uint8_t> m_storage;
+    Node * m_nodes;
+    uint32_t m_nbNodes;
+    uint32_t m_version;
+};
+
+template <typename T>
+void StaticTree::traverse(T * callback) const
+{
+    uint32_t i = 0;
+    while(i < m_nbNodes)
+    {
+        Node const & node = m_nodes[i];
+
+        if(!callback->TraverseNode(node.aabb))
+        {
+            i = static_cast<uint32_t>(node.escape);
+            continue;
+        }
+
+        for(int32 k = 0; k < node.count; ++k)
+        {
+            Primitive const & p = m_primitives[node.primitives[k]];
+            if(!callback->TraverseFixture(p.fixture, p.childIndex)) return;
+        }
+
+        ++i;
+    }
+}
+
+template <typename T>
+void StaticTree::query(T * callback, b2AABB const & aabb) const
+{
+    uint32_t i = 0;
+    while(i < m_nbNodes)
+    {
+        Node const & node = m_nodes[i];
+
+        if(!b2TestOverlap(node.aabb, aabb))
+        {
+            i = static_cast<uint32_t>(node.escape);
+            continue;
+        }
+
+        for(int32 k = 0; k < node.count; ++k)
+        {
+            int32 const index = node.primitives[k];
+            if(!b2TestOverlap(m_primitiveBounds[index], aabb)) continue;
+
+            Primitive const & p = m_primitives[index];
+            if(!callback->QueryFixture(p.fixture, p.childIndex)) return;
+        }
+
+        ++i;
+    }
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include <Box2D/Box2D.h>
+
+// Timers and counters of the hot paths, aggregated per step.
+// The recording macros compile to nothing when CAR_PHYSICS_STATS is 0 (the
+// counts are not evaluated, only named so that they are not unused), the
+// Stats object itself is always there (and then stays empty).
+#if CAR_PHYSICS_STATS
+#define CAR_PHYSICS_CONCAT_IMPL(a, b) a##b
+#define CAR_PHYSICS_CONCAT(a, b) CAR_PHYSICS_CONCAT_IMPL(a, b)
+#define CAR_PHYSICS_SCOPED_TIMER(stats, phase) \
+    ScopedTimer CAR_PHYSICS_CONCAT(scopedTimer, __LINE__)((stats), (phase))
+#define CAR_PHYSICS_COUNT(stats, counter, n) (stats)->count((counter), (n))
+#else
+#define CAR_PHYSICS_SCOPED_TIMER(stats, phase) static_cast<void>(0)
+#define CAR_PHYSICS_COUNT(stats, counter, n) static_cast<void>(sizeof(n))
+#endif
+
+// Distribution of durations, in power of two buckets of nanoseconds
+class Histogram
+{
+public:
+    static uint32_t const NB_BUCKETS = 48;
+
+    Histogram();
+
+    void add(uint64_t ns);
+    void clear();
+
+    uint64_t getCount() const;
+    uint64_t getTotal() const;
+    uint64_t getMin() const;
+    uint64_t getMax() const;
+    double getMean() const;
+
+    // Upper bound of the bucket holding the p quantile, p in [0, 1]
+    uint64_t getPercentile(double p) const;
+
+    uint64_t getBucket(uint32_t i) const;
+
+protected:
+    uint64_t m_count;
+    uint64_t m_total;
+    uint64_t m_min;
+    uint64_t m_max;
+    uint64_t m_buckets[NB_BUCKETS]; // Bucket i: [2^(i-1), 2^i), 0 in bucket 0
+};
+
+class Stats
+{
+public:
+    // Nested phases overlap: RAYCAST and CONTROLLER are part of SENSE,
+    // FRICTION is part of ACT, the Box2D ones are part of PHYSICS.
+    // Phases timed inside the parallel sense add up the time of all threads.
+    enum Phase
+    {
+        STEP,
+        SENSE,
+        RAYCAST,
+        CONTROLLER,
+        ACT,
+        FRICTION,
+        REMOVE_DRAWABLES,
+        PHYSICS,
+
+        // From b2Profile
+        B2_COLLIDE,
+        B2_SOLVE,
+        B2_SOLVE_TOI,
+        B2_BROADPHASE,
+
+        NB_PHASES
+    };
+
+    enum Counter
+    {
+        STEPS,
+        RAYCASTS,               // Ray fans, one per car and step
+        RAYS,
+        CONTROLLER_CALLS,       // Cars evaluated by a controller
+        REMOVED_DRAWABLES,
+        KILLED_FLEET_CARS,
+        IDLE_CARS,              // Cars put to sleep or terminated for idling
+        HINTED_RAYS,            // Tracked rays cast on their last static fixture first
+        HINT_HITS,              // ... still the closest static hit
+
+        NB_COUNTERS
+    };
+
+    Stats();
+
+    Stats(Stats const & other) = delete;
+    Stats & operator=(Stats const & other) = delete;
+
+    ~Stats();
+
+    static char const * getPhaseName(Phase phase);
+    static char const * getCounterName(Counter counter);
+
+    /// Recording, thread safe ///
+    void addTime(Phase phase, uint64_t ns);
+    void count(Counter counter, uint64_t n = 1);
+
+    // Moves the times of the step into the histograms, the phases not
+    // entered during the step are left out
+    void endStep(b2Profile const & profile);
+
+    void clear();
+
+    /// Reading ///
+    // One sample per step
+    Histogram const & getHistogram(Phase phase) const;
+
+    // Number of times the phase was entered
+    uint64_t getCalls(Phase phase) const;
+    uint64_t getCount(Counter counter) const;
+
+    void dumpJson(std::ostream & out) const;
+    void dumpCsv(std::ostream & out) const;
+
+protected:
+    Histogram m_histograms[NB_PHASES];
+    uint64_t m_calls[NB_PHASES];
+
+    // Current step
+    std::atomic<uint64_t> m_stepTimes[NB_PHASES];
+    std::atomic<uint64_t> m_stepCalls[NB_PHASES];
+
+    std::atomic<uint64_t> m_counters[NB_COUNTERS];
+};
+
+// Adds the time spent in its scope to a phase
+class ScopedTimer
+{
+public:
+    ScopedTimer(Stats * stats, Stats::Phase phase);
+
+    ScopedTimer(ScopedTimer const & other) = delete;
+    ScopedTimer & operator=(ScopedTimer const & other) = delete;
+
+    ~ScopedTimer();
+
+protected:
+    Stats * m_stats;
+    Stats::Phase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+inline ScopedTimer::ScopedTimer(Stats * stats, Stats::Phase phase)
+    : m_stats(stats)
+    , m_phase(phase)
+    , m_start(std::chrono::steady_clock::now())
+{
+
+}
+
+inline ScopedTimer::~ScopedTimer()
+{
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - m_start
+    ).count();
+    m_stats->addTime(m_phase, static_cast<uint64_t>(ns));
+}
+
+inline void Stats::addTime(Phase phase, uint64_t ns)
+{
+    m_stepTimes[phase].fetch_add(ns, std::memory_order_relaxed);
+    m_stepCalls[phase].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void Stats::count(Counter counter, uint64_t n)
+{
+    m_counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Memory behind b2Alloc / b2Free, hence behind the chunks of every
+// b2BlockAllocator, and behind the b2World objects (with the stack of
+// their b2StackAllocator). Each thread keeps the blocks it frees in its own
+// cache, by power of two size classes, and serves its next allocations from
+// there: a world created on a thread reuses the memory of the worlds
+// destroyed before on that thread, without malloc nor lock.
+// Blocks may be freed by another thread, they then go to its cache.
+class ThreadAllocator
+{
+public:
+    // Bytes a thread keeps cached at most, beyond that blocks are freed
+    static std::size_t const DEFAULT_CACHE_LIMIT = 64 * 1024 * 1024;
+
+    // Larger blocks are never cached
+    static std::size_t const MAX_CACHED_SIZE = 128 * 1024;
+
+    struct Counters
+    {
+        uint64_t allocations;
+        uint64_t cacheHits;
+        uint64_t systemAllocations;
+        uint64_t systemFrees;
+        uint64_t cachedBytes;
+    };
+
+    ThreadAllocator() = delete;
+
+    static void * allocate(std::size_t size);
+    static void deallocate(void * p);
+
+    // For every thread, 0 disables the caches: plain malloc and free
+    static void setCacheLimit(std::size_t bytes);
+    static std::size_t getCacheLimit();
+
+    // Writes new blocks from the allocating thread: under the first touch
+    // policy of the kernel, their pages are then on its NUMA node. Only
+    // pages malloc maps for the block are concerned: blocks it carves from
+    // pages already touched, reused ones, and cached blocks stay where they are.
+    static void setFirstTouch(bool enabled);
+    static bool getFirstTouch();
+
+    // Of the calling thread
+    static Counters getThreadCounters();
+
+    // Frees the blocks cached by the calling thread
+    static void releaseThreadCache();
+};
@@ -21,12 +21,35 @@ public:
     void setMotor(bool motor);
     void simulateFriction();
 
+    // The body sleeps until a contact or a force wakes it up
+    void sleep();
+
+    // Changes the size of the tire and of its fixture
+    void reshape(float32 w, float32 h);
+
+    // A recyclable tire keeps its body when it dies, for its car to reuse
+    void setRecyclable(bool recyclable);
+    void rearm(b2Vec2 const & pos, float32 angle);
+
+    // Same physics on a bare tire body, for cars without Tire objects
+    static void applyAcceleration(b2Body * body, float32 power);
+    static void applyFriction(b2Body * body);
+
 protected:
     b2Vec2 getForwardVelocity() const;
     b2Vec2 getLateralVelocity() const;
 
+    virtual void define(DrawableDef & def) const override;
+    virtual bool recycle() override;
+
 protected:
+    // Pose and size the body is created with. define() runs when the world
+    // adds the tire, after construction; rearm and reshape update them:
+    // 20 bytes, where a kept DrawableDef takes 264.
+    b2Vec2 m_initPos;
+    float32 m_initAngle;
     float32 m_width;
     float32 m_height;
     bool m_motor;
+    bool m_recyclable;
 };
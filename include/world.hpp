@@ -4,10 +4,22 @@
 
 #include <Box2D/Box2D.h>
 #include <memory>
+#include <vector>
 
+#include <arena.hpp>
+#include <distancefield.hpp>
+#include <obstaclegenerator.hpp>
+#include <statictree.hpp>
+#include <stats.hpp>
 
+struct CarDef;
+class CarFleet;
+class Clock;
 class Drawable;
-class RaycastCallback;
+class RayFan;
+class SensorTable;
+class SensorTracker;
+class Snapshot;
 
 #if CAR_PHYSICS_GRAPHIC_MODE_SFML
 class Renderer;
@@ -30,27 +42,174 @@ public:
 
     ~World();
 
+    // Builds a drawable (or fleet) in the memory of the world. It still has
+    // to be added. Objects keep that memory alive, they may outlive the world.
+    template <typename T, typename... Args>
+    std::shared_ptr<T> create(Args &&... args);
+
+    Arena const & getArena() const;
+
     void addDrawable(std::shared_ptr<Drawable> d);
     void addRequiredDrawable(std::shared_ptr<Drawable> d);
 
+    // Adds back a dead drawable that kept its body (see Drawable::recycle),
+    // once reactivated
+    void addRecycledDrawable(std::shared_ptr<Drawable> d, bool required = false);
+
+    // A required fleet keeps the world running while one of its cars is alive
+    void addFleet(std::shared_ptr<CarFleet> fleet, bool required = true);
+
+    // Runs in real time with rendering, or 5000 steps when headless
     void run();
 
+    // Runs with the given stepping policy, until it stops or every required
+    // drawable died. Renders if there is a renderer. Returns the number of steps.
+    uint64_t run(Clock & clock);
+
+    // Simulate at most maxSteps steps as fast as possible.
+    // Returns the number of steps done.
+    uint32_t simulate(uint32_t maxSteps);
+
+    // Update drawables, remove dead ones and step the physics once
+    void step();
+
+    // True as long as at least one required drawable is alive
+    bool isRunning() const;
+
+    // Box2D timings of the last physics step, in milliseconds
+    b2Profile const & getProfile() const;
+
+    // Solves the islands (a car and its tires, when alone) on the OpenMP
+    // threads, same results as serially. On by default.
+    void setParallelIslands(bool enabled);
+
+    // Solves the contacts of large islands with SIMD, several at a time.
+    // They are reordered, results differ slightly from the scalar solver.
+    // Off by default, to be chosen before the first step.
+    void setWideContactSolver(bool enabled);
+
+    // Sensor rays test the static fixture they hit last step first, see
+    // SensorTracker: exact, and fewer nodes to walk. Off by default.
+    void setSensorTracking(bool enabled);
+
+    // Per phase timings and counters, aggregated over the steps since
+    // creation or the last resetStats. Empty if built without CAR_PHYSICS_STATS.
+    Stats const & stats() const;
+    void resetStats();
+
+    // Recording side, for the drawables and fleets (they get a const World)
+    Stats * getRecorder() const;
+
+    // Saves bodies, joints, contacts and sensors, between two steps.
+    // From the first snapshot on, dead drawables and cars are deactivated
+    // instead of destroyed, so that restoring creates nothing.
+    void snapshot(Snapshot & s);
+
+    // Puts the world back in the state of a snapshot it took. Drawables
+    // added since are removed, no fleet nor fleet car may have been added.
+    // Sensor trackers are not saved but reset: the first fans walk the
+    // static geometry again. Tracked hits are exact, replays sense the same.
+    void restore(Snapshot const & s);
+
     b2Joint * createJoint(b2RevoluteJointDef * jointDef);
 
-    void rayCast(RaycastCallback * cb, b2Vec2 const & p1, b2Vec2 const & p2) const;
+    // Both query the dynamic tree and the baked static geometry
+    void rayCast(b2RayCastCallback * cb, b2Vec2 const & p1, b2Vec2 const & p2) const;
+    void rayCast(RayFan * fan) const;
+
+    // Same, for the fan of a car of this body angle: where the sensor table
+    // covers it, the static geometry is looked up instead of cast. The fan
+    // must be of the ray set of the table (see SensorTable::matches).
+    void rayCast(RayFan * fan, float32 angle) const;
+
+    // Same as rayCast(fan), with the tracker of the car when sensor tracking
+    // is on: the static fixture each ray hit last is cast first, same hits.
+    void rayCast(RayFan * fan, SensorTracker * tracker) const;
+
+    // Copies the fixtures of every static body into a read-only tree, for
+    // the distance field, the sensor table and sensor tracking. Baked bodies
+    // stay in the broad-phase: they make contacts and plain ray casts find
+    // them there, as in the unbaked world.
+    // With deactivate, they leave the broad-phase, which then only holds
+    // moving bodies, and ray casts walk the tree instead. They no longer
+    // make contacts: cars find them with overlapsStaticGeometry, nothing
+    // else does. Static bodies added later are baked by calling it again, in
+    // the same mode.
+    void bakeStaticGeometry(bool deactivate = false);
+
+    // True if the baked bodies were deactivated: contacts with them are not
+    // reported, overlapsStaticGeometry finds them
+    bool isStaticGeometryDeactivated() const;
+
+    // True if a fixture of the body overlaps a baked static fixture
+    bool overlapsStaticGeometry(b2Body const * body) const;
+
+    StaticTree const & getStaticTree() const;
+
+    // Bakes the static geometry and samples its distance field every
+    // cellSize, the sensor fans then sphere trace it up to the geometry and
+    // only walk the tree from there: same hits, worth it on crowded tracks
+    // only. The field follows the static tree when it is built again, 0
+    // drops it.
+    void bakeDistanceField(float32 cellSize);
+
+    DistanceField const & getDistanceField() const;
+
+    // Sensor fractions of the static geometry, for the cars of its ray set
+    // that ask for it (CarDef::sensorTable). It must come from the current
+    // static tree. Worlds of the same map can share one, nullptr drops it.
+    // Lookups are approximate: check SensorTable::measure before using one.
+    void setSensorTable(std::shared_ptr<SensorTable const> table);
+    SensorTable const * getSensorTable() const;
 
     void addBorders(uint32_t width, uint32_t height);
 
     void randomize(uint32_t width, uint32_t height, uint32_t nbObstacles, uint32_t seed=0);
 
-    bool willCollide(std::shared_ptr<Drawable> d);
+    // Adds the boxes of the generator. Baked ones go into the static tree,
+    // built once at the end. Only when baked bodies are deactivated do they
+    // skip the broad-phase, for a one-pass build.
+    ObstacleGenerator::Rejections randomize(ObstacleDef const & def);
+
+    // True if a car of this definition, tires included, at its initial pose
+    // overlaps no fixture of the world nor the baked geometry. Only queries
+    // the world: nothing is created nor stepped.
+    bool isSpawnFree(CarDef const & def) const;
+
+    // Draws random poses, uniform in area and in angle, until count of them
+    // are free, from each other too, or maxTries were drawn (0: 100 per
+    // car). Returns def placed at each free pose, fewer than count if the
+    // area is too crowded. Seed 0 picks one from the time.
+    std::vector<CarDef> findSpawnPoses(
+        CarDef const & def, b2AABB const & area, uint32_t count, uint32_t seed = 0, uint32_t maxTries = 0
+    ) const;
 
 
 protected:
     void removeDrawables();
 
+    bool isBaked(b2Body const * body) const;
+
+    // Baked bodies still in the broad-phase, which its ray casts skip:
+    // nullptr when they are deactivated
+    std::vector<b2Body *> const * getActiveBakedBodies() const;
+
+    // Destroys the bodies of the queued drawables in one batch, or only
+    // deactivates them when kept for snapshots
+    void destroyQueuedBodies(bool keepBodies);
+    void buildStaticTree();
+
+    // Hits of the baked geometry, through the distance field if there is one
+    void castStaticGeometry(RayFan * fan) const;
+
+    // True if the shape overlaps a fixture of the world or the baked geometry
+    bool overlaps(b2Shape const * shape, b2Transform const & xf) const;
+
 
 protected:
+    // First, so that it goes last
+    std::shared_ptr<Arena> m_arena;
+
     b2World * m_world;
 
     int32 m_velocityIterations;
@@ -60,8 +219,40 @@ protected:
     std::vector<std::shared_ptr<Drawable>> m_drawableList;
     std::vector<std::shared_ptr<Drawable>> m_requiredDrawables;
 
+    std::vector<std::shared_ptr<CarFleet>> m_fleetList;
+    std::vector<std::shared_ptr<CarFleet>> m_requiredFleets;
+
+    // Baked static geometry, bodies sorted by address
+    StaticTree m_staticTree;
+    std::vector<b2Body *> m_bakedBodies;
+    bool m_deactivateBaked;
+
+    // Distance field of the static tree, for the sensor fans
+    DistanceField m_distanceField;
+    float32 m_distanceFieldCellSize;
+
+    std::shared_ptr<SensorTable const> m_sensorTable;
+
+    // See setSensorTracking
+    bool m_sensorTracking;
+
+    mutable Stats m_stats;
+
+    // Dead drawables, waiting for the destruction of their bodies
+    std::vector<std::shared_ptr<Drawable>> m_destructionQueue;
+
+    // Once a snapshot was taken: every drawable added since, dead or alive
+    bool m_keepDeadBodies;
+    std::vector<std::shared_ptr<Drawable>> m_drawableHistory;
+
     #if CAR_PHYSICS_GRAPHIC_MODE_SFML
     Renderer * m_renderer;
     uint32_t m_frameRate;
     #endif
 };
+
+template <typename T, typename... Args>
+std::shared_ptr<T> World::create(Args &&... args)
+{
+    return std::allocate_shared<T>(ArenaAllocator<T>(m_arena), std::forward<Args>(args)...);
+}
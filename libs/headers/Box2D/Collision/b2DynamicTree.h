@@ -101,6 +101,12 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
+	/// Traverse the tree with a custom node test. The callback decides for each node
+	/// if its sub-tree is visited (TraverseNode) and is called for each visited proxy
+	/// (TraverseProxy). Used to query several rays at once.
+	template <typename T>
+	void Traverse(T* callback) const;
+
 	/// Validate this tree. For testing.
 	void Validate() const;
 
@@ -286,4 +292,41 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 	}
 }
 
+template <typename T>
+inline void b2DynamicTree::Traverse(T* callback) const
+{
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		if (nodeId == b2_nullNode)
+		{
+			continue;
+		}
+
+		const b2TreeNode* node = m_nodes + nodeId;
+
+		if (callback->TraverseNode(node->aabb) == false)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			bool proceed = callback->TraverseProxy(nodeId);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+		else
+		{
+			stack.Push(node->child1);
+			stack.Push(node->child2);
+		}
+	}
+}
+
 #endif
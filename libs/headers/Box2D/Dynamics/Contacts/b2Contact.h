@@ -89,6 +89,10 @@ public:
 	/// Is this contact touching?
 	bool IsTouching() const;
 
+	/// Set the touching state, with the manifold, to restore a saved contact.
+	/// It is updated by the next time step.
+	void SetTouching(bool flag);
+
 	/// Enable/disable this contact. This can be used inside the pre-solve
 	/// contact listener. The contact is only disabled for the current
 	/// time step (or sub-step in continuous collisions).
@@ -261,6 +265,18 @@ inline bool b2Contact::IsTouching() const
 	return (m_flags & e_touchingFlag) == e_touchingFlag;
 }
 
+inline void b2Contact::SetTouching(bool flag)
+{
+	if (flag)
+	{
+		m_flags |= e_touchingFlag;
+	}
+	else
+	{
+		m_flags &= ~e_touchingFlag;
+	}
+}
+
 inline b2Contact* b2Contact::GetNext()
 {
 	return m_next;
@@ -24,6 +24,15 @@
 #include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Common/b2StackAllocator.h>
 
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define B2_DEBUG_SOLVER 0
 
 bool g_blockSolve = true;
@@ -43,6 +52,285 @@ struct b2ContactPositionConstraint
 	int32 pointCount;
 };
 
+// Wide solver: SIMD over the contacts, b2_wideLanes at a time. A lane holds
+// the velocity constraint of one contact, laid out as structures of arrays.
+#if defined(__AVX__)
+
+#define b2_wideLanes 8
+
+typedef __m256 b2FloatW;
+
+static inline b2FloatW b2SplatW(float32 a) { return _mm256_set1_ps(a); }
+static inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm256_add_ps(a, b); }
+static inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm256_sub_ps(a, b); }
+static inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm256_mul_ps(a, b); }
+static inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm256_min_ps(a, b); }
+static inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm256_max_ps(a, b); }
+static inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return _mm256_and_ps(a, b); }
+static inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b) { return _mm256_blendv_ps(b, a, mask); }
+
+#elif defined(__SSE2__)
+
+#define b2_wideLanes 4
+
+typedef __m128 b2FloatW;
+
+static inline b2FloatW b2SplatW(float32 a) { return _mm_set1_ps(a); }
+static inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm_add_ps(a, b); }
+static inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm_sub_ps(a, b); }
+static inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm_mul_ps(a, b); }
+static inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm_min_ps(a, b); }
+static inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm_max_ps(a, b); }
+static inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return _mm_cmpge_ps(a, b); }
+static inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return _mm_and_ps(a, b); }
+static inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+#else
+
+// Portable fallback, masks are 1 or 0
+#define b2_wideLanes 4
+
+struct b2FloatW
+{
+	float32 x[b2_wideLanes];
+};
+
+static inline b2FloatW b2SplatW(float32 a) { b2FloatW r; for (int32 i = 0; i < b2_wideLanes; ++i) r.x[i] = a; return r; }
+static inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { b2FloatW r; for (int32 i = 0; i < b2_wideLanes; ++i) r.x[i] = a.x[i] + b.x[i]; return r; }
+static inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { b2FloatW r; for (int32 i = 0; i < b2_wideLanes; ++i) r.x[i] = a.x[i] - b.x[i]; return r; }
+static inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { b2FloatW r; for (int32 i = 0; i < b2_wideLanes; ++i) r.x[i] = a.x[i] * b.x[i]; return r; }
+static inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { b2FloatW r; for (int32 i = 0; i < b2_wideLanes; ++i) r.x[i] = b2Min(a.x[i], b.x[i]); return r; }
+static inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { b2FloatW r; for (int32 i = 0; i < b2_wideLanes; ++i) r.x[i] = b2Max(a.x[i], b.x[i]); return r; }
+static inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { b2FloatW r; for (int32 i = 0; i < b2_wideLanes; ++i) r.x[i] = a.x[i] >= b.x[i] ? 1.0f : 0.0f; return r; }
+static inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return b2MulW(a, b); }
+static inline b2FloatW b2SelectW(b2FloatW mask, b2FloatW a, b2FloatW b) { b2FloatW r; for (int32 i = 0; i < b2_wideLanes; ++i) r.x[i] = mask.x[i] > 0.0f ? a.x[i] : b.x[i]; return r; }
+
+#endif
+
+// Same as the unary minus, zeros included
+static inline b2FloatW b2NegW(b2FloatW a)
+{
+	return b2MulW(b2SplatW(-1.0f), a);
+}
+
+static inline float32& b2LaneW(b2FloatW& a, int32 lane)
+{
+	return ((float32*)&a)[lane];
+}
+
+// Islands with fewer contacts use the scalar solver.
+const int32 b2_minWideContacts = 2 * b2_wideLanes;
+
+// Colors of the graph coloring, one bit each. Contacts that find no color
+// are solved by the scalar solver.
+const int32 b2_maxWideColors = 32;
+
+struct b2WideVelocityConstraintPoint
+{
+	b2FloatW rAx, rAy;
+	b2FloatW rBx, rBy;
+	b2FloatW normalImpulse;
+	b2FloatW tangentImpulse;
+	b2FloatW normalMass;
+	b2FloatW tangentMass;
+	b2FloatW velocityBias;
+};
+
+// Lanes of a constraint never share a dynamic body. Empty lanes have no
+// mass and act on m_emptyLane.
+struct b2WideVelocityConstraint
+{
+	b2WideVelocityConstraintPoint points[b2_maxManifoldPoints];
+	b2FloatW normalx, normaly;
+	b2FloatW k11, k12, k22;						// K, symmetric
+	b2FloatW normalMass11, normalMass12, normalMass22;	// Its inverse
+	b2FloatW invMassA, invMassB;
+	b2FloatW invIA, invIB;
+	b2FloatW friction;
+	b2FloatW tangentSpeed;
+	b2Velocity* velocityA[b2_wideLanes];
+	b2Velocity* velocityB[b2_wideLanes];
+	int32 constraintIndex[b2_wideLanes];	// -1 for an empty lane
+	int32 pointCount;						// The same for every lane
+};
+
+// b2SolveVelocityConstraint, lane wise. The operations are the ones of the
+// scalar solver in the same order.
+static void b2SolveWideVelocityConstraint(b2WideVelocityConstraint* c)
+{
+	b2FloatW vAx, vAy, wA, vBx, vBy, wB;
+	for (int32 lane = 0; lane < b2_wideLanes; ++lane)
+	{
+		const b2Velocity* velocityA = c->velocityA[lane];
+		const b2Velocity* velocityB = c->velocityB[lane];
+		b2LaneW(vAx, lane) = velocityA->v.x;
+		b2LaneW(vAy, lane) = velocityA->v.y;
+		b2LaneW(wA, lane) = velocityA->w;
+		b2LaneW(vBx, lane) = velocityB->v.x;
+		b2LaneW(vBy, lane) = velocityB->v.y;
+		b2LaneW(wB, lane) = velocityB->w;
+	}
+
+	b2FloatW mA = c->invMassA;
+	b2FloatW iA = c->invIA;
+	b2FloatW mB = c->invMassB;
+	b2FloatW iB = c->invIB;
+
+	b2FloatW normalx = c->normalx;
+	b2FloatW normaly = c->normaly;
+	b2FloatW tangentx = normaly;
+	b2FloatW tangenty = b2NegW(normalx);
+	b2FloatW friction = c->friction;
+	b2FloatW zero = b2SplatW(0.0f);
+
+	int32 pointCount = c->pointCount;
+
+	// Tangent constraints first
+	for (int32 j = 0; j < pointCount; ++j)
+	{
+		b2WideVelocityConstraintPoint* cp = c->points + j;
+
+		b2FloatW dvx = b2AddW(b2SubW(b2SubW(vBx, b2MulW(wB, cp->rBy)), vAx), b2MulW(wA, cp->rAy));
+		b2FloatW dvy = b2SubW(b2SubW(b2AddW(vBy, b2MulW(wB, cp->rBx)), vAy), b2MulW(wA, cp->rAx));
+
+		b2FloatW vt = b2SubW(b2AddW(b2MulW(dvx, tangentx), b2MulW(dvy, tangenty)), c->tangentSpeed);
+		b2FloatW lambda = b2MulW(cp->tangentMass, b2NegW(vt));
+
+		b2FloatW maxFriction = b2MulW(friction, cp->normalImpulse);
+		b2FloatW newImpulse = b2MaxW(b2NegW(maxFriction), b2MinW(b2AddW(cp->tangentImpulse, lambda), maxFriction));
+		lambda = b2SubW(newImpulse, cp->tangentImpulse);
+		cp->tangentImpulse = newImpulse;
+
+		b2FloatW Px = b2MulW(lambda, tangentx);
+		b2FloatW Py = b2MulW(lambda, tangenty);
+
+		vAx = b2SubW(vAx, b2MulW(mA, Px));
+		vAy = b2SubW(vAy, b2MulW(mA, Py));
+		wA = b2SubW(wA, b2MulW(iA, b2SubW(b2MulW(cp->rAx, Py), b2MulW(cp->rAy, Px))));
+
+		vBx = b2AddW(vBx, b2MulW(mB, Px));
+		vBy = b2AddW(vBy, b2MulW(mB, Py));
+		wB = b2AddW(wB, b2MulW(iB, b2SubW(b2MulW(cp->rBx, Py), b2MulW(cp->rBy, Px))));
+	}
+
+	if (pointCount == 1)
+	{
+		b2WideVelocityConstraintPoint* cp = c->points;
+
+		b2FloatW dvx = b2AddW(b2SubW(b2SubW(vBx, b2MulW(wB, cp->rBy)), vAx), b2MulW(wA, cp->rAy));
+		b2FloatW dvy = b2SubW(b2SubW(b2AddW(vBy, b2MulW(wB, cp->rBx)), vAy), b2MulW(wA, cp->rAx));
+
+		b2FloatW vn = b2AddW(b2MulW(dvx, normalx), b2MulW(dvy, normaly));
+		b2FloatW lambda = b2MulW(b2NegW(cp->normalMass), b2SubW(vn, cp->velocityBias));
+
+		b2FloatW newImpulse = b2MaxW(b2AddW(cp->normalImpulse, lambda), zero);
+		lambda = b2SubW(newImpulse, cp->normalImpulse);
+		cp->normalImpulse = newImpulse;
+
+		b2FloatW Px = b2MulW(lambda, normalx);
+		b2FloatW Py = b2MulW(lambda, normaly);
+
+		vAx = b2SubW(vAx, b2MulW(mA, Px));
+		vAy = b2SubW(vAy, b2MulW(mA, Py));
+		wA = b2SubW(wA, b2MulW(iA, b2SubW(b2MulW(cp->rAx, Py), b2MulW(cp->rAy, Px))));
+
+		vBx = b2AddW(vBx, b2MulW(mB, Px));
+		vBy = b2AddW(vBy, b2MulW(mB, Py));
+		wB = b2AddW(wB, b2MulW(iB, b2SubW(b2MulW(cp->rBx, Py), b2MulW(cp->rBy, Px))));
+	}
+	else
+	{
+		// Block solver, every case is evaluated and the first valid one
+		// is selected per lane. No valid case leaves the impulses as they are.
+		b2WideVelocityConstraintPoint* cp1 = c->points + 0;
+		b2WideVelocityConstraintPoint* cp2 = c->points + 1;
+
+		b2FloatW ax = cp1->normalImpulse;
+		b2FloatW ay = cp2->normalImpulse;
+
+		b2FloatW dv1x = b2AddW(b2SubW(b2SubW(vBx, b2MulW(wB, cp1->rBy)), vAx), b2MulW(wA, cp1->rAy));
+		b2FloatW dv1y = b2SubW(b2SubW(b2AddW(vBy, b2MulW(wB, cp1->rBx)), vAy), b2MulW(wA, cp1->rAx));
+		b2FloatW dv2x = b2AddW(b2SubW(b2SubW(vBx, b2MulW(wB, cp2->rBy)), vAx), b2MulW(wA, cp2->rAy));
+		b2FloatW dv2y = b2SubW(b2SubW(b2AddW(vBy, b2MulW(wB, cp2->rBx)), vAy), b2MulW(wA, cp2->rAx));
+
+		b2FloatW vn1 = b2AddW(b2MulW(dv1x, normalx), b2MulW(dv1y, normaly));
+		b2FloatW vn2 = b2AddW(b2MulW(dv2x, normalx), b2MulW(dv2y, normaly));
+
+		// b' = b - K * a
+		b2FloatW bx = b2SubW(vn1, cp1->velocityBias);
+		b2FloatW by = b2SubW(vn2, cp2->velocityBias);
+		bx = b2SubW(bx, b2AddW(b2MulW(c->k11, ax), b2MulW(c->k12, ay)));
+		by = b2SubW(by, b2AddW(b2MulW(c->k12, ax), b2MulW(c->k22, ay)));
+
+		// Case 1: vn = 0
+		b2FloatW x1x = b2NegW(b2AddW(b2MulW(c->normalMass11, bx), b2MulW(c->normalMass12, by)));
+		b2FloatW x1y = b2NegW(b2AddW(b2MulW(c->normalMass12, bx), b2MulW(c->normalMass22, by)));
+		b2FloatW valid1 = b2AndW(b2GreaterEqualW(x1x, zero), b2GreaterEqualW(x1y, zero));
+
+		// Case 2: vn1 = 0 and x2 = 0
+		b2FloatW x2x = b2MulW(b2NegW(cp1->normalMass), bx);
+		b2FloatW vn2Case2 = b2AddW(b2MulW(c->k12, x2x), by);
+		b2FloatW valid2 = b2AndW(b2GreaterEqualW(x2x, zero), b2GreaterEqualW(vn2Case2, zero));
+
+		// Case 3: vn2 = 0 and x1 = 0
+		b2FloatW x3y = b2MulW(b2NegW(cp2->normalMass), by);
+		b2FloatW vn1Case3 = b2AddW(b2MulW(c->k12, x3y), bx);
+		b2FloatW valid3 = b2AndW(b2GreaterEqualW(x3y, zero), b2GreaterEqualW(vn1Case3, zero));
+
+		// Case 4: x1 = 0 and x2 = 0
+		b2FloatW valid4 = b2AndW(b2GreaterEqualW(bx, zero), b2GreaterEqualW(by, zero));
+
+		b2FloatW xx = b2SelectW(valid4, zero, ax);
+		b2FloatW xy = b2SelectW(valid4, zero, ay);
+		xx = b2SelectW(valid3, zero, xx);
+		xy = b2SelectW(valid3, x3y, xy);
+		xx = b2SelectW(valid2, x2x, xx);
+		xy = b2SelectW(valid2, zero, xy);
+		xx = b2SelectW(valid1, x1x, xx);
+		xy = b2SelectW(valid1, x1y, xy);
+
+		b2FloatW dx = b2SubW(xx, ax);
+		b2FloatW dy = b2SubW(xy, ay);
+
+		b2FloatW P1x = b2MulW(dx, normalx);
+		b2FloatW P1y = b2MulW(dx, normaly);
+		b2FloatW P2x = b2MulW(dy, normalx);
+		b2FloatW P2y = b2MulW(dy, normaly);
+
+		vAx = b2SubW(vAx, b2MulW(mA, b2AddW(P1x, P2x)));
+		vAy = b2SubW(vAy, b2MulW(mA, b2AddW(P1y, P2y)));
+		wA = b2SubW(wA, b2MulW(iA, b2AddW(
+			b2SubW(b2MulW(cp1->rAx, P1y), b2MulW(cp1->rAy, P1x)),
+			b2SubW(b2MulW(cp2->rAx, P2y), b2MulW(cp2->rAy, P2x)))));
+
+		vBx = b2AddW(vBx, b2MulW(mB, b2AddW(P1x, P2x)));
+		vBy = b2AddW(vBy, b2MulW(mB, b2AddW(P1y, P2y)));
+		wB = b2AddW(wB, b2MulW(iB, b2AddW(
+			b2SubW(b2MulW(cp1->rBx, P1y), b2MulW(cp1->rBy, P1x)),
+			b2SubW(b2MulW(cp2->rBx, P2y), b2MulW(cp2->rBy, P2x)))));
+
+		cp1->normalImpulse = xx;
+		cp2->normalImpulse = xy;
+	}
+
+	// Static bodies may be shared by lanes, their velocity is unchanged
+	for (int32 lane = 0; lane < b2_wideLanes; ++lane)
+	{
+		b2Velocity* velocityA = c->velocityA[lane];
+		velocityA->v.x = b2LaneW(vAx, lane);
+		velocityA->v.y = b2LaneW(vAy, lane);
+		velocityA->w = b2LaneW(wA, lane);
+	}
+	for (int32 lane = 0; lane < b2_wideLanes; ++lane)
+	{
+		b2Velocity* velocityB = c->velocityB[lane];
+		velocityB->v.x = b2LaneW(vBx, lane);
+		velocityB->v.y = b2LaneW(vBy, lane);
+		velocityB->w = b2LaneW(wB, lane);
+	}
+}
+
 b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 {
 	m_step = def->step;
@@ -54,6 +342,16 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
 
+	// The wide block solver has no sequential variant
+	m_wide = m_step.wideContactSolver && g_blockSolve && m_count >= b2_minWideContacts;
+	m_wideMemory = NULL;
+	m_wideConstraints = NULL;
+	m_wideCount = 0;
+	m_scalarConstraints = NULL;
+	m_scalarCount = 0;
+	m_emptyLane.v.SetZero();
+	m_emptyLane.w = 0.0f;
+
 	// Initialize position independent portions of the constraints.
 	for (int32 i = 0; i < m_count; ++i)
 	{
@@ -132,6 +430,11 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_wideMemory)
+	{
+		m_allocator->Free(m_wideMemory);
+		m_allocator->Free(m_scalarConstraints);
+	}
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
@@ -246,6 +549,162 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			}
 		}
 	}
+
+	if (m_wide)
+	{
+		PrepareWideConstraints();
+	}
+}
+
+// Greedy graph coloring: a contact takes the first color none of its dynamic
+// bodies has yet. Each color is split in constraints of b2_wideLanes
+// contacts with the same point count, in the order of the contacts.
+void b2ContactSolver::PrepareWideConstraints()
+{
+	m_scalarConstraints = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+	int32* colors = m_scalarConstraints;
+
+	int32 bodyCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		bodyCount = b2Max(bodyCount, b2Max(vc->indexA, vc->indexB) + 1);
+	}
+
+	uint32* bodyColors = (uint32*)m_allocator->Allocate(bodyCount * sizeof(uint32));
+	memset(bodyColors, 0, bodyCount * sizeof(uint32));
+
+	int32 colorCounts[b2_maxWideColors][b2_maxManifoldPoints];
+	memset(colorCounts, 0, sizeof(colorCounts));
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		bool dynamicA = vc->invMassA > 0.0f || vc->invIA > 0.0f;
+		bool dynamicB = vc->invMassB > 0.0f || vc->invIB > 0.0f;
+
+		uint32 used = 0;
+		if (dynamicA)
+		{
+			used |= bodyColors[vc->indexA];
+		}
+		if (dynamicB)
+		{
+			used |= bodyColors[vc->indexB];
+		}
+
+		colors[i] = -1;
+		for (int32 color = 0; color < b2_maxWideColors; ++color)
+		{
+			uint32 bit = 1u << color;
+			if ((used & bit) == 0)
+			{
+				if (dynamicA)
+				{
+					bodyColors[vc->indexA] |= bit;
+				}
+				if (dynamicB)
+				{
+					bodyColors[vc->indexB] |= bit;
+				}
+				colors[i] = color;
+				++colorCounts[color][vc->pointCount - 1];
+				break;
+			}
+		}
+	}
+
+	m_allocator->Free(bodyColors);
+
+	// First slot of each group, two point contacts first in a color
+	int32 slots[b2_maxWideColors][b2_maxManifoldPoints];
+	m_wideCount = 0;
+	for (int32 color = 0; color < b2_maxWideColors; ++color)
+	{
+		for (int32 j = b2_maxManifoldPoints - 1; j >= 0; --j)
+		{
+			slots[color][j] = m_wideCount * b2_wideLanes;
+			m_wideCount += (colorCounts[color][j] + b2_wideLanes - 1) / b2_wideLanes;
+		}
+	}
+
+	// Constraints are aligned for the SIMD loads
+	int32 alignment = sizeof(b2FloatW);
+	m_wideMemory = m_allocator->Allocate(m_wideCount * sizeof(b2WideVelocityConstraint) + alignment);
+	uintptr_t address = ((uintptr_t)m_wideMemory + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	m_wideConstraints = (b2WideVelocityConstraint*)address;
+	memset(m_wideConstraints, 0, m_wideCount * sizeof(b2WideVelocityConstraint));
+
+	for (int32 color = 0; color < b2_maxWideColors; ++color)
+	{
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			int32 first = slots[color][j] / b2_wideLanes;
+			int32 last = first + (colorCounts[color][j] + b2_wideLanes - 1) / b2_wideLanes;
+			for (int32 k = first; k < last; ++k)
+			{
+				b2WideVelocityConstraint* c = m_wideConstraints + k;
+				c->pointCount = j + 1;
+				for (int32 lane = 0; lane < b2_wideLanes; ++lane)
+				{
+					c->velocityA[lane] = &m_emptyLane;
+					c->velocityB[lane] = &m_emptyLane;
+					c->constraintIndex[lane] = -1;
+				}
+			}
+		}
+	}
+
+	m_scalarCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		int32 color = colors[i];
+		if (color < 0)
+		{
+			// Overwrites colors already read, m_scalarCount <= i
+			m_scalarConstraints[m_scalarCount++] = i;
+			continue;
+		}
+
+		int32 slot = slots[color][vc->pointCount - 1]++;
+		b2WideVelocityConstraint* c = m_wideConstraints + slot / b2_wideLanes;
+		int32 lane = slot % b2_wideLanes;
+
+		c->velocityA[lane] = m_velocities + vc->indexA;
+		c->velocityB[lane] = m_velocities + vc->indexB;
+		c->constraintIndex[lane] = i;
+
+		b2LaneW(c->normalx, lane) = vc->normal.x;
+		b2LaneW(c->normaly, lane) = vc->normal.y;
+		b2LaneW(c->k11, lane) = vc->K.ex.x;
+		b2LaneW(c->k12, lane) = vc->K.ex.y;
+		b2LaneW(c->k22, lane) = vc->K.ey.y;
+		b2LaneW(c->normalMass11, lane) = vc->normalMass.ex.x;
+		b2LaneW(c->normalMass12, lane) = vc->normalMass.ex.y;
+		b2LaneW(c->normalMass22, lane) = vc->normalMass.ey.y;
+		b2LaneW(c->invMassA, lane) = vc->invMassA;
+		b2LaneW(c->invMassB, lane) = vc->invMassB;
+		b2LaneW(c->invIA, lane) = vc->invIA;
+		b2LaneW(c->invIB, lane) = vc->invIB;
+		b2LaneW(c->friction, lane) = vc->friction;
+		b2LaneW(c->tangentSpeed, lane) = vc->tangentSpeed;
+
+		for (int32 j = 0; j < vc->pointCount; ++j)
+		{
+			b2VelocityConstraintPoint* vcp = vc->points + j;
+			b2WideVelocityConstraintPoint* cp = c->points + j;
+			b2LaneW(cp->rAx, lane) = vcp->rA.x;
+			b2LaneW(cp->rAy, lane) = vcp->rA.y;
+			b2LaneW(cp->rBx, lane) = vcp->rB.x;
+			b2LaneW(cp->rBy, lane) = vcp->rB.y;
+			b2LaneW(cp->normalImpulse, lane) = vcp->normalImpulse;
+			b2LaneW(cp->tangentImpulse, lane) = vcp->tangentImpulse;
+			b2LaneW(cp->normalMass, lane) = vcp->normalMass;
+			b2LaneW(cp->tangentMass, lane) = vcp->tangentMass;
+			b2LaneW(cp->velocityBias, lane) = vcp->velocityBias;
+		}
+	}
 }
 
 void b2ContactSolver::WarmStart()
@@ -288,321 +747,358 @@ void b2ContactSolver::WarmStart()
 	}
 }
 
-void b2ContactSolver::SolveVelocityConstraints()
+static void b2SolveVelocityConstraint(b2ContactVelocityConstraint* vc, b2Velocity* velocities)
 {
-	for (int32 i = 0; i < m_count; ++i)
+	int32 indexA = vc->indexA;
+	int32 indexB = vc->indexB;
+	float32 mA = vc->invMassA;
+	float32 iA = vc->invIA;
+	float32 mB = vc->invMassB;
+	float32 iB = vc->invIB;
+	int32 pointCount = vc->pointCount;
+
+	b2Vec2 vA = velocities[indexA].v;
+	float32 wA = velocities[indexA].w;
+	b2Vec2 vB = velocities[indexB].v;
+	float32 wB = velocities[indexB].w;
+
+	b2Vec2 normal = vc->normal;
+	b2Vec2 tangent = b2Cross(normal, 1.0f);
+	float32 friction = vc->friction;
+
+	b2Assert(pointCount == 1 || pointCount == 2);
+
+	// Solve tangent constraints first because non-penetration is more important
+	// than friction.
+	for (int32 j = 0; j < pointCount; ++j)
 	{
-		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		b2VelocityConstraintPoint* vcp = vc->points + j;
 
-		int32 indexA = vc->indexA;
-		int32 indexB = vc->indexB;
-		float32 mA = vc->invMassA;
-		float32 iA = vc->invIA;
-		float32 mB = vc->invMassB;
-		float32 iB = vc->invIB;
-		int32 pointCount = vc->pointCount;
+		// Relative velocity at contact
+		b2Vec2 dv = vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA);
 
-		b2Vec2 vA = m_velocities[indexA].v;
-		float32 wA = m_velocities[indexA].w;
-		b2Vec2 vB = m_velocities[indexB].v;
-		float32 wB = m_velocities[indexB].w;
+		// Compute tangent force
+		float32 vt = b2Dot(dv, tangent) - vc->tangentSpeed;
+		float32 lambda = vcp->tangentMass * (-vt);
 
-		b2Vec2 normal = vc->normal;
-		b2Vec2 tangent = b2Cross(normal, 1.0f);
-		float32 friction = vc->friction;
+		// b2Clamp the accumulated force
+		float32 maxFriction = friction * vcp->normalImpulse;
+		float32 newImpulse = b2Clamp(vcp->tangentImpulse + lambda, -maxFriction, maxFriction);
+		lambda = newImpulse - vcp->tangentImpulse;
+		vcp->tangentImpulse = newImpulse;
 
-		b2Assert(pointCount == 1 || pointCount == 2);
+		// Apply contact impulse
+		b2Vec2 P = lambda * tangent;
 
-		// Solve tangent constraints first because non-penetration is more important
-		// than friction.
-		for (int32 j = 0; j < pointCount; ++j)
+		vA -= mA * P;
+		wA -= iA * b2Cross(vcp->rA, P);
+
+		vB += mB * P;
+		wB += iB * b2Cross(vcp->rB, P);
+	}
+
+	// Solve normal constraints
+	if (pointCount == 1 || g_blockSolve == false)
+	{
+		for (int32 i = 0; i < pointCount; ++i)
 		{
-			b2VelocityConstraintPoint* vcp = vc->points + j;
+			b2VelocityConstraintPoint* vcp = vc->points + i;
 
 			// Relative velocity at contact
 			b2Vec2 dv = vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA);
 
-			// Compute tangent force
-			float32 vt = b2Dot(dv, tangent) - vc->tangentSpeed;
-			float32 lambda = vcp->tangentMass * (-vt);
+			// Compute normal impulse
+			float32 vn = b2Dot(dv, normal);
+			float32 lambda = -vcp->normalMass * (vn - vcp->velocityBias);
 
-			// b2Clamp the accumulated force
-			float32 maxFriction = friction * vcp->normalImpulse;
-			float32 newImpulse = b2Clamp(vcp->tangentImpulse + lambda, -maxFriction, maxFriction);
-			lambda = newImpulse - vcp->tangentImpulse;
-			vcp->tangentImpulse = newImpulse;
+			// b2Clamp the accumulated impulse
+			float32 newImpulse = b2Max(vcp->normalImpulse + lambda, 0.0f);
+			lambda = newImpulse - vcp->normalImpulse;
+			vcp->normalImpulse = newImpulse;
 
 			// Apply contact impulse
-			b2Vec2 P = lambda * tangent;
-
+			b2Vec2 P = lambda * normal;
 			vA -= mA * P;
 			wA -= iA * b2Cross(vcp->rA, P);
 
 			vB += mB * P;
 			wB += iB * b2Cross(vcp->rB, P);
 		}
-
-		// Solve normal constraints
-		if (pointCount == 1 || g_blockSolve == false)
-		{
-			for (int32 i = 0; i < pointCount; ++i)
-			{
-				b2VelocityConstraintPoint* vcp = vc->points + i;
-
-				// Relative velocity at contact
-				b2Vec2 dv = vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA);
-
-				// Compute normal impulse
-				float32 vn = b2Dot(dv, normal);
-				float32 lambda = -vcp->normalMass * (vn - vcp->velocityBias);
-
-				// b2Clamp the accumulated impulse
-				float32 newImpulse = b2Max(vcp->normalImpulse + lambda, 0.0f);
-				lambda = newImpulse - vcp->normalImpulse;
-				vcp->normalImpulse = newImpulse;
-
-				// Apply contact impulse
-				b2Vec2 P = lambda * normal;
-				vA -= mA * P;
-				wA -= iA * b2Cross(vcp->rA, P);
-
-				vB += mB * P;
-				wB += iB * b2Cross(vcp->rB, P);
-			}
-		}
-		else
+	}
+	else
+	{
+		// Block solver developed in collaboration with Dirk Gregorius (back in 01/07 on Box2D_Lite).
+		// Build the mini LCP for this contact patch
+		//
+		// vn = A * x + b, vn >= 0, , vn >= 0, x >= 0 and vn_i * x_i = 0 with i = 1..2
+		//
+		// A = J * W * JT and J = ( -n, -r1 x n, n, r2 x n )
+		// b = vn0 - velocityBias
+		//
+		// The system is solved using the "Total enumeration method" (s. Murty). The complementary constraint vn_i * x_i
+		// implies that we must have in any solution either vn_i = 0 or x_i = 0. So for the 2D contact problem the cases
+		// vn1 = 0 and vn2 = 0, x1 = 0 and x2 = 0, x1 = 0 and vn2 = 0, x2 = 0 and vn1 = 0 need to be tested. The first valid
+		// solution that satisfies the problem is chosen.
+		// 
+		// In order to account of the accumulated impulse 'a' (because of the iterative nature of the solver which only requires
+		// that the accumulated impulse is clamped and not the incremental impulse) we change the impulse variable (x_i).
+		//
+		// Substitute:
+		// 
+		// x = a + d
+		// 
+		// a := old total impulse
+		// x := new total impulse
+		// d := incremental impulse 
+		//
+		// For the current iteration we extend the formula for the incremental impulse
+		// to compute the new total impulse:
+		//
+		// vn = A * d + b
+		//    = A * (x - a) + b
+		//    = A * x + b - A * a
+		//    = A * x + b'
+		// b' = b - A * a;
+
+		b2VelocityConstraintPoint* cp1 = vc->points + 0;
+		b2VelocityConstraintPoint* cp2 = vc->points + 1;
+
+		b2Vec2 a(cp1->normalImpulse, cp2->normalImpulse);
+		b2Assert(a.x >= 0.0f && a.y >= 0.0f);
+
+		// Relative velocity at contact
+		b2Vec2 dv1 = vB + b2Cross(wB, cp1->rB) - vA - b2Cross(wA, cp1->rA);
+		b2Vec2 dv2 = vB + b2Cross(wB, cp2->rB) - vA - b2Cross(wA, cp2->rA);
+
+		// Compute normal velocity
+		float32 vn1 = b2Dot(dv1, normal);
+		float32 vn2 = b2Dot(dv2, normal);
+
+		b2Vec2 b;
+		b.x = vn1 - cp1->velocityBias;
+		b.y = vn2 - cp2->velocityBias;
+
+		// Compute b'
+		b -= b2Mul(vc->K, a);
+
+		const float32 k_errorTol = 1e-3f;
+		B2_NOT_USED(k_errorTol);
+
+		for (;;)
 		{
-			// Block solver developed in collaboration with Dirk Gregorius (back in 01/07 on Box2D_Lite).
-			// Build the mini LCP for this contact patch
 			//
-			// vn = A * x + b, vn >= 0, , vn >= 0, x >= 0 and vn_i * x_i = 0 with i = 1..2
+			// Case 1: vn = 0
 			//
-			// A = J * W * JT and J = ( -n, -r1 x n, n, r2 x n )
-			// b = vn0 - velocityBias
+			// 0 = A * x + b'
 			//
-			// The system is solved using the "Total enumeration method" (s. Murty). The complementary constraint vn_i * x_i
-			// implies that we must have in any solution either vn_i = 0 or x_i = 0. So for the 2D contact problem the cases
-			// vn1 = 0 and vn2 = 0, x1 = 0 and x2 = 0, x1 = 0 and vn2 = 0, x2 = 0 and vn1 = 0 need to be tested. The first valid
-			// solution that satisfies the problem is chosen.
-			// 
-			// In order to account of the accumulated impulse 'a' (because of the iterative nature of the solver which only requires
-			// that the accumulated impulse is clamped and not the incremental impulse) we change the impulse variable (x_i).
-			//
-			// Substitute:
-			// 
-			// x = a + d
-			// 
-			// a := old total impulse
-			// x := new total impulse
-			// d := incremental impulse 
+			// Solve for x:
 			//
-			// For the current iteration we extend the formula for the incremental impulse
-			// to compute the new total impulse:
+			// x = - inv(A) * b'
 			//
-			// vn = A * d + b
-			//    = A * (x - a) + b
-			//    = A * x + b - A * a
-			//    = A * x + b'
-			// b' = b - A * a;
-
-			b2VelocityConstraintPoint* cp1 = vc->points + 0;
-			b2VelocityConstraintPoint* cp2 = vc->points + 1;
-
-			b2Vec2 a(cp1->normalImpulse, cp2->normalImpulse);
-			b2Assert(a.x >= 0.0f && a.y >= 0.0f);
-
-			// Relative velocity at contact
-			b2Vec2 dv1 = vB + b2Cross(wB, cp1->rB) - vA - b2Cross(wA, cp1->rA);
-			b2Vec2 dv2 = vB + b2Cross(wB, cp2->rB) - vA - b2Cross(wA, cp2->rA);
-
-			// Compute normal velocity
-			float32 vn1 = b2Dot(dv1, normal);
-			float32 vn2 = b2Dot(dv2, normal);
-
-			b2Vec2 b;
-			b.x = vn1 - cp1->velocityBias;
-			b.y = vn2 - cp2->velocityBias;
-
-			// Compute b'
-			b -= b2Mul(vc->K, a);
+			b2Vec2 x = - b2Mul(vc->normalMass, b);
 
-			const float32 k_errorTol = 1e-3f;
-			B2_NOT_USED(k_errorTol);
-
-			for (;;)
+			if (x.x >= 0.0f && x.y >= 0.0f)
 			{
-				//
-				// Case 1: vn = 0
-				//
-				// 0 = A * x + b'
-				//
-				// Solve for x:
-				//
-				// x = - inv(A) * b'
-				//
-				b2Vec2 x = - b2Mul(vc->normalMass, b);
-
-				if (x.x >= 0.0f && x.y >= 0.0f)
-				{
-					// Get the incremental impulse
-					b2Vec2 d = x - a;
+				// Get the incremental impulse
+				b2Vec2 d = x - a;
 
-					// Apply incremental impulse
-					b2Vec2 P1 = d.x * normal;
-					b2Vec2 P2 = d.y * normal;
-					vA -= mA * (P1 + P2);
-					wA -= iA * (b2Cross(cp1->rA, P1) + b2Cross(cp2->rA, P2));
+				// Apply incremental impulse
+				b2Vec2 P1 = d.x * normal;
+				b2Vec2 P2 = d.y * normal;
+				vA -= mA * (P1 + P2);
+				wA -= iA * (b2Cross(cp1->rA, P1) + b2Cross(cp2->rA, P2));
 
-					vB += mB * (P1 + P2);
-					wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
+				vB += mB * (P1 + P2);
+				wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
 
-					// Accumulate
-					cp1->normalImpulse = x.x;
-					cp2->normalImpulse = x.y;
+				// Accumulate
+				cp1->normalImpulse = x.x;
+				cp2->normalImpulse = x.y;
 
 #if B2_DEBUG_SOLVER == 1
-					// Postconditions
-					dv1 = vB + b2Cross(wB, cp1->rB) - vA - b2Cross(wA, cp1->rA);
-					dv2 = vB + b2Cross(wB, cp2->rB) - vA - b2Cross(wA, cp2->rA);
+				// Postconditions
+				dv1 = vB + b2Cross(wB, cp1->rB) - vA - b2Cross(wA, cp1->rA);
+				dv2 = vB + b2Cross(wB, cp2->rB) - vA - b2Cross(wA, cp2->rA);
 
-					// Compute normal velocity
-					vn1 = b2Dot(dv1, normal);
-					vn2 = b2Dot(dv2, normal);
+				// Compute normal velocity
+				vn1 = b2Dot(dv1, normal);
+				vn2 = b2Dot(dv2, normal);
 
-					b2Assert(b2Abs(vn1 - cp1->velocityBias) < k_errorTol);
-					b2Assert(b2Abs(vn2 - cp2->velocityBias) < k_errorTol);
+				b2Assert(b2Abs(vn1 - cp1->velocityBias) < k_errorTol);
+				b2Assert(b2Abs(vn2 - cp2->velocityBias) < k_errorTol);
 #endif
-					break;
-				}
+				break;
+			}
 
-				//
-				// Case 2: vn1 = 0 and x2 = 0
-				//
-				//   0 = a11 * x1 + a12 * 0 + b1' 
-				// vn2 = a21 * x1 + a22 * 0 + b2'
-				//
-				x.x = - cp1->normalMass * b.x;
-				x.y = 0.0f;
-				vn1 = 0.0f;
-				vn2 = vc->K.ex.y * x.x + b.y;
-
-				if (x.x >= 0.0f && vn2 >= 0.0f)
-				{
-					// Get the incremental impulse
-					b2Vec2 d = x - a;
+			//
+			// Case 2: vn1 = 0 and x2 = 0
+			//
+			//   0 = a11 * x1 + a12 * 0 + b1' 
+			// vn2 = a21 * x1 + a22 * 0 + b2'
+			//
+			x.x = - cp1->normalMass * b.x;
+			x.y = 0.0f;
+			vn1 = 0.0f;
+			vn2 = vc->K.ex.y * x.x + b.y;
+
+			if (x.x >= 0.0f && vn2 >= 0.0f)
+			{
+				// Get the incremental impulse
+				b2Vec2 d = x - a;
 
-					// Apply incremental impulse
-					b2Vec2 P1 = d.x * normal;
-					b2Vec2 P2 = d.y * normal;
-					vA -= mA * (P1 + P2);
-					wA -= iA * (b2Cross(cp1->rA, P1) + b2Cross(cp2->rA, P2));
+				// Apply incremental impulse
+				b2Vec2 P1 = d.x * normal;
+				b2Vec2 P2 = d.y * normal;
+				vA -= mA * (P1 + P2);
+				wA -= iA * (b2Cross(cp1->rA, P1) + b2Cross(cp2->rA, P2));
 
-					vB += mB * (P1 + P2);
-					wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
+				vB += mB * (P1 + P2);
+				wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
 
-					// Accumulate
-					cp1->normalImpulse = x.x;
-					cp2->normalImpulse = x.y;
+				// Accumulate
+				cp1->normalImpulse = x.x;
+				cp2->normalImpulse = x.y;
 
 #if B2_DEBUG_SOLVER == 1
-					// Postconditions
-					dv1 = vB + b2Cross(wB, cp1->rB) - vA - b2Cross(wA, cp1->rA);
+				// Postconditions
+				dv1 = vB + b2Cross(wB, cp1->rB) - vA - b2Cross(wA, cp1->rA);
 
-					// Compute normal velocity
-					vn1 = b2Dot(dv1, normal);
+				// Compute normal velocity
+				vn1 = b2Dot(dv1, normal);
 
-					b2Assert(b2Abs(vn1 - cp1->velocityBias) < k_errorTol);
+				b2Assert(b2Abs(vn1 - cp1->velocityBias) < k_errorTol);
 #endif
-					break;
-				}
+				break;
+			}
 
 
-				//
-				// Case 3: vn2 = 0 and x1 = 0
-				//
-				// vn1 = a11 * 0 + a12 * x2 + b1' 
-				//   0 = a21 * 0 + a22 * x2 + b2'
-				//
-				x.x = 0.0f;
-				x.y = - cp2->normalMass * b.y;
-				vn1 = vc->K.ey.x * x.y + b.x;
-				vn2 = 0.0f;
+			//
+			// Case 3: vn2 = 0 and x1 = 0
+			//
+			// vn1 = a11 * 0 + a12 * x2 + b1' 
+			//   0 = a21 * 0 + a22 * x2 + b2'
+			//
+			x.x = 0.0f;
+			x.y = - cp2->normalMass * b.y;
+			vn1 = vc->K.ey.x * x.y + b.x;
+			vn2 = 0.0f;
 
-				if (x.y >= 0.0f && vn1 >= 0.0f)
-				{
-					// Resubstitute for the incremental impulse
-					b2Vec2 d = x - a;
+			if (x.y >= 0.0f && vn1 >= 0.0f)
+			{
+				// Resubstitute for the incremental impulse
+				b2Vec2 d = x - a;
 
-					// Apply incremental impulse
-					b2Vec2 P1 = d.x * normal;
-					b2Vec2 P2 = d.y * normal;
-					vA -= mA * (P1 + P2);
-					wA -= iA * (b2Cross(cp1->rA, P1) + b2Cross(cp2->rA, P2));
+				// Apply incremental impulse
+				b2Vec2 P1 = d.x * normal;
+				b2Vec2 P2 = d.y * normal;
+				vA -= mA * (P1 + P2);
+				wA -= iA * (b2Cross(cp1->rA, P1) + b2Cross(cp2->rA, P2));
 
-					vB += mB * (P1 + P2);
-					wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
+				vB += mB * (P1 + P2);
+				wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
 
-					// Accumulate
-					cp1->normalImpulse = x.x;
-					cp2->normalImpulse = x.y;
+				// Accumulate
+				cp1->normalImpulse = x.x;
+				cp2->normalImpulse = x.y;
 
 #if B2_DEBUG_SOLVER == 1
-					// Postconditions
-					dv2 = vB + b2Cross(wB, cp2->rB) - vA - b2Cross(wA, cp2->rA);
+				// Postconditions
+				dv2 = vB + b2Cross(wB, cp2->rB) - vA - b2Cross(wA, cp2->rA);
 
-					// Compute normal velocity
-					vn2 = b2Dot(dv2, normal);
+				// Compute normal velocity
+				vn2 = b2Dot(dv2, normal);
 
-					b2Assert(b2Abs(vn2 - cp2->velocityBias) < k_errorTol);
+				b2Assert(b2Abs(vn2 - cp2->velocityBias) < k_errorTol);
 #endif
-					break;
-				}
-
-				//
-				// Case 4: x1 = 0 and x2 = 0
-				// 
-				// vn1 = b1
-				// vn2 = b2;
-				x.x = 0.0f;
-				x.y = 0.0f;
-				vn1 = b.x;
-				vn2 = b.y;
-
-				if (vn1 >= 0.0f && vn2 >= 0.0f )
-				{
-					// Resubstitute for the incremental impulse
-					b2Vec2 d = x - a;
+				break;
+			}
 
-					// Apply incremental impulse
-					b2Vec2 P1 = d.x * normal;
-					b2Vec2 P2 = d.y * normal;
-					vA -= mA * (P1 + P2);
-					wA -= iA * (b2Cross(cp1->rA, P1) + b2Cross(cp2->rA, P2));
+			//
+			// Case 4: x1 = 0 and x2 = 0
+			// 
+			// vn1 = b1
+			// vn2 = b2;
+			x.x = 0.0f;
+			x.y = 0.0f;
+			vn1 = b.x;
+			vn2 = b.y;
+
+			if (vn1 >= 0.0f && vn2 >= 0.0f )
+			{
+				// Resubstitute for the incremental impulse
+				b2Vec2 d = x - a;
 
-					vB += mB * (P1 + P2);
-					wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
+				// Apply incremental impulse
+				b2Vec2 P1 = d.x * normal;
+				b2Vec2 P2 = d.y * normal;
+				vA -= mA * (P1 + P2);
+				wA -= iA * (b2Cross(cp1->rA, P1) + b2Cross(cp2->rA, P2));
 
-					// Accumulate
-					cp1->normalImpulse = x.x;
-					cp2->normalImpulse = x.y;
+				vB += mB * (P1 + P2);
+				wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
 
-					break;
-				}
+				// Accumulate
+				cp1->normalImpulse = x.x;
+				cp2->normalImpulse = x.y;
 
-				// No solution, give up. This is hit sometimes, but it doesn't seem to matter.
 				break;
 			}
+
+			// No solution, give up. This is hit sometimes, but it doesn't seem to matter.
+			break;
 		}
+	}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+	velocities[indexA].v = vA;
+	velocities[indexA].w = wA;
+	velocities[indexB].v = vB;
+	velocities[indexB].w = wB;
+}
+
+void b2ContactSolver::SolveVelocityConstraints()
+{
+	if (m_wideConstraints)
+	{
+		for (int32 i = 0; i < m_wideCount; ++i)
+		{
+			b2SolveWideVelocityConstraint(m_wideConstraints + i);
+		}
+
+		for (int32 i = 0; i < m_scalarCount; ++i)
+		{
+			b2SolveVelocityConstraint(m_velocityConstraints + m_scalarConstraints[i], m_velocities);
+		}
+		return;
+	}
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2SolveVelocityConstraint(m_velocityConstraints + i, m_velocities);
 	}
 }
 
 void b2ContactSolver::StoreImpulses()
 {
+	// Back in the scalar constraints first, the island reports them
+	for (int32 i = 0; i < m_wideCount; ++i)
+	{
+		b2WideVelocityConstraint* c = m_wideConstraints + i;
+		for (int32 lane = 0; lane < b2_wideLanes; ++lane)
+		{
+			if (c->constraintIndex[lane] < 0)
+			{
+				continue;
+			}
+
+			b2ContactVelocityConstraint* vc = m_velocityConstraints + c->constraintIndex[lane];
+			for (int32 j = 0; j < c->pointCount; ++j)
+			{
+				vc->points[j].normalImpulse = b2LaneW(c->points[j].normalImpulse, lane);
+				vc->points[j].tangentImpulse = b2LaneW(c->points[j].tangentImpulse, lane);
+			}
+		}
+	}
+
 	for (int32 i = 0; i < m_count; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
@@ -27,6 +27,7 @@ class b2Contact;
 class b2Body;
 class b2StackAllocator;
 struct b2ContactPositionConstraint;
+struct b2WideVelocityConstraint;
 
 struct b2VelocityConstraintPoint
 {
@@ -81,6 +82,9 @@ public:
 	bool SolvePositionConstraints();
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
+	/// Groups the velocity constraints of the wide solver, see b2World::SetWideContactSolver.
+	void PrepareWideConstraints();
+
 	b2TimeStep m_step;
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
@@ -89,6 +93,16 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	// Wide solver: the constraints are also stored lane by lane, the ones
+	// which could not be grouped are solved one by one after them.
+	bool m_wide;
+	void* m_wideMemory;
+	b2WideVelocityConstraint* m_wideConstraints;
+	int32 m_wideCount;
+	int32* m_scalarConstraints;
+	int32 m_scalarCount;
+	b2Velocity m_emptyLane;
 };
 
 #endif
@@ -21,6 +21,17 @@
 
 #include <Box2D/Dynamics/Joints/b2Joint.h>
 
+/// Solver state of a revolute joint: limits and accumulated impulses (warm
+/// starting). Used to save a joint and restore it exactly.
+struct b2RevoluteJointState
+{
+	b2Vec3 impulse;
+	float32 motorImpulse;
+	float32 lowerAngle;
+	float32 upperAngle;
+	b2LimitState limitState;
+};
+
 /// Revolute joint definition. This requires defining an
 /// anchor point where the bodies are joined. The definition
 /// uses local anchor points so that the initial configuration
@@ -99,6 +110,9 @@ public:
 	/// The local anchor point relative to bodyB's origin.
 	const b2Vec2& GetLocalAnchorB() const  { return m_localAnchorB; }
 
+	/// Move the anchor points, e.g. after resizing the bodies.
+	void SetLocalAnchors(const b2Vec2& anchorA, const b2Vec2& anchorB) { m_localAnchorA = anchorA; m_localAnchorB = anchorB; }
+
 	/// Get the reference angle.
 	float32 GetReferenceAngle() const { return m_referenceAngle; }
 
@@ -151,6 +165,10 @@ public:
 	/// Unit is N*m.
 	float32 GetMotorTorque(float32 inv_dt) const;
 
+	/// Get/Set the solver state. SetLimits resets the limit impulse, this does not.
+	void GetState(b2RevoluteJointState* state) const;
+	void SetState(const b2RevoluteJointState& state);
+
 	/// Dump to b2Log.
 	void Dump();
 
@@ -201,4 +219,22 @@ inline float32 b2RevoluteJoint::GetMotorSpeed() const
 	return m_motorSpeed;
 }
 
+inline void b2RevoluteJoint::GetState(b2RevoluteJointState* state) const
+{
+	state->impulse = m_impulse;
+	state->motorImpulse = m_motorImpulse;
+	state->lowerAngle = m_lowerAngle;
+	state->upperAngle = m_upperAngle;
+	state->limitState = m_limitState;
+}
+
+inline void b2RevoluteJoint::SetState(const b2RevoluteJointState& state)
+{
+	m_impulse = state.impulse;
+	m_motorImpulse = state.motorImpulse;
+	m_lowerAngle = state.lowerAngle;
+	m_upperAngle = state.upperAngle;
+	m_limitState = state.limitState;
+}
+
 #endif
@@ -122,6 +122,20 @@ struct b2BodyDef
 	float32 gravityScale;
 };
 
+/// Motion state of a body: everything a time step changes. Used to save a
+/// body and restore it exactly.
+struct b2BodyState
+{
+	b2Transform xf;
+	b2Sweep sweep;
+	b2Vec2 linearVelocity;
+	float32 angularVelocity;
+	b2Vec2 force;
+	float32 torque;
+	float32 sleepTime;
+	bool awake;
+};
+
 /// A rigid body. These are created via b2World::CreateBody.
 class b2Body
 {
@@ -164,6 +178,14 @@ public:
 	/// @return the world transform of the body's origin.
 	const b2Transform& GetTransform() const;
 
+	/// Get the motion state of the body.
+	void GetState(b2BodyState* state) const;
+
+	/// Set the motion state of the body, bit for bit. Moves the proxies
+	/// like SetTransform.
+	/// @warning This function is locked during callbacks.
+	void SetState(const b2BodyState& state);
+
 	/// Get the world body origin position.
 	/// @return the world position of the body's origin.
 	const b2Vec2& GetPosition() const;
@@ -651,6 +673,41 @@ inline void b2Body::SetAwake(bool flag)
 	}
 }
 
+inline void b2Body::GetState(b2BodyState* state) const
+{
+	state->xf = m_xf;
+	state->sweep = m_sweep;
+	state->linearVelocity = m_linearVelocity;
+	state->angularVelocity = m_angularVelocity;
+	state->force = m_force;
+	state->torque = m_torque;
+	state->sleepTime = m_sleepTime;
+	state->awake = (m_flags & e_awakeFlag) == e_awakeFlag;
+}
+
+inline void b2Body::SetState(const b2BodyState& state)
+{
+	// Synchronizes the fixtures, then overwrites the recomputed values
+	SetTransform(state.xf.p, state.sweep.a);
+
+	m_xf = state.xf;
+	m_sweep = state.sweep;
+	m_linearVelocity = state.linearVelocity;
+	m_angularVelocity = state.angularVelocity;
+	m_force = state.force;
+	m_torque = state.torque;
+	m_sleepTime = state.sleepTime;
+
+	if (state.awake)
+	{
+		m_flags |= e_awakeFlag;
+	}
+	else
+	{
+		m_flags &= ~e_awakeFlag;
+	}
+}
+
 inline bool b2Body::IsAwake() const
 {
 	return (m_flags & e_awakeFlag) == e_awakeFlag;
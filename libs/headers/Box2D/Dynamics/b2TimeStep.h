@@ -43,6 +43,7 @@ struct b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool wideContactSolver;	// fits in the padding, the layout stays the same
 };
 
 /// This is an internal structure.
@@ -32,8 +32,136 @@
 #include <Box2D/Collision/b2TimeOfImpact.h>
 #include <Box2D/Common/b2Draw.h>
 #include <Box2D/Common/b2Timer.h>
+#include <algorithm>
 #include <new>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Below this number of islands, threads cost more than they save.
+const int32 b2_minParallelIslands = 8;
+
+// An island found by SolveIslandsInParallel, as ranges of the buffers.
+struct b2IslandRecord
+{
+	int32 bodyStart;
+	int32 bodyCount;
+	int32 contactStart;
+	int32 contactCount;
+	int32 jointStart;
+	int32 jointCount;
+	bool touchesStatic;
+	b2Profile profile;
+};
+
+// Islands of the last parallel solve, kept to avoid allocations.
+struct b2IslandBuffer
+{
+	b2IslandBuffer()
+	{
+		bodies = NULL;
+		contacts = NULL;
+		joints = NULL;
+		islands = NULL;
+		order = NULL;
+		bodyCapacity = 0;
+		contactCapacity = 0;
+		jointCapacity = 0;
+		islandCapacity = 0;
+		orderCapacity = 0;
+	}
+
+	~b2IslandBuffer()
+	{
+		b2Free(bodies);
+		b2Free(contacts);
+		b2Free(joints);
+		b2Free(islands);
+		b2Free(order);
+	}
+
+	b2Body** bodies;
+	b2Contact** contacts;
+	b2Joint** joints;
+	b2IslandRecord* islands;
+	int32* order;
+
+	int32 bodyCapacity;
+	int32 contactCapacity;
+	int32 jointCapacity;
+	int32 islandCapacity;
+	int32 orderCapacity;
+};
+
+// Grows an array of b2IslandBuffer, the content is not kept.
+template <typename T>
+static void b2Reserve(T*& array, int32& capacity, int32 count)
+{
+	if (count <= capacity)
+	{
+		return;
+	}
+
+	b2Free(array);
+	capacity = b2Max(count, 2 * capacity);
+	array = (T*)b2Alloc(capacity * sizeof(T));
+}
+
+// Stack allocator of a worker thread, the calling thread uses the one of the world.
+struct b2ThreadStack
+{
+	b2ThreadStack()
+	{
+		allocator = NULL;
+	}
+
+	~b2ThreadStack()
+	{
+		if (allocator)
+		{
+			allocator->~b2StackAllocator();
+			b2Free(allocator);
+		}
+	}
+
+	b2StackAllocator* allocator;
+};
+
+static thread_local b2ThreadStack b2_threadStack;
+
+static b2StackAllocator* b2GetThreadStackAllocator()
+{
+	if (b2_threadStack.allocator == NULL)
+	{
+		void* mem = b2Alloc(sizeof(b2StackAllocator));
+		b2_threadStack.allocator = new (mem) b2StackAllocator;
+	}
+	return b2_threadStack.allocator;
+}
+
+static void b2SolveRecordedIsland(b2IslandBuffer* buffer, b2IslandRecord* record, b2StackAllocator* allocator,
+								  const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+{
+	// Contacts are reported once every island is solved.
+	b2Island island(record->bodyCount, record->contactCount, record->jointCount, allocator, NULL);
+
+	for (int32 i = 0; i < record->bodyCount; ++i)
+	{
+		island.Add(buffer->bodies[record->bodyStart + i]);
+	}
+	for (int32 i = 0; i < record->contactCount; ++i)
+	{
+		island.Add(buffer->contacts[record->contactStart + i]);
+	}
+	for (int32 i = 0; i < record->jointCount; ++i)
+	{
+		island.Add(buffer->joints[record->jointStart + i]);
+	}
+
+	island.Solve(&record->profile, step, gravity, allowSleep);
+}
+
 b2World::b2World(const b2Vec2& gravity)
 {
 	m_destructionListener = NULL;
@@ -61,10 +189,20 @@ b2World::b2World(const b2Vec2& gravity)
 	m_contactManager.m_allocator = &m_blockAllocator;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
+
+	m_parallelIslands = true;
+	m_islandBuffer = NULL;
+	m_wideContactSolver = false;
 }
 
 b2World::~b2World()
 {
+	if (m_islandBuffer)
+	{
+		m_islandBuffer->~b2IslandBuffer();
+		b2Free(m_islandBuffer);
+	}
+
 	// Some shapes allocate using b2Alloc.
 	b2Body* b = m_bodyList;
 	while (b)
@@ -382,6 +520,26 @@ void b2World::SetAllowSleeping(bool flag)
 	}
 }
 
+void b2World::SetParallelIslands(bool flag)
+{
+	m_parallelIslands = flag;
+}
+
+bool b2World::GetParallelIslands() const
+{
+	return m_parallelIslands;
+}
+
+void b2World::SetWideContactSolver(bool flag)
+{
+	m_wideContactSolver = flag;
+}
+
+bool b2World::GetWideContactSolver() const
+{
+	return m_wideContactSolver;
+}
+
 // Find islands, integrate and solve constraints, solve position constraints
 void b2World::Solve(const b2TimeStep& step)
 {
@@ -389,6 +547,49 @@ void b2World::Solve(const b2TimeStep& step)
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
 
+#ifdef _OPENMP
+	bool parallel = m_parallelIslands && omp_get_max_threads() > 1 && omp_in_parallel() == 0;
+#else
+	bool parallel = false;
+#endif
+
+	if (parallel)
+	{
+		SolveIslandsInParallel(step);
+	}
+	else
+	{
+		SolveIslands(step);
+	}
+
+	{
+		b2Timer timer;
+		// Synchronize fixtures, check for out of range bodies.
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			// If a body was not in an island then it did not move.
+			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			{
+				continue;
+			}
+
+			if (b->GetType() == b2_staticBody)
+			{
+				continue;
+			}
+
+			// Update fixtures (for broad-phase).
+			b->SynchronizeFixtures();
+		}
+
+		// Look for new contacts.
+		m_contactManager.FindNewContacts();
+		m_profile.broadphase = timer.GetMilliseconds();
+	}
+}
+
+void b2World::SolveIslands(const b2TimeStep& step)
+{
 	// Size the island for the worst case.
 	b2Island island(m_bodyCount,
 					m_contactManager.m_contactCount,
@@ -546,30 +747,250 @@ void b2World::Solve(const b2TimeStep& step)
 	}
 
 	m_stackAllocator.Free(stack);
+}
 
+// Same islands as SolveIslands. They are all found first, serially, then the
+// ones touching a static body are solved on the calling thread, since they
+// share it: b2Island::Add sets its island index. The others go to the threads,
+// largest first. Contacts are reported afterwards, in the order of the islands.
+void b2World::SolveIslandsInParallel(const b2TimeStep& step)
+{
+	if (m_islandBuffer == NULL)
 	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		void* mem = b2Alloc(sizeof(b2IslandBuffer));
+		m_islandBuffer = new (mem) b2IslandBuffer;
+	}
+
+	b2IslandBuffer* buffer = m_islandBuffer;
+
+	// A static body is in every island it touches.
+	b2Reserve(buffer->bodies, buffer->bodyCapacity, m_bodyCount + m_contactManager.m_contactCount + m_jointCount);
+	b2Reserve(buffer->contacts, buffer->contactCapacity, m_contactManager.m_contactCount);
+	b2Reserve(buffer->joints, buffer->jointCapacity, m_jointCount);
+	b2Reserve(buffer->islands, buffer->islandCapacity, m_bodyCount);
+	b2Reserve(buffer->order, buffer->orderCapacity, m_bodyCount);
+
+	// Clear all the island flags.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		b->m_flags &= ~b2Body::e_islandFlag;
+	}
+	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+	{
+		c->m_flags &= ~b2Contact::e_islandFlag;
+	}
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->m_islandFlag = false;
+	}
+
+	int32 bodyCount = 0;
+	int32 contactCount = 0;
+	int32 jointCount = 0;
+	int32 islandCount = 0;
+
+	// Find all awake islands.
+	int32 stackSize = m_bodyCount;
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
+	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	{
+		if (seed->m_flags & b2Body::e_islandFlag)
 		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			continue;
+		}
+
+		if (seed->IsAwake() == false || seed->IsActive() == false)
+		{
+			continue;
+		}
+
+		// The seed can be dynamic or kinematic.
+		if (seed->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+
+		b2IslandRecord* record = buffer->islands + islandCount++;
+		record->bodyStart = bodyCount;
+		record->contactStart = contactCount;
+		record->jointStart = jointCount;
+		record->touchesStatic = false;
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b2Body::e_islandFlag;
+
+		// Perform a depth first search (DFS) on the constraint graph.
+		while (stackCount > 0)
+		{
+			// Grab the next body off the stack and add it to the island.
+			b2Body* b = stack[--stackCount];
+			b2Assert(b->IsActive() == true);
+			buffer->bodies[bodyCount++] = b;
+
+			// Make sure the body is awake.
+			b->SetAwake(true);
+
+			// To keep islands as small as possible, we don't
+			// propagate islands across static bodies.
+			if (b->GetType() == b2_staticBody)
 			{
+				record->touchesStatic = true;
 				continue;
 			}
 
+			// Search all contacts connected to this body.
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* contact = ce->contact;
+
+				// Has this contact already been added to an island?
+				if (contact->m_flags & b2Contact::e_islandFlag)
+				{
+					continue;
+				}
+
+				// Is this contact solid and touching?
+				if (contact->IsEnabled() == false ||
+					contact->IsTouching() == false)
+				{
+					continue;
+				}
+
+				// Skip sensors.
+				bool sensorA = contact->m_fixtureA->m_isSensor;
+				bool sensorB = contact->m_fixtureB->m_isSensor;
+				if (sensorA || sensorB)
+				{
+					continue;
+				}
+
+				buffer->contacts[contactCount++] = contact;
+				contact->m_flags |= b2Contact::e_islandFlag;
+
+				b2Body* other = ce->other;
+
+				// Was the other body already added to this island?
+				if (other->m_flags & b2Body::e_islandFlag)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < stackSize);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+
+			// Search all joints connect to this body.
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				if (je->joint->m_islandFlag == true)
+				{
+					continue;
+				}
+
+				b2Body* other = je->other;
+
+				// Don't simulate joints connected to inactive bodies.
+				if (other->IsActive() == false)
+				{
+					continue;
+				}
+
+				buffer->joints[jointCount++] = je->joint;
+				je->joint->m_islandFlag = true;
+
+				if (other->m_flags & b2Body::e_islandFlag)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < stackSize);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+		}
+
+		record->bodyCount = bodyCount - record->bodyStart;
+		record->contactCount = contactCount - record->contactStart;
+		record->jointCount = jointCount - record->jointStart;
+
+		// Allow static bodies to participate in other islands.
+		for (int32 i = record->bodyStart; i < bodyCount; ++i)
+		{
+			b2Body* b = buffer->bodies[i];
 			if (b->GetType() == b2_staticBody)
 			{
-				continue;
+				b->m_flags &= ~b2Body::e_islandFlag;
 			}
+		}
+	}
 
-			// Update fixtures (for broad-phase).
-			b->SynchronizeFixtures();
+	m_stackAllocator.Free(stack);
+
+	// Islands sharing a static body, and every island when there are too few.
+	int32 parallelCount = 0;
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		b2IslandRecord* record = buffer->islands + i;
+		if (record->touchesStatic == false && islandCount >= b2_minParallelIslands)
+		{
+			buffer->order[parallelCount++] = i;
+			continue;
 		}
 
-		// Look for new contacts.
-		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
+		b2SolveRecordedIsland(buffer, record, &m_stackAllocator, step, m_gravity, m_allowSleep);
+	}
+
+	// Largest first, an island is a single task.
+	b2IslandRecord* islands = buffer->islands;
+	std::sort(buffer->order, buffer->order + parallelCount, [islands](int32 a, int32 b)
+	{
+		int32 sizeA = islands[a].bodyCount + islands[a].contactCount + islands[a].jointCount;
+		int32 sizeB = islands[b].bodyCount + islands[b].contactCount + islands[b].jointCount;
+		return sizeA > sizeB || (sizeA == sizeB && a < b);
+	});
+
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int32 k = 0; k < parallelCount; ++k)
+	{
+#ifdef _OPENMP
+		b2StackAllocator* allocator = omp_get_thread_num() == 0 ? &m_stackAllocator : b2GetThreadStackAllocator();
+#else
+		b2StackAllocator* allocator = &m_stackAllocator;
+#endif
+		b2SolveRecordedIsland(buffer, islands + buffer->order[k], allocator, step, m_gravity, m_allowSleep);
+	}
+
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		b2IslandRecord* record = islands + i;
+		m_profile.solveInit += record->profile.solveInit;
+		m_profile.solveVelocity += record->profile.solveVelocity;
+		m_profile.solvePosition += record->profile.solvePosition;
+
+		if (listener == NULL)
+		{
+			continue;
+		}
+
+		// The impulses stored for warm starting are the solved ones, see b2Island::Report.
+		for (int32 j = 0; j < record->contactCount; ++j)
+		{
+			b2Contact* c = buffer->contacts[record->contactStart + j];
+			const b2Manifold* manifold = c->GetManifold();
+
+			b2ContactImpulse impulse;
+			impulse.count = manifold->pointCount;
+			for (int32 k = 0; k < manifold->pointCount; ++k)
+			{
+				impulse.normalImpulses[k] = manifold->points[k].normalImpulse;
+				impulse.tangentImpulses[k] = manifold->points[k].tangentImpulse;
+			}
+
+			listener->PostSolve(c, &impulse);
+		}
 	}
 }
 
@@ -860,6 +1281,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		subStep.positionIterations = 20;
 		subStep.velocityIterations = step.velocityIterations;
 		subStep.warmStarting = false;
+		subStep.wideContactSolver = false;
 		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
 
 		// Reset island flags and synchronize broad-phase proxies.
@@ -923,6 +1345,7 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
+	step.wideContactSolver = m_wideContactSolver;
 	
 	// Update contacts. This is where some contacts are destroyed.
 	{
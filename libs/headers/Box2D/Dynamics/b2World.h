@@ -27,6 +27,7 @@
 #include <Box2D/Dynamics/b2TimeStep.h>
 
 struct b2AABB;
+struct b2IslandBuffer;
 struct b2BodyDef;
 struct b2Color;
 struct b2JointDef;
@@ -201,10 +202,24 @@ public:
 
 	/// Get the contact manager for testing.
 	const b2ContactManager& GetContactManager() const;
+	b2ContactManager& GetContactManager();
 
 	/// Get the current profile.
 	const b2Profile& GetProfile() const;
 
+	/// Solve the islands on the OpenMP threads when there are enough of them.
+	/// Islands touching a static body are solved on the calling thread, the
+	/// results are the same as with a serial solve. Enabled by default.
+	void SetParallelIslands(bool flag);
+	bool GetParallelIslands() const;
+
+	/// Solve the contacts of large islands with SIMD, several at a time. The
+	/// contacts are graph colored so that the ones solved together never share
+	/// a dynamic body: the order changes, the results differ slightly from the
+	/// scalar solver. Disabled by default.
+	void SetWideContactSolver(bool flag);
+	bool GetWideContactSolver() const;
+
 	/// Dump the world into the log file.
 	/// @warning this should be called outside of a time step.
 	void Dump();
@@ -225,6 +240,8 @@ private:
 	friend class b2Controller;
 
 	void Solve(const b2TimeStep& step);
+	void SolveIslands(const b2TimeStep& step);
+	void SolveIslandsInParallel(const b2TimeStep& step);
 	void SolveTOI(const b2TimeStep& step);
 
 	void DrawJoint(b2Joint* joint);
@@ -261,6 +278,11 @@ private:
 	bool m_stepComplete;
 
 	b2Profile m_profile;
+
+	// Added last: the prebuilt objects only know the members above.
+	bool m_parallelIslands;
+	b2IslandBuffer* m_islandBuffer;
+	bool m_wideContactSolver;
 };
 
 inline b2Body* b2World::GetBodyList()
@@ -346,6 +368,11 @@ inline const b2ContactManager& b2World::GetContactManager() const
 	return m_contactManager;
 }
 
+inline b2ContactManager& b2World::GetContactManager()
+{
+	return m_contactManager;
+}
+
 inline const b2Profile& b2World::GetProfile() const
 {
 	return m_profile;
@@ -0,0 +1,97 @@
+#include <arena.hpp>
+
+#include <cassert>
+
+std::size_t const Arena::CHUNK_SIZE;
+std::size_t const Arena::ALIGNMENT;
+std::size_t const Arena::MAX_BLOCK_SIZE;
+std::size_t const Arena::NB_SIZE_CLASSES;
+
+Arena::Arena()
+    : m_freeLists()
+    , m_chunks()
+    , m_top(nullptr)
+    , m_remaining(0)
+    , m_bytesInUse(0)
+{
+
+}
+
+Arena::~Arena()
+{
+    assert(m_bytesInUse == 0 && "Arena destroyed while in use");
+
+    for(auto chunk: m_chunks)
+    {
+        ::operator delete(chunk);
+    }
+}
+
+std::size_t Arena::getSizeClass(std::size_t size)
+{
+    return (size + ALIGNMENT - 1) / ALIGNMENT - 1;
+}
+
+void * Arena::allocate(std::size_t size)
+{
+    if(size == 0) size = 1;
+
+    if(size > MAX_BLOCK_SIZE)
+    {
+        return ::operator new(size);
+    }
+
+    std::size_t const c = Arena::getSizeClass(size);
+    std::size_t const blockSize = (c + 1) * ALIGNMENT;
+    m_bytesInUse += blockSize;
+
+    if(m_freeLists[c])
+    {
+        Block * block = m_freeLists[c];
+        m_freeLists[c] = block->next;
+        return block;
+    }
+
+    // The end of the previous chunk is lost, at most MAX_BLOCK_SIZE bytes
+    if(m_remaining < blockSize)
+    {
+        m_chunks.push_back(static_cast<char *>(::operator new(CHUNK_SIZE)));
+        m_top = m_chunks.back();
+        m_remaining = CHUNK_SIZE;
+    }
+
+    void * p = m_top;
+    m_top += blockSize;
+    m_remaining -= blockSize;
+    return p;
+}
+
+void Arena::deallocate(void * p, std::size_t size)
+{
+    if(!p) return;
+
+    if(size == 0) size = 1;
+
+    if(size > MAX_BLOCK_SIZE)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    std::size_t const c = Arena::getSizeClass(size);
+    m_bytesInUse -= (c + 1) * ALIGNMENT;
+
+    Block * block = static_cast<Block *>(p);
+    block->next = m_freeLists[c];
+    m_freeLists[c] = block;
+}
+
+uint32_t Arena::getChunkCount() const
+{
+    return static_cast<uint32_t>(m_chunks.size());
+}
+
+std::size_t Arena::getBytesInUse() const
+{
+    return m_bytesInUse;
+}
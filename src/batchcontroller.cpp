@@ -0,0 +1,21 @@
+#include <batchcontroller.hpp>
+
+#include <cassert>
+
+#include <car.hpp>
+
+BatchController::~BatchController()
+{
+
+}
+
+uint32_t BatchController::updateFlags(Car * c) const
+{
+    assert(c && "Car is null");
+
+    SensorArray const & dists = c->getCollisionDists();
+
+    int32_t flags = 0;
+    this->updateBatch(dists.data(), 1, static_cast<uint32_t>(dists.size()), &flags);
+    return static_cast<uint32_t>(flags);
+}
@@ -1,9 +1,12 @@
 #include <car.hpp>
-#include <raycastcallback.hpp>
 
 #include <cassert>
 #include <iostream>
 
+#include <carpool.hpp>
+#include <sensortable.hpp>
+#include <snapshot.hpp>
+
 Car::Car(CarDef const & def, Controller const * controller)
     : Drawable()
     , m_def(def)
@@ -17,32 +20,21 @@ Car::Car(CarDef const & def, Controller const * controller)
     , m_position(def.initPos)
     , m_steeringAngle(0.0)
     , m_collisionDists()
+    , m_rayFan()
+    , m_sensorTracker()
+    , m_idleTracker()
+    , m_idle(false)
+    , m_pool(nullptr)
+    , m_poolIndex(0)
 {
     m_collisionDists.resize(m_def.raycastAngles.size());
-
-    m_bodyDef.type = b2_dynamicBody;
-    m_bodyDef.position.Set(m_def.initPos.x, m_def.initPos.y);
-    m_bodyDef.angle = m_def.initAngle;
-
-    float32 halfWidth  = m_def.width / 2.0f;
-    float32 halfHeight = m_def.height / 2.0f;
-
-    m_shape.SetAsBox(halfWidth, halfHeight);
-
-    m_fixtureDef.shape = &m_shape;
-    m_fixtureDef.density = 1.0f;
-    m_fixtureDef.friction = 0.3f;
+    m_idleTracker.reset(m_def.initPos);
 
     #if CAR_PHYSICS_GRAPHIC_MODE_SFML
     m_color = sf::Color(0, 0, 255, 128);
-
-    // Creating vertices in CCW order
-    m_vertices.reserve(4);
-    m_vertices.push_back(std::make_pair(+halfWidth, -halfHeight));
-    m_vertices.push_back(std::make_pair(-halfWidth, -halfHeight));
-    m_vertices.push_back(std::make_pair(-halfWidth, +halfHeight));
-    m_vertices.push_back(std::make_pair(+halfWidth, +halfHeight));
     #endif
+
+    this->reshape();
 }
 
 Car::~Car()
@@ -70,7 +62,7 @@ double Car::getAngle() const
     return m_body->GetAngle();
 }
 
-std::vector<float32> const & Car::getCollisionDists() const
+SensorArray const & Car::getCollisionDists() const
 {
     return m_collisionDists;
 }
@@ -80,18 +72,37 @@ void Car::setController(Controller const * c)
     m_controller = c;
 }
 
-void Car::update(World const * w)
+void Car::sense(World const * w)
 {
     assert(w && "World is null");
 
+    // Only a contact or a force wakes a sleeping car up: it stays as it was
+    // until then, sensors and flags included
+    if(this->isSleeping())
+    {
+        if(!m_body->IsAwake()) return;
+
+        m_idle = false;
+        m_idleTracker.reset(m_position);
+    }
+
     // Perform raycast to find collision distances
     this->doRaycast(w);
 
     // Updating flags with controller if it exists
     if(m_controller != nullptr)
     {
+        CAR_PHYSICS_SCOPED_TIMER(w->getRecorder(), Stats::CONTROLLER);
+        CAR_PHYSICS_COUNT(w->getRecorder(), Stats::CONTROLLER_CALLS, 1);
         m_flags = m_controller->updateFlags(this);
     }
+}
+
+void Car::act(World const * w)
+{
+    assert(w && "World is null");
+
+    if(this->isSleeping()) return;
 
     // Making the car move and turn
     if(m_flags & Car::FORWARD)
@@ -145,20 +156,37 @@ void Car::update(World const * w)
     m_frjoint->SetLimits(m_steeringAngle, m_steeringAngle);
 
     // SImulate friction on tires
-    for(auto it = m_tireList.begin(); it != m_tireList.end(); ++it)
     {
-        assert((*it) && "Tire is null");
-        (*it)->simulateFriction();
+        CAR_PHYSICS_SCOPED_TIMER(w->getRecorder(), Stats::FRICTION);
+        for(auto it = m_tireList.begin(); it != m_tireList.end(); ++it)
+        {
+            assert((*it) && "Tire is null");
+            (*it)->simulateFriction();
+        }
     }
 
     // Update position
     m_position = m_body->GetPosition();
 
-    // Die if touching obstacle
-    if(this->isColliding())
+    // Die if touching obstacle, deactivated ones are not in the contact list
+    if(this->isColliding() || (w->isStaticGeometryDeactivated() && w->overlapsStaticGeometry(m_body)))
     {
         this->die(w);
     }
+    else if(m_idleTracker.update(m_def.idle, m_position, m_body->GetLinearVelocity()))
+    {
+        CAR_PHYSICS_COUNT(w->getRecorder(), Stats::IDLE_CARS, 1);
+        m_idle = true;
+
+        if(m_def.idle.policy == IdleDef::TERMINATE)
+        {
+            this->die(w);
+        }
+        else
+        {
+            this->sleep();
+        }
+    }
 
     // Change color in funtion of obstacle procimity
     #if CAR_PHYSICS_GRAPHIC_MODE_SFML
@@ -186,11 +214,58 @@ void Car::die(World const * w)
     }
 }
 
+bool Car::isIdle() const
+{
+    return m_idle;
+}
+
+bool Car::isSleeping() const
+{
+    return m_idle && m_def.idle.policy == IdleDef::SLEEP;
+}
+
+void Car::saveState(Snapshot & s) const
+{
+    Drawable::saveState(s);
+
+    s.write(m_flags);
+    s.write(m_position);
+    s.write(m_steeringAngle);
+    s.write(m_collisionDists.data(), m_collisionDists.size());
+    s.write(m_idleTracker);
+    s.write(m_idle);
+}
+
+void Car::restoreState(Snapshot const & s, std::size_t & offset)
+{
+    Drawable::restoreState(s, offset);
+
+    s.read(offset, m_flags);
+    s.read(offset, m_position);
+    s.read(offset, m_steeringAngle);
+    s.read(offset, m_collisionDists.data(), m_collisionDists.size());
+    s.read(offset, m_idleTracker);
+    s.read(offset, m_idle);
+
+    // Hints of another pose: the next fan walks the static geometry
+    m_sensorTracker.reset();
+}
+
 std::shared_ptr<Car> Car::cloneInitial() const
 {
     return std::make_shared<Car>(m_def, nullptr);
 }
 
+void Car::define(DrawableDef & def) const
+{
+    Drawable::define(def);
+
+    def.body.type = b2_dynamicBody;
+    def.body.position = m_def.initPos;
+    def.body.angle = m_def.initAngle;
+    def.shape.SetAsBox(m_def.width / 2.0f, m_def.height / 2.0f);
+}
+
 void Car::setBody(b2Body * body, World * w)
 {
     m_tireList.clear();
@@ -230,24 +305,21 @@ void Car::setBody(b2Body * body, World * w)
                 ++m_nbMotorWheels;
             }
 
-            b2Vec2 tireLocalPos;
-            tireLocalPos.x = 2.0f * x * m_def.width / 3.0f - m_def.width / 3.0f;
-            tireLocalPos.y = 2.0f * y * m_def.height / 3.0f - m_def.height / 3.0f;
-
-            float c = std::cos(m_def.initAngle);
-            float s = std::sin(m_def.initAngle);
-            b2Vec2 tirePos;
-            tirePos.x = tireLocalPos.x * c - tireLocalPos.y * s + m_def.initPos.x;
-            tirePos.y = tireLocalPos.x * s + tireLocalPos.y * c + m_def.initPos.y;
+            b2Vec2 tireLocalPos = Car::getTireAnchor(m_def, x, y);
+            b2Vec2 tirePos = Car::getTireInitPos(m_def, x, y);
 
-            std::shared_ptr<Tire> tire = std::make_shared<Tire>(
+            std::shared_ptr<Tire> tire = w->create<Tire>(
                 tirePos, m_def.initAngle, tireWidth, tireHeight, motor
             );
+            tire->setRecyclable(m_pool != nullptr);
 
             // /!\ This line must be before Tire::attachJointAsB because
             // the b2Body of the tire is set in World::addDrawable
             w->addDrawable(tire);
 
+            // Sensors of the car ignore its tires
+            tire->setOwner(this);
+
             // Attach tire to car
             tire->attachJointAsB(jointDef);
 
@@ -281,30 +353,176 @@ void Car::setBody(b2Body * body, World * w)
     m_power = body->GetMass() * m_def.acceleration;
 }
 
+b2Vec2 Car::getTireAnchor(CarDef const & def, uint32_t x, uint32_t y)
+{
+    b2Vec2 anchor;
+    anchor.x = 2.0f * x * def.width / 3.0f - def.width / 3.0f;
+    anchor.y = 2.0f * y * def.height / 3.0f - def.height / 3.0f;
+    return anchor;
+}
+
+b2Vec2 Car::getTireInitPos(CarDef const & def, uint32_t x, uint32_t y)
+{
+    b2Vec2 anchor = Car::getTireAnchor(def, x, y);
+
+    float c = std::cos(def.initAngle);
+    float s = std::sin(def.initAngle);
+    b2Vec2 pos;
+    pos.x = anchor.x * c - anchor.y * s + def.initPos.x;
+    pos.y = anchor.x * s + anchor.y * c + def.initPos.y;
+    return pos;
+}
+
+void Car::reshape()
+{
+    float32 halfWidth  = m_def.width / 2.0f;
+    float32 halfHeight = m_def.height / 2.0f;
+
+    if(m_body)
+    {
+        b2Fixture * fixture = m_body->GetFixtureList();
+        assert(fixture && "Car has no fixture");
+        static_cast<b2PolygonShape *>(fixture->GetShape())->SetAsBox(halfWidth, halfHeight);
+        m_body->ResetMassData();
+    }
+
+    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+    // Vertices in CCW order
+    m_vertices.clear();
+    m_vertices.push_back(std::make_pair(+halfWidth, -halfHeight));
+    m_vertices.push_back(std::make_pair(-halfWidth, -halfHeight));
+    m_vertices.push_back(std::make_pair(-halfWidth, +halfHeight));
+    m_vertices.push_back(std::make_pair(+halfWidth, +halfHeight));
+    #endif
+}
+
+void Car::rearm(CarDef const & def, Controller const * controller, World * w)
+{
+    assert(w && "World is null");
+    assert(m_body && "Car has no body");
+    assert(!m_body->IsActive() && "Car is still in use");
+    assert(m_tireList.size() == 4);
+
+    bool resized = def.width < m_def.width || def.width > m_def.width
+        || def.height < m_def.height || def.height > m_def.height;
+
+    // Copies reuse the memory of the previous definition
+    m_def.width = def.width;
+    m_def.height = def.height;
+    m_def.initPos = def.initPos;
+    m_def.initAngle = def.initAngle;
+    m_def.acceleration = def.acceleration;
+    m_def.maxSteeringAngle = def.maxSteeringAngle;
+    m_def.steeringRate = def.steeringRate;
+    m_def.raycastDist = def.raycastDist;
+    m_def.raycastAngles = def.raycastAngles;
+    m_def.idle = def.idle;
+    m_def.sensorTable = def.sensorTable;
+
+    m_controller = controller;
+    m_flags = 0;
+    m_position = m_def.initPos;
+    m_steeringAngle = 0.0;
+    m_collisionDists.assign(m_def.raycastAngles.size(), 0.0f);
+    m_sensorTracker.reset();
+    m_idleTracker.reset(m_def.initPos);
+    m_idle = false;
+
+    if(resized) this->reshape();
+    this->resetBody(m_def.initPos, m_def.initAngle);
+
+    for(auto t = 0u; t < m_tireList.size(); ++t)
+    {
+        Tire * tire = m_tireList[t].get();
+        if(resized) tire->reshape(m_def.width / 4.0f, m_def.height / 4.0f);
+        tire->rearm(Car::getTireInitPos(m_def, t / 2, t % 2), m_def.initAngle);
+
+        w->addRecycledDrawable(m_tireList[t]);
+    }
+
+    // Joints: anchors follow the size, no steering and no impulse left
+    b2RevoluteJointState state;
+    state.impulse.SetZero();
+    state.motorImpulse = 0.0f;
+    state.lowerAngle = 0.0f;
+    state.upperAngle = 0.0f;
+    state.limitState = e_inactiveLimit;
+
+    for(b2JointEdge * je = m_body->GetJointList(); je; je = je->next)
+    {
+        b2RevoluteJoint * joint = static_cast<b2RevoluteJoint *>(je->joint);
+        joint->SetState(state);
+
+        if(!resized) continue;
+
+        // The side of the old anchor tells which tire it is
+        uint32_t x = joint->GetLocalAnchorA().x > 0.0f ? 1 : 0;
+        uint32_t y = joint->GetLocalAnchorA().y > 0.0f ? 1 : 0;
+        joint->SetLocalAnchors(Car::getTireAnchor(m_def, x, y), b2Vec2(0.0, 0.0));
+    }
+
+    m_power = m_body->GetMass() * m_def.acceleration;
+}
+
+bool Car::recycle()
+{
+    if(!m_pool) return false;
+
+    m_pool->release(m_poolIndex);
+    return true;
+}
+
+void Car::sleep()
+{
+    assert(m_body && "Car has no body");
+
+    // The whole rig, a tire left awake would wake the chassis up through its joint
+    m_flags = 0;
+    m_body->SetAwake(false);
+    for(auto it = m_tireList.begin(); it != m_tireList.end(); ++it)
+    {
+        assert((*it) && "Tire is null");
+        (*it)->sleep();
+    }
+}
+
 void Car::doRaycast(World const * w) const
 {
     assert(w && "World is null");
     assert(m_body && "Car has no body");
     assert(m_collisionDists.size() == m_def.raycastAngles.size());
 
+    CAR_PHYSICS_SCOPED_TIMER(w->getRecorder(), Stats::RAYCAST);
+    CAR_PHYSICS_COUNT(w->getRecorder(), Stats::RAYCASTS, 1);
+    CAR_PHYSICS_COUNT(w->getRecorder(), Stats::RAYS, m_def.raycastAngles.size());
+
+    b2Vec2 point1 = m_body->GetWorldCenter();
+    m_rayFan.reset(point1, m_def.raycastAngles.size(), this);
+
     for(auto i = 0u; i < m_def.raycastAngles.size(); ++i)
     {
         float32 angle = m_def.raycastAngles[i] + m_body->GetAngle() + M_PI/2.0;
-        b2Vec2 point1 = m_body->GetWorldCenter();
         b2Vec2 point2 = b2Vec2(std::cos(angle), std::sin(angle));
         point2 *= m_def.raycastDist;
         point2 += point1;
 
-        RaycastCallback callback(m_body);
-        w->rayCast(&callback, point1, point2);
-        if(callback.fixture != nullptr)
-        {
-            m_collisionDists[i] = callback.fraction;
-        }
-        else
-        {
-            m_collisionDists[i] = 1.0f;
-        }
+        m_rayFan.setEnd(i, point2);
+    }
+
+    // All rays are cast at once, with a single walk of the broad-phase
+    SensorTable const * table = w->getSensorTable();
+    if(m_def.sensorTable && table && table->matches(m_def.raycastDist, m_def.raycastAngles.data(), static_cast<uint32_t>(m_def.raycastAngles.size())))
+    {
+        w->rayCast(&m_rayFan, m_body->GetAngle());
+    }
+    else
+    {
+        w->rayCast(&m_rayFan, &m_sensorTracker);
+    }
+
+    for(auto i = 0u; i < m_def.raycastAngles.size(); ++i)
+    {
+        m_collisionDists[i] = m_rayFan.getFraction(i);
     }
 }
 
@@ -0,0 +1,595 @@
+#include <carfleet.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <omp.h>
+
+#include <sensortable.hpp>
+#include <snapshot.hpp>
+#include <tire.hpp>
+#include <world.hpp>
+
+CarFleet::CarFleet()
+    : m_world(nullptr)
+    , m_defs()
+    , m_raycastAngles()
+    , m_nbSensors(0)
+    , m_alive()
+    , m_flags()
+    , m_steering()
+    , m_steeringRate()
+    , m_maxSteering()
+    , m_power()
+    , m_positions()
+    , m_bodies()
+    , m_frontJoints()
+    , m_tires()
+    , m_collisionDists()
+    , m_idleTrackers()
+    , m_sensorTrackers()
+    , m_rayFans(omp_get_max_threads())
+    , m_controller(nullptr)
+    , m_keepDeadBodies(false)
+    , m_aliveCount(0)
+    , m_sleepingCount(0)
+{
+
+}
+
+CarFleet::~CarFleet()
+{
+
+}
+
+uint32_t CarFleet::add(CarDef const & def)
+{
+    if(m_defs.empty())
+    {
+        m_raycastAngles = def.raycastAngles;
+        m_nbSensors = static_cast<uint32_t>(m_raycastAngles.size());
+    }
+    assert(def.raycastAngles == m_raycastAngles && "Cars of a fleet must share their sensors");
+
+    uint32_t i = this->size();
+
+    m_defs.push_back(def);
+    m_alive.push_back(1);
+    m_flags.push_back(0);
+    m_steering.push_back(0.0f);
+    m_steeringRate.push_back(def.steeringRate);
+    m_maxSteering.push_back(def.maxSteeringAngle);
+    m_power.push_back(0.0f);
+    m_positions.push_back(def.initPos);
+    m_bodies.push_back(nullptr);
+    m_frontJoints.resize(2 * (i + 1), nullptr);
+    m_tires.resize(4 * (i + 1), nullptr);
+    m_collisionDists.resize(m_nbSensors * (i + 1), 1.0f);
+    m_idleTrackers.push_back(IdleTracker());
+    m_idleTrackers.back().reset(def.initPos);
+    m_sensorTrackers.push_back(SensorTracker());
+    ++m_aliveCount;
+
+    if(m_world)
+    {
+        this->createBodies(i);
+    }
+
+    return i;
+}
+
+uint32_t CarFleet::size() const
+{
+    return static_cast<uint32_t>(m_defs.size());
+}
+
+uint32_t CarFleet::getAliveCount() const
+{
+    return m_aliveCount;
+}
+
+bool CarFleet::isAlive(uint32_t i) const
+{
+    assert(i < this->size());
+    return m_alive[i] != 0;
+}
+
+uint32_t CarFleet::getSleepingCount() const
+{
+    return m_sleepingCount;
+}
+
+bool CarFleet::isSleeping(uint32_t i) const
+{
+    assert(i < this->size());
+    return m_alive[i] == 3;
+}
+
+CarDef const & CarFleet::getDefinition(uint32_t i) const
+{
+    assert(i < this->size());
+    return m_defs[i];
+}
+
+b2Vec2 CarFleet::getPos(uint32_t i) const
+{
+    assert(i < this->size());
+    return m_positions[i];
+}
+
+b2Body const * CarFleet::getBody(uint32_t i) const
+{
+    assert(i < this->size());
+    return m_bodies[i];
+}
+
+int32_t CarFleet::getFlags(uint32_t i) const
+{
+    assert(i < this->size());
+    return m_flags[i];
+}
+
+void CarFleet::setFlags(uint32_t i, int32_t flags)
+{
+    assert(i < this->size());
+    m_flags[i] = flags;
+}
+
+void CarFleet::setController(BatchController const * controller)
+{
+    m_controller = controller;
+}
+
+BatchController const * CarFleet::getController() const
+{
+    return m_controller;
+}
+
+uint32_t CarFleet::getSensorCount() const
+{
+    return m_nbSensors;
+}
+
+float32 const * CarFleet::getCollisionDists(uint32_t i) const
+{
+    assert(i < this->size());
+    return m_collisionDists.data() + m_nbSensors * i;
+}
+
+void CarFleet::attach(b2World * w)
+{
+    assert(w && "b2World is null");
+    assert(!m_world && "Fleet already in a world");
+
+    m_world = w;
+    for(uint32_t i = 0; i < this->size(); ++i)
+    {
+        if(m_alive[i]) this->createBodies(i);
+    }
+}
+
+void CarFleet::detach()
+{
+    // Bodies are destroyed with the b2World
+    m_world = nullptr;
+    std::fill(m_bodies.begin(), m_bodies.end(), nullptr);
+    std::fill(m_frontJoints.begin(), m_frontJoints.end(), nullptr);
+    std::fill(m_tires.begin(), m_tires.end(), nullptr);
+}
+
+void CarFleet::createBodies(uint32_t i)
+{
+    assert(m_world && "b2World is null");
+
+    CarDef const & def = m_defs[i];
+
+    float32 c = std::cos(def.initAngle);
+    float32 s = std::sin(def.initAngle);
+
+    b2BodyDef bodyDef;
+    bodyDef.type = b2_dynamicBody;
+    bodyDef.position = def.initPos;
+    bodyDef.angle = def.initAngle;
+
+    b2PolygonShape shape;
+    b2FixtureDef fixtureDef;
+    fixtureDef.shape = &shape;
+    fixtureDef.density = 1.0f;
+    fixtureDef.friction = 0.3f;
+
+    // Chassis, its body is the owner id of all the fixtures of the car
+    b2Body * body = m_world->CreateBody(&bodyDef);
+    shape.SetAsBox(def.width / 2.0f, def.height / 2.0f);
+    fixtureDef.userData = body;
+    body->CreateFixture(&fixtureDef);
+    m_bodies[i] = body;
+
+    // Tires
+    shape.SetAsBox(def.width / 8.0f, def.height / 8.0f);
+
+    b2RevoluteJointDef jointDef;
+    jointDef.bodyA = body;
+    jointDef.enableLimit = true;
+    jointDef.lowerAngle = 0;
+    jointDef.upperAngle = 0;
+    jointDef.localAnchorB = b2Vec2(0.0, 0.0);
+
+    // Same creation order as Car::setBody
+    for(auto x = 0u; x < 2; ++x)
+    {
+        for(auto y = 0u; y < 2; ++y)
+        {
+            b2Vec2 anchor = Car::getTireAnchor(def, x, y);
+
+            bodyDef.position.x = anchor.x * c - anchor.y * s + def.initPos.x;
+            bodyDef.position.y = anchor.x * s + anchor.y * c + def.initPos.y;
+
+            b2Body * tire = m_world->CreateBody(&bodyDef);
+            tire->CreateFixture(&fixtureDef);
+            m_tires[4 * i + 2 * y + x] = tire;
+
+            jointDef.bodyB = tire;
+            jointDef.localAnchorA = anchor;
+            b2Joint * joint = m_world->CreateJoint(&jointDef);
+
+            if(y == 1)
+            {
+                m_frontJoints[2 * i + x] = static_cast<b2RevoluteJoint *>(joint);
+            }
+        }
+    }
+
+    m_power[i] = body->GetMass() * def.acceleration;
+}
+
+void CarFleet::kill(uint32_t i)
+{
+    assert(m_world && "b2World is null");
+    assert(m_alive[i]);
+
+    if(m_keepDeadBodies)
+    {
+        this->setActive(i, false);
+    }
+    else
+    {
+        // Joints are destroyed with the bodies
+        for(uint32_t t = 4 * i; t < 4 * i + 4; ++t)
+        {
+            m_world->DestroyBody(m_tires[t]);
+            m_tires[t] = nullptr;
+        }
+        m_world->DestroyBody(m_bodies[i]);
+        m_bodies[i] = nullptr;
+        m_frontJoints[2 * i] = nullptr;
+        m_frontJoints[2 * i + 1] = nullptr;
+    }
+
+    m_alive[i] = 0;
+    --m_aliveCount;
+}
+
+void CarFleet::sleep(uint32_t i)
+{
+    assert(m_alive[i] == 1);
+
+    // The whole rig, a tire left awake would wake the chassis up through its joint
+    m_flags[i] = 0;
+    m_bodies[i]->SetAwake(false);
+    for(uint32_t t = 4 * i; t < 4 * i + 4; ++t)
+    {
+        m_tires[t]->SetAwake(false);
+    }
+
+    m_alive[i] = 3;
+    ++m_sleepingCount;
+}
+
+void CarFleet::setActive(uint32_t i, bool flag)
+{
+    assert(m_bodies[i] && "Car bodies were destroyed");
+
+    m_bodies[i]->SetActive(flag);
+    for(uint32_t t = 4 * i; t < 4 * i + 4; ++t)
+    {
+        m_tires[t]->SetActive(flag);
+    }
+}
+
+void CarFleet::saveState(Snapshot & s) const
+{
+    uint32_t const nbCars = this->size();
+
+    s.write(nbCars);
+    s.write(m_alive.data(), nbCars);
+    s.write(m_flags.data(), nbCars);
+    s.write(m_steering.data(), nbCars);
+    s.write(m_positions.data(), nbCars);
+    s.write(m_collisionDists.data(), m_collisionDists.size());
+    s.write(m_idleTrackers.data(), nbCars);
+    s.write(m_aliveCount);
+    s.write(m_sleepingCount);
+
+    for(uint32_t i = 0; i < nbCars; ++i)
+    {
+        if(!m_alive[i]) continue;
+
+        s.writeBody(m_bodies[i]);
+        for(uint32_t t = 4 * i; t < 4 * i + 4; ++t)
+        {
+            s.writeBody(m_tires[t]);
+        }
+    }
+}
+
+void CarFleet::restoreState(Snapshot const & s, std::size_t & offset)
+{
+    uint32_t const nbCars = this->size();
+
+    uint32_t nbSavedCars = 0;
+    s.read(offset, nbSavedCars);
+    assert(nbSavedCars == nbCars && "Cars were added to the fleet since the snapshot");
+
+    // Cars that died or came back since the snapshot
+    for(uint32_t i = 0; i < nbCars; ++i)
+    {
+        uint8_t alive = 0;
+        s.read(offset, alive);
+        if((alive != 0) != (m_alive[i] != 0))
+        {
+            this->setActive(i, alive != 0);
+        }
+        m_alive[i] = alive;
+    }
+
+    s.read(offset, m_flags.data(), nbCars);
+    s.read(offset, m_steering.data(), nbCars);
+    s.read(offset, m_positions.data(), nbCars);
+    s.read(offset, m_collisionDists.data(), m_collisionDists.size());
+    s.read(offset, m_idleTrackers.data(), nbCars);
+    s.read(offset, m_aliveCount);
+    s.read(offset, m_sleepingCount);
+
+    // Hints of other poses: the next fans walk the static geometry
+    for(auto & tracker: m_sensorTrackers)
+    {
+        tracker.reset();
+    }
+
+    for(uint32_t i = 0; i < nbCars; ++i)
+    {
+        if(!m_alive[i]) continue;
+
+        s.readBody(offset, m_bodies[i]);
+        for(uint32_t t = 4 * i; t < 4 * i + 4; ++t)
+        {
+            s.readBody(offset, m_tires[t]);
+        }
+    }
+}
+
+void CarFleet::sense(World const * w)
+{
+    assert(w && "World is null");
+
+    int32_t nbCars = static_cast<int32_t>(this->size());
+
+    // Sleeping cars woken up by a contact or a force drive again
+    for(int32_t i = 0; m_sleepingCount > 0 && i < nbCars; ++i)
+    {
+        if(m_alive[i] != 3 || !m_bodies[i]->IsAwake()) continue;
+
+        m_alive[i] = 1;
+        --m_sleepingCount;
+        m_idleTrackers[i].reset(m_positions[i]);
+    }
+
+    if(m_nbSensors == 0) return;
+
+    if(m_rayFans.size() < static_cast<uint32_t>(omp_get_max_threads()))
+    {
+        std::vector<RayFan>(omp_get_max_threads()).swap(m_rayFans);
+    }
+
+    // Wall time of the whole parallel cast
+    {
+        CAR_PHYSICS_SCOPED_TIMER(w->getRecorder(), Stats::RAYCAST);
+        uint32_t const nbActive = m_aliveCount - m_sleepingCount;
+        CAR_PHYSICS_COUNT(w->getRecorder(), Stats::RAYCASTS, nbActive);
+        CAR_PHYSICS_COUNT(w->getRecorder(), Stats::RAYS, nbActive * m_nbSensors);
+
+        SensorTable const * table = w->getSensorTable();
+
+        #pragma omp parallel for schedule(static)
+        for(int32_t i = 0; i < nbCars; ++i)
+        {
+            if(m_alive[i] != 1) continue;
+
+            RayFan & fan = m_rayFans[omp_get_thread_num()];
+            CarDef const & def = m_defs[i];
+            b2Body const * body = m_bodies[i];
+
+            b2Vec2 point1 = body->GetWorldCenter();
+            fan.reset(point1, m_nbSensors, body);
+
+            for(auto r = 0u; r < m_nbSensors; ++r)
+            {
+                float32 angle = m_raycastAngles[r] + body->GetAngle() + M_PI/2.0;
+                b2Vec2 point2 = b2Vec2(std::cos(angle), std::sin(angle));
+                point2 *= def.raycastDist;
+                point2 += point1;
+                fan.setEnd(r, point2);
+            }
+
+            if(def.sensorTable && table && table->matches(def.raycastDist, m_raycastAngles.data(), m_nbSensors))
+            {
+                w->rayCast(&fan, body->GetAngle());
+            }
+            else
+            {
+                w->rayCast(&fan, &m_sensorTrackers[i]);
+            }
+
+            float32 * dists = m_collisionDists.data() + m_nbSensors * i;
+            for(auto r = 0u; r < m_nbSensors; ++r)
+            {
+                dists[r] = fan.getFraction(r);
+            }
+        }
+    }
+
+    if(m_controller)
+    {
+        CAR_PHYSICS_SCOPED_TIMER(w->getRecorder(), Stats::CONTROLLER);
+        CAR_PHYSICS_COUNT(w->getRecorder(), Stats::CONTROLLER_CALLS, this->size());
+        m_controller->updateBatch(m_collisionDists.data(), this->size(), m_nbSensors, m_flags.data());
+    }
+}
+
+void CarFleet::act(World const * w)
+{
+    assert(w && "World is null");
+
+    uint32_t const nbCars = this->size();
+
+    // Motor (front) tires, index 2 * y + x
+    for(uint32_t i = 0; i < nbCars; ++i)
+    {
+        if(m_alive[i] != 1) continue;
+
+        float32 power = m_power[i] / 2.0f;
+
+        if(m_flags[i] & Car::FORWARD)
+        {
+            Tire::applyAcceleration(m_tires[4 * i + 2], power);
+            Tire::applyAcceleration(m_tires[4 * i + 3], power);
+        }
+
+        if(m_flags[i] & Car::BACKWARD)
+        {
+            Tire::applyAcceleration(m_tires[4 * i + 2], -power);
+            Tire::applyAcceleration(m_tires[4 * i + 3], -power);
+        }
+    }
+
+    // Steering rate integration
+    for(uint32_t i = 0; i < nbCars; ++i)
+    {
+        int32_t flags = m_flags[i];
+        float32 angle = m_steering[i];
+        float32 rate = m_steeringRate[i];
+        float32 maxAngle = m_maxSteering[i];
+
+        if((flags & Car::LEFT) && (angle > -maxAngle))
+        {
+            angle -= rate;
+        }
+
+        if((flags & Car::RIGHT) && (angle < maxAngle))
+        {
+            angle += rate;
+        }
+
+        if(!(flags & Car::RIGHT) && !(flags & Car::LEFT))
+        {
+            if(angle < rate && angle > -rate) angle = 0;
+            else if(angle < 0)                angle += rate;
+            else if(angle > 0)                angle -= rate;
+        }
+
+        m_steering[i] = angle;
+    }
+
+    for(uint32_t i = 0; i < nbCars; ++i)
+    {
+        if(m_alive[i] != 1) continue;
+        m_frontJoints[2 * i]->SetLimits(m_steering[i], m_steering[i]);
+        m_frontJoints[2 * i + 1]->SetLimits(m_steering[i], m_steering[i]);
+    }
+
+    // Tire friction
+    {
+        CAR_PHYSICS_SCOPED_TIMER(w->getRecorder(), Stats::FRICTION);
+        for(uint32_t t = 0; t < 4 * nbCars; ++t)
+        {
+            if(m_alive[t / 4] == 1) Tire::applyFriction(m_tires[t]);
+        }
+    }
+
+    // Positions and collisions. Cars touching an obstacle are only marked
+    // first: killing them right away would hide the contact from the other car.
+    bool const deactivated = w->isStaticGeometryDeactivated();
+    for(uint32_t i = 0; i < nbCars; ++i)
+    {
+        if(m_alive[i] != 1) continue;
+
+        m_positions[i] = m_bodies[i]->GetPosition();
+
+        for(b2ContactEdge * ce = m_bodies[i]->GetContactList(); ce; ce = ce->next)
+        {
+            if(ce->contact->IsTouching())
+            {
+                m_alive[i] = 2;
+                break;
+            }
+        }
+
+        if(m_alive[i] == 1 && deactivated && w->overlapsStaticGeometry(m_bodies[i])) m_alive[i] = 2;
+
+        if(m_alive[i] == 1 && m_idleTrackers[i].update(m_defs[i].idle, m_positions[i], m_bodies[i]->GetLinearVelocity()))
+        {
+            CAR_PHYSICS_COUNT(w->getRecorder(), Stats::IDLE_CARS, 1);
+
+            if(m_defs[i].idle.policy == IdleDef::TERMINATE)
+            {
+                m_alive[i] = 2;
+            }
+            else
+            {
+                this->sleep(i);
+            }
+        }
+    }
+
+    for(uint32_t i = 0; i < nbCars; ++i)
+    {
+        if(m_alive[i] != 2) continue;
+
+        CAR_PHYSICS_COUNT(w->getRecorder(), Stats::KILLED_FLEET_CARS, 1);
+        this->kill(i);
+    }
+}
+
+#if CAR_PHYSICS_GRAPHIC_MODE_SFML
+void CarFleet::getShapes(float scale, std::vector<sf::ConvexShape> & shapes) const
+{
+    for(uint32_t i = 0; i < this->size(); ++i)
+    {
+        if(!m_alive[i]) continue;
+
+        float32 halfWidth = m_defs[i].width / 2.0f;
+        float32 halfHeight = m_defs[i].height / 2.0f;
+
+        float32 min = 1.0;
+        for(uint32_t r = 0; r < m_nbSensors; ++r)
+        {
+            min = std::min(min, m_collisionDists[m_nbSensors * i + r]);
+        }
+
+        b2Vec2 pos = m_bodies[i]->GetPosition();
+        float32 rot = m_bodies[i]->GetAngle();
+
+        sf::ConvexShape convex;
+        convex.setPointCount(4);
+        convex.setPoint(0, sf::Vector2f(+halfWidth, -halfHeight));
+        convex.setPoint(1, sf::Vector2f(-halfWidth, -halfHeight));
+        convex.setPoint(2, sf::Vector2f(-halfWidth, +halfHeight));
+        convex.setPoint(3, sf::Vector2f(+halfWidth, +halfHeight));
+        convex.move(scale*pos.x, scale*pos.y);
+        convex.rotate((rot/b2_pi)*180.0);
+        convex.setFillColor(sf::Color((1-min)*255, 0, min * 255, 128));
+        shapes.push_back(convex);
+    }
+}
+#endif // CAR_PHYSICS_GRAPHIC_MODE_SFML
@@ -0,0 +1,76 @@
+#include <carpool.hpp>
+
+#include <cassert>
+
+#include <world.hpp>
+
+CarPool::CarPool(World * w)
+    : m_world(w)
+    , m_cars()
+    , m_free()
+{
+    assert(w && "World is null");
+}
+
+CarPool::~CarPool()
+{
+    // Cars still alive are destroyed as usual when they die
+    for(auto const & car: m_cars)
+    {
+        car->m_pool = nullptr;
+        for(auto const & tire: car->m_tireList)
+        {
+            tire->setRecyclable(false);
+        }
+    }
+}
+
+std::shared_ptr<Car> CarPool::spawn(CarDef const & def, Controller const * controller, bool required)
+{
+    if(m_free.empty())
+    {
+        std::shared_ptr<Car> car = m_world->create<Car>(def, controller);
+        car->m_pool = this;
+        car->m_poolIndex = static_cast<uint32_t>(m_cars.size());
+        m_cars.push_back(car);
+
+        // Releasing never allocates
+        if(m_free.capacity() < m_cars.size())
+        {
+            m_free.reserve(m_cars.capacity());
+        }
+
+        if(required)
+        {
+            m_world->addRequiredDrawable(car);
+        }
+        else
+        {
+            m_world->addDrawable(car);
+        }
+        return car;
+    }
+
+    std::shared_ptr<Car> const & car = m_cars[m_free.back()];
+    m_free.pop_back();
+
+    car->rearm(def, controller, m_world);
+    m_world->addRecycledDrawable(car, required);
+    return car;
+}
+
+uint32_t CarPool::size() const
+{
+    return static_cast<uint32_t>(m_cars.size());
+}
+
+uint32_t CarPool::getFreeCount() const
+{
+    return static_cast<uint32_t>(m_free.size());
+}
+
+void CarPool::release(uint32_t index)
+{
+    assert(index < m_cars.size());
+    m_free.push_back(index);
+}
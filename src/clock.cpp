@@ -0,0 +1,85 @@
+#include <clock.hpp>
+
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+Clock::~Clock()
+{
+
+}
+
+void Clock::start()
+{
+
+}
+
+bool Clock::keepRunning(World const &, uint64_t)
+{
+    return true;
+}
+
+RealTimeClock::RealTimeClock()
+    : Clock()
+    , m_lastTime(std::chrono::steady_clock::now())
+    , m_accumulator(0.0)
+{
+
+}
+
+void RealTimeClock::start()
+{
+    m_lastTime = std::chrono::steady_clock::now();
+    m_accumulator = 0.0;
+}
+
+uint32_t RealTimeClock::advance(double stepDuration)
+{
+    assert(stepDuration > 0.0);
+
+    // Sleep to free CPU until at least one step is due
+    if(m_accumulator < stepDuration)
+    {
+        std::chrono::duration<double> delay(stepDuration - m_accumulator);
+        std::this_thread::sleep_for(delay);
+    }
+
+    // Durations are kept in double seconds: no truncation, no drift
+    auto currentTime = std::chrono::steady_clock::now();
+    m_accumulator += std::chrono::duration<double>(currentTime - m_lastTime).count();
+    m_lastTime = currentTime;
+
+    double nbSteps = std::floor(m_accumulator / stepDuration);
+    m_accumulator -= nbSteps * stepDuration;
+
+    return static_cast<uint32_t>(nbSteps);
+}
+
+uint32_t FastClock::advance(double)
+{
+    return 1;
+}
+
+FixedStepsClock::FixedStepsClock(uint64_t nbSteps)
+    : FastClock()
+    , m_nbSteps(nbSteps)
+{
+
+}
+
+bool FixedStepsClock::keepRunning(World const &, uint64_t stepCount)
+{
+    return stepCount < m_nbSteps;
+}
+
+PredicateClock::PredicateClock(Predicate const & stop)
+    : FastClock()
+    , m_stop(stop)
+{
+
+}
+
+bool PredicateClock::keepRunning(World const & w, uint64_t stepCount)
+{
+    return !m_stop(w, stepCount);
+}
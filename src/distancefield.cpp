@@ -0,0 +1,476 @@
+#include <distancefield.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include <omp.h>
+
+#include <statictree.hpp>
+
+namespace
+{
+    // Samples per side of the tiles the exact band is computed by
+    uint32_t const TILE_SIZE = 32;
+
+    // Steps of a ray before giving up
+    uint32_t const MAX_STEPS = 256;
+
+    float32 const INF = 1e20f;
+
+    // Signed distance from p to a polygon, exact on both sides
+    float32 polygonDistance(DistanceField::Polygon const & polygon, b2Vec2 const & p)
+    {
+        float32 separation = -b2_maxFloat;
+        for(int32 i = 0; i < polygon.count; ++i)
+        {
+            separation = std::max(separation, b2Dot(polygon.normals[i], p - polygon.vertices[i]));
+        }
+
+        if(separation <= 0.0f) return separation;
+
+        // Outside: closest edge
+        float32 distanceSquared = b2_maxFloat;
+        for(int32 i = 0; i < polygon.count; ++i)
+        {
+            b2Vec2 const & v1 = polygon.vertices[i];
+            b2Vec2 const & v2 = polygon.vertices[i + 1 < polygon.count ? i + 1 : 0];
+
+            b2Vec2 const edge = v2 - v1;
+            float32 const t = b2Clamp(b2Dot(p - v1, edge) / std::max(edge.LengthSquared(), b2_epsilon), 0.0f, 1.0f);
+            distanceSquared = std::min(distanceSquared, b2DistanceSquared(p, v1 + t * edge));
+        }
+
+        return std::sqrt(distanceSquared);
+    }
+
+    // Circles, edges and chains: unsigned, through the GJK distance
+    float32 shapeDistance(b2Fixture const * fixture, int32 childIndex, b2Vec2 const & p)
+    {
+        b2CircleShape point;
+        point.m_p = p;
+        point.m_radius = 0.0f;
+
+        b2DistanceInput input;
+        input.proxyA.Set(fixture->GetShape(), childIndex);
+        input.proxyB.Set(&point, 0);
+        input.transformA = fixture->GetBody()->GetTransform();
+        input.transformB.SetIdentity();
+        input.useRadii = true;
+
+        b2SimplexCache cache;
+        cache.count = 0;
+
+        b2DistanceOutput output;
+        b2Distance(&output, &cache, &input);
+        return output.distance;
+    }
+
+    // 1D squared Euclidean distance transform of f (Felzenszwalb and
+    // Huttenlocher), v and z are scratch of n and n + 1 elements
+    void transform(float32 const * f, uint32_t n, float32 * d, int32 * v, float32 * z)
+    {
+        int32 k = 0;
+        v[0] = 0;
+        z[0] = -INF;
+        z[1] = INF;
+
+        for(int32 q = 1; q < static_cast<int32>(n); ++q)
+        {
+            float32 s;
+            while(true)
+            {
+                int32 const r = v[k];
+                s = ((f[q] + q * q) - (f[r] + r * r)) / (2.0f * (q - r));
+                if(s > z[k] || k == 0) break;
+                --k;
+            }
+
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = INF;
+        }
+
+        k = 0;
+        for(int32 q = 0; q < static_cast<int32>(n); ++q)
+        {
+            while(z[k + 1] < q) ++k;
+            float32 const dq = static_cast<float32>(q - v[k]);
+            d[q] = dq * dq + f[v[k]];
+        }
+    }
+}
+
+uint32_t const DistanceField::BAND_CELLS;
+uint32_t const DistanceField::QUANTA_PER_CELL;
+
+DistanceField::DistanceField()
+    : m_tree(nullptr)
+    , m_polygons()
+    , m_origin(0.0f, 0.0f)
+    , m_cellSize(0.0f)
+    , m_invCellSize(0.0f)
+    , m_quantum(0.0f)
+    , m_halfDiagonal(0.0f)
+    , m_width(0)
+    , m_height(0)
+    , m_bounds()
+    , m_primitives()
+{
+
+}
+
+DistanceField::~DistanceField()
+{
+
+}
+
+void DistanceField::build(StaticTree const & tree, float32 cellSize)
+{
+    assert(cellSize > 0.0f && "Cell size must be positive");
+
+    this->clear();
+
+    uint32_t const nbPrimitives = tree.getPrimitiveCount();
+    if(nbPrimitives == 0) return;
+
+    b2AABB bounds = tree.getPrimitiveBounds(0);
+    for(uint32_t i = 1; i < nbPrimitives; ++i)
+    {
+        bounds.Combine(tree.getPrimitiveBounds(static_cast<int32>(i)));
+    }
+
+    float32 const margin = BAND_CELLS * cellSize;
+    b2Vec2 const extents = bounds.upperBound - bounds.lowerBound;
+
+    m_tree = &tree;
+    m_polygons.resize(nbPrimitives);
+    for(uint32_t i = 0; i < nbPrimitives; ++i)
+    {
+        b2Fixture const * fixture = tree.getPrimitive(static_cast<int32>(i)).fixture;
+        b2Transform const & xf = fixture->GetBody()->GetTransform();
+
+        Polygon & polygon = m_polygons[i];
+        polygon.count = 0;
+        if(fixture->GetType() != b2Shape::e_polygon) continue;
+
+        b2PolygonShape const * shape = static_cast<b2PolygonShape const *>(fixture->GetShape());
+        polygon.count = shape->m_count;
+        for(int32 k = 0; k < shape->m_count; ++k)
+        {
+            polygon.vertices[k] = b2Mul(xf, shape->m_vertices[k]);
+            polygon.normals[k] = b2Mul(xf.q, shape->m_normals[k]);
+        }
+    }
+
+    m_origin = bounds.lowerBound - b2Vec2(margin, margin);
+    m_cellSize = cellSize;
+    m_invCellSize = 1.0f / cellSize;
+    m_quantum = cellSize / QUANTA_PER_CELL;
+    m_halfDiagonal = 0.5f * std::sqrt(2.0f) * cellSize;
+    m_width = static_cast<uint32_t>(std::ceil((extents.x + 2.0f * margin) * m_invCellSize)) + 1;
+    m_height = static_cast<uint32_t>(std::ceil((extents.y + 2.0f * margin) * m_invCellSize)) + 1;
+
+    std::vector<float32> distances(m_width * m_height, b2_maxFloat);
+    m_primitives.assign(m_width * m_height, -1);
+
+    this->computeBand(distances);
+    this->computeFarField(distances);
+}
+
+void DistanceField::clear()
+{
+    m_tree = nullptr;
+    m_polygons.clear();
+    m_origin.SetZero();
+    m_cellSize = 0.0f;
+    m_invCellSize = 0.0f;
+    m_quantum = 0.0f;
+    m_halfDiagonal = 0.0f;
+    m_width = 0;
+    m_height = 0;
+    m_bounds.clear();
+    m_primitives.clear();
+}
+
+bool DistanceField::empty() const
+{
+    return m_bounds.empty();
+}
+
+float32 DistanceField::getCellSize() const
+{
+    return m_cellSize;
+}
+
+uint32_t DistanceField::getWidth() const
+{
+    return m_width;
+}
+
+uint32_t DistanceField::getHeight() const
+{
+    return m_height;
+}
+
+std::size_t DistanceField::getMemorySize() const
+{
+    return m_bounds.size() * sizeof(uint8_t) + m_primitives.size() * sizeof(int32) + m_polygons.size() * sizeof(Polygon);
+}
+
+float32 DistanceField::getLowerBound(b2Vec2 const & p) const
+{
+    assert(!this->empty() && "Distance field is empty");
+
+    uint32_t const s = this->getNearestSample(p);
+    b2Vec2 const sample = m_origin + m_cellSize * b2Vec2(static_cast<float32>(s % m_width), static_cast<float32>(s / m_width));
+
+    // The distance changes by at most the length moved
+    return m_bounds[s] * m_quantum - b2Distance(p, sample);
+}
+
+float32 DistanceField::getDistance(b2Vec2 const & p, int32 & primitive) const
+{
+    assert(!this->empty() && "Distance field is empty");
+
+    int32 candidates[4];
+    uint32_t const nbCandidates = this->getCandidates(p, candidates);
+
+    primitive = -1;
+    float32 distance = b2_maxFloat;
+    for(uint32_t k = 0; k < nbCandidates; ++k)
+    {
+        float32 const d = this->getPrimitiveDistance(candidates[k], p);
+        if(d < distance)
+        {
+            distance = d;
+            primitive = candidates[k];
+        }
+    }
+
+    if(primitive < 0) return this->getLowerBound(p);
+
+    return distance;
+}
+
+float32 DistanceField::march(b2Vec2 const & p1, b2Vec2 const & p2, float32 start, float32 end, float32 threshold) const
+{
+    assert(!this->empty() && "Distance field is empty");
+
+    b2Vec2 const d = p2 - p1;
+    float32 const length = d.Length();
+    if(length < b2_epsilon) return end;
+
+    float32 t = start;
+    float32 exit = end;
+    if(!this->clip(p1, d, t, exit)) return end;
+
+    // Inside the sampled area a point is at most half a diagonal away
+    // from its nearest sample
+    float32 const invLength = 1.0f / length;
+    for(uint32_t i = 0; i < MAX_STEPS; ++i)
+    {
+        float32 const bound = m_bounds[this->getNearestSample(p1 + t * d)] * m_quantum - m_halfDiagonal;
+        if(bound < threshold) return t;
+
+        t += bound * invLength;
+        if(t >= exit) return end;
+    }
+
+    return t;
+}
+
+bool DistanceField::clip(b2Vec2 const & p1, b2Vec2 const & d, float32 & start, float32 & end) const
+{
+    float32 const lower[2] = {m_origin.x, m_origin.y};
+    float32 const upper[2] = {
+        m_origin.x + m_cellSize * (m_width - 1),
+        m_origin.y + m_cellSize * (m_height - 1)
+    };
+    float32 const p[2] = {p1.x, p1.y};
+    float32 const v[2] = {d.x, d.y};
+
+    for(uint32_t axis = 0; axis < 2; ++axis)
+    {
+        if(std::abs(v[axis]) < b2_epsilon)
+        {
+            if(p[axis] < lower[axis] || upper[axis] < p[axis]) return false;
+            continue;
+        }
+
+        float32 const inv = 1.0f / v[axis];
+        float32 t1 = (lower[axis] - p[axis]) * inv;
+        float32 t2 = (upper[axis] - p[axis]) * inv;
+        if(t2 < t1) std::swap(t1, t2);
+
+        start = std::max(start, t1);
+        end = std::min(end, t2);
+    }
+
+    return start <= end;
+}
+
+uint32_t DistanceField::getNearestSample(b2Vec2 const & p) const
+{
+    int32 const x = static_cast<int32>((p.x - m_origin.x) * m_invCellSize + 0.5f);
+    int32 const y = static_cast<int32>((p.y - m_origin.y) * m_invCellSize + 0.5f);
+
+    uint32_t const i = static_cast<uint32_t>(b2Clamp(x, 0, static_cast<int32>(m_width) - 1));
+    uint32_t const j = static_cast<uint32_t>(b2Clamp(y, 0, static_cast<int32>(m_height) - 1));
+    return j * m_width + i;
+}
+
+uint32_t DistanceField::getCandidates(b2Vec2 const & p, int32 * candidates) const
+{
+    float32 const maxX = static_cast<float32>(m_width - 2);
+    float32 const maxY = static_cast<float32>(m_height - 2);
+    uint32_t const i = static_cast<uint32_t>(b2Clamp((p.x - m_origin.x) * m_invCellSize, 0.0f, maxX));
+    uint32_t const j = static_cast<uint32_t>(b2Clamp((p.y - m_origin.y) * m_invCellSize, 0.0f, maxY));
+
+    uint32_t const s = j * m_width + i;
+    uint32_t const samples[4] = {s, s + 1, s + m_width, s + m_width + 1};
+
+    uint32_t count = 0;
+    for(auto sample: samples)
+    {
+        int32 const c = m_primitives[sample];
+        if(c >= 0 && std::find(candidates, candidates + count, c) == candidates + count)
+        {
+            candidates[count++] = c;
+        }
+    }
+
+    return count;
+}
+
+float32 DistanceField::getPrimitiveDistance(int32 i, b2Vec2 const & p) const
+{
+    Polygon const & polygon = m_polygons[i];
+    if(polygon.count > 0) return polygonDistance(polygon, p);
+
+    StaticTree::Primitive const & primitive = m_tree->getPrimitive(i);
+    return shapeDistance(primitive.fixture, primitive.childIndex, p);
+}
+
+void DistanceField::computeBand(std::vector<float32> & distances)
+{
+    uint32_t const nbPrimitives = m_tree->getPrimitiveCount();
+    uint32_t const nbTilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t const nbTilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+    float32 const band = BAND_CELLS * m_cellSize;
+
+    // Samples covered by each primitive, its bounds grown by the band
+    std::vector<uint32_t> ranges(4 * nbPrimitives);
+    std::vector<std::vector<int32>> tiles(nbTilesX * nbTilesY);
+    for(uint32_t i = 0; i < nbPrimitives; ++i)
+    {
+        b2AABB const & aabb = m_tree->getPrimitiveBounds(static_cast<int32>(i));
+        b2Vec2 const lower = m_invCellSize * (aabb.lowerBound - m_origin) - b2Vec2(BAND_CELLS, BAND_CELLS);
+        b2Vec2 const upper = m_invCellSize * (aabb.upperBound - m_origin) + b2Vec2(BAND_CELLS, BAND_CELLS);
+
+        uint32_t * range = &ranges[4 * i];
+        range[0] = static_cast<uint32_t>(std::max(std::ceil(lower.x), 0.0f));
+        range[1] = static_cast<uint32_t>(std::max(std::ceil(lower.y), 0.0f));
+        range[2] = std::min(static_cast<uint32_t>(std::max(std::floor(upper.x), 0.0f)), m_width - 1);
+        range[3] = std::min(static_cast<uint32_t>(std::max(std::floor(upper.y), 0.0f)), m_height - 1);
+
+        for(uint32_t ty = range[1] / TILE_SIZE; ty <= range[3] / TILE_SIZE; ++ty)
+        {
+            for(uint32_t tx = range[0] / TILE_SIZE; tx <= range[2] / TILE_SIZE; ++tx)
+            {
+                tiles[ty * nbTilesX + tx].push_back(static_cast<int32>(i));
+            }
+        }
+    }
+
+    // Tiles write disjoint samples, and see their primitives in order: the
+    // field does not depend on the number of threads
+    int32 const nbTiles = static_cast<int32>(tiles.size());
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(int32 t = 0; t < nbTiles; ++t)
+    {
+        uint32_t const tileX = (t % nbTilesX) * TILE_SIZE;
+        uint32_t const tileY = (t / nbTilesX) * TILE_SIZE;
+
+        for(auto i: tiles[t])
+        {
+            uint32_t const * range = &ranges[4 * i];
+
+            uint32_t const x0 = std::max(range[0], tileX);
+            uint32_t const y0 = std::max(range[1], tileY);
+            uint32_t const x1 = std::min(range[2], tileX + TILE_SIZE - 1);
+            uint32_t const y1 = std::min(range[3], tileY + TILE_SIZE - 1);
+
+            for(uint32_t y = y0; y <= y1; ++y)
+            {
+                for(uint32_t x = x0; x <= x1; ++x)
+                {
+                    b2Vec2 const p = m_origin + m_cellSize * b2Vec2(static_cast<float32>(x), static_cast<float32>(y));
+                    float32 const distance = this->getPrimitiveDistance(i, p);
+
+                    uint32_t const s = y * m_width + x;
+                    if(distance < distances[s])
+                    {
+                        distances[s] = distance;
+                        m_primitives[s] = distance < band ? i : -1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void DistanceField::computeFarField(std::vector<float32> & distances)
+{
+    uint32_t const nbSamples = m_width * m_height;
+    float32 const band = BAND_CELLS * m_cellSize;
+
+    // Every point of a primitive is within half a diagonal of a sample:
+    // those samples seed the transform
+    std::vector<float32> squared(nbSamples);
+    for(uint32_t s = 0; s < nbSamples; ++s)
+    {
+        squared[s] = distances[s] <= m_halfDiagonal ? 0.0f : INF;
+    }
+
+    int32 const width = static_cast<int32>(m_width);
+    int32 const height = static_cast<int32>(m_height);
+
+    #pragma omp parallel
+    {
+        uint32_t const n = std::max(m_width, m_height);
+        std::vector<float32> f(n);
+        std::vector<float32> d(n);
+        std::vector<int32> v(n);
+        std::vector<float32> z(n + 1);
+
+        #pragma omp for schedule(static)
+        for(int32 x = 0; x < width; ++x)
+        {
+            for(int32 y = 0; y < height; ++y) f[y] = squared[y * width + x];
+            transform(f.data(), m_height, d.data(), v.data(), z.data());
+            for(int32 y = 0; y < height; ++y) squared[y * width + x] = d[y];
+        }
+
+        #pragma omp for schedule(static)
+        for(int32 y = 0; y < height; ++y)
+        {
+            float32 * row = &squared[y * width];
+            std::copy(row, row + width, f.begin());
+            transform(f.data(), m_width, row, v.data(), z.data());
+        }
+    }
+
+    // Samples out of the band of a primitive are at least the band away
+    // from it, and within half a diagonal of the closest seed. Rounded
+    // down to a quantum, inside the geometry as 0.
+    float32 const maxQuanta = static_cast<float32>(UINT8_MAX);
+    m_bounds.resize(nbSamples);
+    for(uint32_t s = 0; s < nbSamples; ++s)
+    {
+        float32 const far = std::sqrt(squared[s]) * m_cellSize - m_halfDiagonal;
+        float32 const distance = std::min(distances[s], std::max(band, far));
+        m_bounds[s] = static_cast<uint8_t>(b2Clamp(std::floor(distance / m_quantum), 0.0f, maxQuanta));
+    }
+}
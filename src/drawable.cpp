@@ -2,11 +2,11 @@
 
 #include <cassert>
 
+#include <snapshot.hpp>
+
 Drawable::Drawable():
-    m_shape(),
     m_body(nullptr),
-    m_bodyDef(),
-    m_fixtureDef(),
+    m_owner(this),
     m_markedForDeath(false)
     #if CAR_PHYSICS_GRAPHIC_MODE_SFML
     , m_color(255, 255, 255)
@@ -21,7 +21,38 @@ Drawable::~Drawable()
 
 }
 
-void Drawable::update(World const *)
+Drawable * Drawable::getOwner() const
+{
+    return m_owner;
+}
+
+void Drawable::setOwner(Drawable * owner)
+{
+    assert(owner && "Owner is null");
+
+    m_owner = owner;
+
+    if(m_body)
+    {
+        for(b2Fixture * f = m_body->GetFixtureList(); f; f = f->GetNext())
+        {
+            f->SetUserData(owner);
+        }
+    }
+}
+
+void Drawable::update(World const * w)
+{
+    this->sense(w);
+    this->act(w);
+}
+
+void Drawable::sense(World const *)
+{
+
+}
+
+void Drawable::act(World const *)
 {
 
 }
@@ -31,6 +62,32 @@ void Drawable::die(World const *)
     m_markedForDeath = true;
 }
 
+bool Drawable::isSleeping() const
+{
+    return false;
+}
+
+void Drawable::saveState(Snapshot & s) const
+{
+    assert(m_body && "m_body is null");
+
+    // Static bodies never move
+    if(m_body->GetType() != b2_staticBody)
+    {
+        s.writeBody(m_body);
+    }
+}
+
+void Drawable::restoreState(Snapshot const & s, std::size_t & offset)
+{
+    assert(m_body && "m_body is null");
+
+    if(m_body->GetType() != b2_staticBody)
+    {
+        s.readBody(offset, m_body);
+    }
+}
+
 #if CAR_PHYSICS_GRAPHIC_MODE_SFML
 sf::ConvexShape Drawable::getShape(float scale)
 {
@@ -55,9 +112,25 @@ sf::ConvexShape Drawable::getShape(float scale)
 }
 #endif // CAR_PHYSICS_GRAPHIC_MODE_SFML
 
-b2BodyDef const * Drawable::getBodyDef() const
+void Drawable::define(DrawableDef & def) const
+{
+    def.fixture.density = 1.0f;
+    def.fixture.friction = 0.3f;
+}
+
+b2Body * Drawable::createBody(b2World * w, bool active) const
 {
-    return &m_bodyDef;
+    assert(w && "b2World is null");
+
+    DrawableDef def;
+    this->define(def);
+    def.body.active = active;
+
+    b2Body * body = w->CreateBody(&def.body);
+    def.fixture.shape = &def.shape;
+    def.fixture.userData = m_owner;
+    body->CreateFixture(&def.fixture);
+    return body;
 }
 
 b2Body * Drawable::getBody()
@@ -68,10 +141,6 @@ b2Body * Drawable::getBody()
 void Drawable::setBody(b2Body * body, World *)
 {
     m_body = body;
-    if(m_body)
-    {
-        m_body->CreateFixture(&m_fixtureDef);
-    }
 }
 
 bool Drawable::isColliding() const
@@ -91,6 +160,25 @@ bool Drawable::isColliding() const
     return false;
 }
 
+void Drawable::resetBody(b2Vec2 const & position, float32 angle)
+{
+    assert(m_body && "m_body is null");
+
+    m_body->SetTransform(position, angle);
+
+    b2BodyState state;
+    m_body->GetState(&state);
+    state.linearVelocity.SetZero();
+    state.angularVelocity = 0.0f;
+    state.force.SetZero();
+    state.torque = 0.0f;
+    state.sleepTime = 0.0f;
+    state.awake = true;
+    m_body->SetState(state);
+
+    m_body->SetActive(true);
+}
+
 bool Drawable::isMarkedForDeath() const
 {
     return m_markedForDeath;
@@ -109,3 +197,8 @@ void Drawable::onRemoveFromWorld(b2World * w)
     w->DestroyBody(m_body);
     this->setBody(nullptr);
 }
+
+bool Drawable::recycle()
+{
+    return false;
+}
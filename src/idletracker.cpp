@@ -0,0 +1,43 @@
+#include <idletracker.hpp>
+
+IdleTracker::IdleTracker()
+    : m_anchor(0.0, 0.0)
+    , m_anchorSteps(0)
+    , m_slowSteps(0)
+{
+
+}
+
+void IdleTracker::reset(b2Vec2 const & position)
+{
+    m_anchor = position;
+    m_anchorSteps = 0;
+    m_slowSteps = 0;
+}
+
+bool IdleTracker::update(IdleDef const & def, b2Vec2 const & position, b2Vec2 const & velocity)
+{
+    if(def.steps == 0) return false;
+
+    if(velocity.LengthSquared() < def.minSpeed * def.minSpeed)
+    {
+        ++m_slowSteps;
+    }
+    else
+    {
+        m_slowSteps = 0;
+    }
+
+    // Progress is measured from the last point the car moved away from
+    if((position - m_anchor).LengthSquared() > def.minProgress * def.minProgress)
+    {
+        m_anchor = position;
+        m_anchorSteps = 0;
+    }
+    else
+    {
+        ++m_anchorSteps;
+    }
+
+    return m_slowSteps >= def.steps || m_anchorSteps >= def.steps;
+}
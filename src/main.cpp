@@ -23,6 +23,8 @@ int main()
 
     w.randomize(worldWidth, worldHeight, 15);
 
+    w.bakeStaticGeometry();
+
 
     // A car
 
@@ -57,7 +59,7 @@ int main()
     carDef.raycastAngles.push_back(-3.0f*b2_pi/8.0f);
 
 
-    std::shared_ptr<Car> car = std::make_shared<Car>(carDef);
+    std::shared_ptr<Car> car = w.create<Car>(carDef);
 
     w.addRequiredDrawable(car);
 
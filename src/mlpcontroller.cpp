@@ -0,0 +1,256 @@
+#include <mlpcontroller.hpp>
+
+#include <cassert>
+#include <cmath>
+
+// The AVX2 kernel is compiled for its own target and picked at run time,
+// a generic build uses it on the CPUs that have it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CAR_PHYSICS_MLP_AVX2 1
+#include <immintrin.h>
+#else
+#define CAR_PHYSICS_MLP_AVX2 0
+#endif
+
+#include <simd.hpp>
+
+namespace
+{
+    uint32_t padTo8(uint32_t n)
+    {
+        return (n + 7u) & ~7u;
+    }
+
+    void multiplyScalar(
+        float32 const * in, uint32_t inStride, uint32_t nbRows, uint32_t nbInputs,
+        float32 const * weights, float32 const * biases, uint32_t stride, float32 * out
+    )
+    {
+        for(uint32_t r = 0; r < nbRows; ++r)
+        {
+            float32 const * x = in + r * inStride;
+            float32 * y = out + r * stride;
+
+            for(uint32_t o = 0; o < stride; ++o) y[o] = biases[o];
+
+            for(uint32_t k = 0; k < nbInputs; ++k)
+            {
+                float32 const * w = weights + k * stride;
+                for(uint32_t o = 0; o < stride; ++o) y[o] += x[k] * w[o];
+            }
+        }
+    }
+
+    void multiplySse(
+        float32 const * in, uint32_t inStride, uint32_t nbRows, uint32_t nbInputs,
+        float32 const * weights, float32 const * biases, uint32_t stride, float32 * out
+    )
+    {
+        using namespace simd;
+
+        for(uint32_t r = 0; r < nbRows; ++r)
+        {
+            float32 const * x = in + r * inStride;
+            float32 * y = out + r * stride;
+
+            for(uint32_t o = 0; o < stride; o += 4)
+            {
+                f32x4 acc = load(biases + o);
+                for(uint32_t k = 0; k < nbInputs; ++k)
+                {
+                    acc = acc + set1(x[k]) * load(weights + k * stride + o);
+                }
+                store(y + o, acc);
+            }
+        }
+    }
+
+    #if CAR_PHYSICS_MLP_AVX2
+    __attribute__((target("avx2,fma")))
+    void multiplyAvx2(
+        float32 const * in, uint32_t inStride, uint32_t nbRows, uint32_t nbInputs,
+        float32 const * weights, float32 const * biases, uint32_t stride, float32 * out
+    )
+    {
+        for(uint32_t r = 0; r < nbRows; ++r)
+        {
+            float32 const * x = in + r * inStride;
+            float32 * y = out + r * stride;
+
+            for(uint32_t o = 0; o < stride; o += 8)
+            {
+                __m256 acc = _mm256_loadu_ps(biases + o);
+                for(uint32_t k = 0; k < nbInputs; ++k)
+                {
+                    __m256 w = _mm256_loadu_ps(weights + k * stride + o);
+                    acc = _mm256_fmadd_ps(_mm256_set1_ps(x[k]), w, acc);
+                }
+                _mm256_storeu_ps(y + o, acc);
+            }
+        }
+    }
+    #endif
+}
+
+uint32_t const MlpController::NB_OUTPUTS;
+
+MlpController::MlpController(std::vector<uint32_t> const & layerSizes)
+    : BatchController()
+    , m_layers()
+    , m_kernel(SCALAR)
+{
+    assert(!layerSizes.empty() && "The network needs inputs");
+
+    std::vector<uint32_t> sizes = layerSizes;
+    sizes.push_back(NB_OUTPUTS);
+
+    for(auto i = 1u; i < sizes.size(); ++i)
+    {
+        Layer layer;
+        layer.nbInputs = sizes[i - 1];
+        layer.nbOutputs = sizes[i];
+        layer.stride = padTo8(layer.nbOutputs);
+        layer.weights.assign(layer.nbInputs * layer.stride, 0.0f);
+        layer.biases.assign(layer.stride, 0.0f);
+        m_layers.push_back(layer);
+    }
+
+    if(MlpController::hasKernel(AVX2))     m_kernel = AVX2;
+    else if(MlpController::hasKernel(SSE)) m_kernel = SSE;
+}
+
+MlpController::~MlpController()
+{
+
+}
+
+uint32_t MlpController::getWeightCount() const
+{
+    uint32_t count = 0;
+    for(auto const & layer: m_layers)
+    {
+        count += (layer.nbInputs + 1) * layer.nbOutputs;
+    }
+    return count;
+}
+
+void MlpController::setWeights(std::vector<float32> const & weights)
+{
+    assert(weights.size() == this->getWeightCount());
+
+    auto it = weights.begin();
+    for(auto & layer: m_layers)
+    {
+        for(uint32_t o = 0; o < layer.nbOutputs; ++o)
+        {
+            for(uint32_t k = 0; k < layer.nbInputs; ++k)
+            {
+                layer.weights[k * layer.stride + o] = *it++;
+            }
+        }
+        for(uint32_t o = 0; o < layer.nbOutputs; ++o)
+        {
+            layer.biases[o] = *it++;
+        }
+    }
+}
+
+void MlpController::setKernel(Kernel kernel)
+{
+    assert(MlpController::hasKernel(kernel) && "Kernel not compiled in");
+    m_kernel = kernel;
+}
+
+MlpController::Kernel MlpController::getKernel() const
+{
+    return m_kernel;
+}
+
+bool MlpController::hasKernel(Kernel kernel)
+{
+    switch(kernel)
+    {
+        case SCALAR: return true;
+        case SSE:    return CAR_PHYSICS_SIMD_SSE != 0;
+        #if CAR_PHYSICS_MLP_AVX2
+        case AVX2:   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        #else
+        case AVX2:   return false;
+        #endif
+        default:     return false;
+    }
+}
+
+void MlpController::multiply(
+    Layer const & layer, float32 const * in, uint32_t inStride, uint32_t nbRows, float32 * out
+) const
+{
+    float32 const * w = layer.weights.data();
+    float32 const * b = layer.biases.data();
+
+    switch(m_kernel)
+    {
+        #if CAR_PHYSICS_MLP_AVX2
+        case AVX2:
+            multiplyAvx2(in, inStride, nbRows, layer.nbInputs, w, b, layer.stride, out);
+            break;
+        #endif
+
+        case SSE:
+            multiplySse(in, inStride, nbRows, layer.nbInputs, w, b, layer.stride, out);
+            break;
+
+        default:
+            multiplyScalar(in, inStride, nbRows, layer.nbInputs, w, b, layer.stride, out);
+            break;
+    }
+}
+
+void MlpController::updateBatch(
+    float32 const * sensors, uint32_t nbCars, uint32_t nbSensors, int32_t * flags
+) const
+{
+    assert(nbSensors == m_layers.front().nbInputs && "Sensor count does not match the network");
+
+    // Scratch activations, reused between calls of the same thread
+    static thread_local std::vector<float32> bufferA;
+    static thread_local std::vector<float32> bufferB;
+
+    float32 const * in = sensors;
+    uint32_t inStride = nbSensors;
+
+    for(auto l = 0u; l < m_layers.size(); ++l)
+    {
+        Layer const & layer = m_layers[l];
+
+        std::vector<float32> & out = (l % 2 == 0) ? bufferA : bufferB;
+        if(out.size() < nbCars * layer.stride)
+        {
+            out.resize(nbCars * layer.stride);
+        }
+
+        this->multiply(layer, in, inStride, nbCars, out.data());
+
+        // Hidden layers activation
+        if(l + 1 < m_layers.size())
+        {
+            for(uint32_t i = 0; i < nbCars * layer.stride; ++i)
+            {
+                out[i] = std::tanh(out[i]);
+            }
+        }
+
+        in = out.data();
+        inStride = layer.stride;
+    }
+
+    for(uint32_t c = 0; c < nbCars; ++c)
+    {
+        int32_t f = 0;
+        for(uint32_t o = 0; o < NB_OUTPUTS; ++o)
+        {
+            if(in[c * inStride + o] > 0.0f) f |= 1 << o;
+        }
+        flags[c] = f;
+    }
+}
@@ -0,0 +1,514 @@
+#include <obstaclegenerator.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <ctime>
+#include <memory>
+#include <random>
+
+#include <spatialhash.hpp>
+
+namespace
+{
+    typedef ObstacleGenerator::Obstacle Obstacle;
+
+    // Obstacle with its rotation and bounds, computed once
+    struct Box
+    {
+        explicit Box(Obstacle const & o)
+            : center(o.position)
+            , q(o.angle)
+            , halfSize(o.width / 2.0f, o.height / 2.0f)
+            , extents(
+                std::abs(q.c) * halfSize.x + std::abs(q.s) * halfSize.y,
+                std::abs(q.s) * halfSize.x + std::abs(q.c) * halfSize.y
+            )
+        {
+
+        }
+
+        b2AABB getAABB(float32 margin) const
+        {
+            b2Vec2 const m(margin, margin);
+
+            b2AABB aabb;
+            aabb.lowerBound = center - extents - m;
+            aabb.upperBound = center + extents + m;
+            return aabb;
+        }
+
+        // Half length of the projection on a unit axis
+        float32 getRadius(b2Vec2 const & axis) const
+        {
+            return halfSize.x * std::abs(b2Dot(q.GetXAxis(), axis))
+                + halfSize.y * std::abs(b2Dot(q.GetYAxis(), axis));
+        }
+
+        // Largest gap between the projections of the boxes on their axes:
+        // the distance between them, or less near the corners. 0 if they
+        // overlap.
+        float32 getSeparation(Box const & other) const
+        {
+            b2Vec2 const d = other.center - center;
+
+            // Axis aligned bounds first, they cost nothing
+            float32 gap = std::max(
+                std::abs(d.x) - extents.x - other.extents.x,
+                std::abs(d.y) - extents.y - other.extents.y
+            );
+
+            b2Vec2 const axes[4] = {q.GetXAxis(), q.GetYAxis(), other.q.GetXAxis(), other.q.GetYAxis()};
+            for(auto const & axis: axes)
+            {
+                gap = std::max(gap, std::abs(b2Dot(d, axis)) - this->getRadius(axis) - other.getRadius(axis));
+            }
+            return std::max(gap, 0.0f);
+        }
+
+        float32 getDistance(b2Vec2 const & p) const
+        {
+            b2Vec2 const local = b2MulT(q, p - center);
+            float32 const dx = std::max(std::abs(local.x) - halfSize.x, 0.0f);
+            float32 const dy = std::max(std::abs(local.y) - halfSize.y, 0.0f);
+            return std::sqrt(dx * dx + dy * dy);
+        }
+
+        bool overlapsSquare(b2Vec2 const & squareCenter, float32 squareHalfSize) const
+        {
+            b2Vec2 const d = squareCenter - center;
+
+            if(std::abs(d.x) > squareHalfSize + extents.x) return false;
+            if(std::abs(d.y) > squareHalfSize + extents.y) return false;
+
+            float32 const squareRadius = squareHalfSize * (std::abs(q.c) + std::abs(q.s));
+            if(std::abs(b2Dot(d, q.GetXAxis())) > halfSize.x + squareRadius) return false;
+            if(std::abs(b2Dot(d, q.GetYAxis())) > halfSize.y + squareRadius) return false;
+            return true;
+        }
+
+        b2Vec2 center;
+        b2Rot q;
+        b2Vec2 halfSize;
+        b2Vec2 extents;     // Of the axis aligned bounds
+    };
+
+    class GapQuery
+    {
+    public:
+        GapQuery(std::vector<Box> const & boxes, Box const & candidate, float32 minGap)
+            : boxes(boxes)
+            , candidate(candidate)
+            , minGap(minGap)
+            , rejected(false)
+        {
+
+        }
+
+        bool QueryItem(uint32_t item)
+        {
+            rejected = candidate.getSeparation(boxes[item]) <= minGap;
+            return !rejected;
+        }
+
+        std::vector<Box> const & boxes;
+        Box const & candidate;
+        float32 minGap;
+        bool rejected;
+    };
+
+    class KeepOutQuery
+    {
+    public:
+        KeepOutQuery(std::vector<b2Vec2> const & points, Box const & candidate, float32 radius)
+            : points(points)
+            , candidate(candidate)
+            , aabb(candidate.getAABB(radius))
+            , radius(radius)
+            , rejected(false)
+        {
+
+        }
+
+        bool QueryItem(uint32_t item)
+        {
+            b2Vec2 const & p = points[item];
+            if(p.x < aabb.lowerBound.x || p.x > aabb.upperBound.x) return true;
+            if(p.y < aabb.lowerBound.y || p.y > aabb.upperBound.y) return true;
+
+            rejected = candidate.getDistance(p) < radius;
+            return !rejected;
+        }
+
+        std::vector<b2Vec2> const & points;
+        Box const & candidate;
+        b2AABB aabb;
+        float32 radius;
+        bool rejected;
+    };
+
+    // Coarse grid of the track, a cell is blocked once a box touches it.
+    // Blocking keeps the free cells connected (4-neighbourhood).
+    class ReachabilityGrid
+    {
+    public:
+        ReachabilityGrid(float32 width, float32 height, float32 cellSize)
+            : cellSize(cellSize)
+            , nx(std::max(1, static_cast<int32>(std::ceil(width / cellSize))))
+            , ny(std::max(1, static_cast<int32>(std::ceil(height / cellSize))))
+            , nbFree(static_cast<uint32_t>(nx * ny))
+            , blocked(nbFree, 0)
+            , visits(nbFree, 0)
+            , labels(nbFree, 0)
+            , visit(0)
+            , cells()
+            , seeds()
+            , parents()
+            , fronts()
+            , next()
+        {
+
+        }
+
+        // Blocks the cells of the box, unless that splits the free cells
+        bool tryBlock(Box const & box)
+        {
+            b2AABB const aabb = box.getAABB(0.0f);
+
+            int32 const x0 = std::max(0, static_cast<int32>(std::floor(aabb.lowerBound.x / cellSize)));
+            int32 const y0 = std::max(0, static_cast<int32>(std::floor(aabb.lowerBound.y / cellSize)));
+            int32 const x1 = std::min(nx - 1, static_cast<int32>(std::floor(aabb.upperBound.x / cellSize)));
+            int32 const y1 = std::min(ny - 1, static_cast<int32>(std::floor(aabb.upperBound.y / cellSize)));
+
+            // Bounds of the newly blocked cells
+            int32 bx0 = nx, by0 = ny, bx1 = -1, by1 = -1;
+
+            cells.clear();
+            for(int32 y = y0; y <= y1; ++y)
+            {
+                for(int32 x = x0; x <= x1; ++x)
+                {
+                    uint32_t const i = static_cast<uint32_t>(y * nx + x);
+                    b2Vec2 const center((x + 0.5f) * cellSize, (y + 0.5f) * cellSize);
+                    if(blocked[i] || !box.overlapsSquare(center, 0.5f * cellSize)) continue;
+
+                    cells.push_back(i);
+                    bx0 = std::min(bx0, x);
+                    by0 = std::min(by0, y);
+                    bx1 = std::max(bx1, x);
+                    by1 = std::max(by1, y);
+                }
+            }
+
+            if(cells.empty()) return true;
+            if(cells.size() >= nbFree) return false;
+
+            for(auto i: cells) blocked[i] = 1;
+
+            // Free cells around the blocked ones connected among themselves
+            // is enough: any path through the blocked cells goes around.
+            // Otherwise, each piece has to meet the others further away.
+            this->findPieces(bx0 - 1, by0 - 1, bx1 + 1, by1 + 1);
+            bool const connected = seeds.size() <= 1 || this->joinPieces();
+
+            if(connected)
+            {
+                nbFree -= static_cast<uint32_t>(cells.size());
+            }
+            else
+            {
+                for(auto i: cells) blocked[i] = 0;
+            }
+            return connected;
+        }
+
+        // One seed cell per connected piece of the free cells of the
+        // rectangle, connected inside it
+        void findPieces(int32 x0, int32 y0, int32 x1, int32 y1)
+        {
+            x0 = std::max(x0, 0);
+            y0 = std::max(y0, 0);
+            x1 = std::min(x1, nx - 1);
+            y1 = std::min(y1, ny - 1);
+
+            ++visit;
+            seeds.clear();
+
+            for(int32 y = y0; y <= y1; ++y)
+            {
+                for(int32 x = x0; x <= x1; ++x)
+                {
+                    uint32_t const i = static_cast<uint32_t>(y * nx + x);
+                    if(blocked[i] || visits[i] == visit) continue;
+
+                    seeds.push_back(i);
+                    visits[i] = visit;
+                    next.assign(1, i);
+                    while(!next.empty())
+                    {
+                        uint32_t const c = next.back();
+                        next.pop_back();
+
+                        int32 const cx = static_cast<int32>(c) % nx;
+                        int32 const cy = static_cast<int32>(c) / nx;
+                        int32 const neighbours[4][2] = {{cx - 1, cy}, {cx + 1, cy}, {cx, cy - 1}, {cx, cy + 1}};
+                        for(auto const & n: neighbours)
+                        {
+                            if(n[0] < x0 || n[0] > x1 || n[1] < y0 || n[1] > y1) continue;
+
+                            uint32_t const j = static_cast<uint32_t>(n[1] * nx + n[0]);
+                            if(blocked[j] || visits[j] == visit) continue;
+
+                            visits[j] = visit;
+                            next.push_back(j);
+                        }
+                    }
+                }
+            }
+        }
+
+        // Floods the whole grid from every seed at once, one layer each in
+        // turn, merging pieces that meet. A piece whose flood ends before it
+        // met all the others is enclosed. The cost is about the size of the
+        // smallest enclosed piece, or of the detours joining them.
+        bool joinPieces()
+        {
+            uint32_t const nbSeeds = static_cast<uint32_t>(seeds.size());
+
+            ++visit;
+            parents.resize(nbSeeds);
+            fronts.resize(nbSeeds);
+            for(uint32_t s = 0; s < nbSeeds; ++s)
+            {
+                parents[s] = s;
+                fronts[s].assign(1, seeds[s]);
+                visits[seeds[s]] = visit;
+                labels[seeds[s]] = s;
+            }
+
+            uint32_t nbGroups = nbSeeds;
+            while(nbGroups > 1)
+            {
+                for(uint32_t s = 0; s < nbSeeds && nbGroups > 1; ++s)
+                {
+                    next.clear();
+                    for(auto c: fronts[s])
+                    {
+                        int32 const cx = static_cast<int32>(c) % nx;
+                        int32 const cy = static_cast<int32>(c) / nx;
+                        int32 const neighbours[4][2] = {{cx - 1, cy}, {cx + 1, cy}, {cx, cy - 1}, {cx, cy + 1}};
+                        for(auto const & n: neighbours)
+                        {
+                            if(n[0] < 0 || n[0] >= nx || n[1] < 0 || n[1] >= ny) continue;
+
+                            uint32_t const j = static_cast<uint32_t>(n[1] * nx + n[0]);
+                            if(blocked[j]) continue;
+
+                            if(visits[j] != visit)
+                            {
+                                visits[j] = visit;
+                                labels[j] = s;
+                                next.push_back(j);
+                            }
+                            else if(this->merge(s, labels[j]))
+                            {
+                                --nbGroups;
+                            }
+                        }
+                    }
+                    fronts[s].swap(next);
+                }
+
+                // A group is done once all of its floods are
+                for(uint32_t s = 0; s < nbSeeds && nbGroups > 1; ++s)
+                {
+                    if(parents[s] != s) continue;
+
+                    bool done = true;
+                    for(uint32_t t = 0; t < nbSeeds && done; ++t)
+                    {
+                        done = this->find(t) != s || fronts[t].empty();
+                    }
+                    if(done) return false;
+                }
+            }
+
+            return true;
+        }
+
+        uint32_t find(uint32_t s)
+        {
+            while(parents[s] != s) s = parents[s] = parents[parents[s]];
+            return s;
+        }
+
+        // True if a and b were in different groups
+        bool merge(uint32_t a, uint32_t b)
+        {
+            a = this->find(a);
+            b = this->find(b);
+            if(a == b) return false;
+
+            parents[std::max(a, b)] = std::min(a, b);
+            return true;
+        }
+
+        float32 cellSize;
+        int32 nx;
+        int32 ny;
+        uint32_t nbFree;
+        std::vector<uint8_t> blocked;
+        std::vector<uint32_t> visits;
+        std::vector<uint32_t> labels;
+        uint32_t visit;
+        std::vector<uint32_t> cells;
+        std::vector<uint32_t> seeds;
+        std::vector<uint32_t> parents;
+        std::vector<std::vector<uint32_t>> fronts;
+        std::vector<uint32_t> next;
+    };
+}
+
+ObstacleGenerator::ObstacleGenerator(ObstacleDef const & def)
+    : m_def(def)
+    , m_obstacles()
+    , m_rejections()
+{
+
+}
+
+ObstacleGenerator::~ObstacleGenerator()
+{
+
+}
+
+std::vector<ObstacleGenerator::Obstacle> const & ObstacleGenerator::generate()
+{
+    m_obstacles.clear();
+    m_obstacles.reserve(m_def.count);
+    m_rejections = Rejections();
+
+    uint32_t seed = m_def.seed;
+    if(seed == 0)
+    {
+        seed = static_cast<uint32_t>(std::time(0));
+    }
+
+    std::mt19937 rng(seed);
+
+    std::uniform_int_distribution<uint32_t> heightDistribution(0, m_def.height);
+    std::uniform_int_distribution<uint32_t> widthDistribution(0, m_def.width);
+    std::uniform_int_distribution<uint32_t> angleDistribution(0, 359);
+    std::normal_distribution<float32> sizeDistribution(m_def.meanSize, m_def.sizeDeviation);
+
+    bool const checkGap = m_def.minGap >= 0.0f;
+    bool const checkKeepOut = !m_def.keepOut.empty() && m_def.keepOutRadius > 0.0f;
+    bool const checkReachability = m_def.gridCellSize > 0.0f;
+
+    // Cells about the size of a box, and about as many buckets as cells
+    // on the track: compact, and few cells share a bucket
+    float32 const boxCellSize = std::max(m_def.meanSize + m_def.sizeDeviation + std::max(m_def.minGap, 0.0f), 1.0f);
+    uint32_t const nbBoxCells = static_cast<uint32_t>(
+        std::ceil(m_def.width / boxCellSize + 1.0f) * std::ceil(m_def.height / boxCellSize + 1.0f)
+    );
+    SpatialHash boxes(boxCellSize, std::min(nbBoxCells, 2 * m_def.count));
+
+    SpatialHash keepOut(std::max(2.0f * m_def.keepOutRadius, 1.0f), 2 * static_cast<uint32_t>(m_def.keepOut.size()));
+    for(uint32_t p = 0; checkKeepOut && p < m_def.keepOut.size(); ++p)
+    {
+        b2Vec2 const extents(m_def.keepOutRadius, m_def.keepOutRadius);
+        b2AABB aabb;
+        aabb.lowerBound = m_def.keepOut[p] - extents;
+        aabb.upperBound = m_def.keepOut[p] + extents;
+        keepOut.insert(p, aabb);
+    }
+
+    std::unique_ptr<ReachabilityGrid> grid;
+    if(checkReachability)
+    {
+        grid.reset(new ReachabilityGrid(
+            static_cast<float32>(m_def.width), static_cast<float32>(m_def.height), m_def.gridCellSize
+        ));
+    }
+
+    uint32_t const maxTries = std::max(1u, m_def.maxTries);
+
+    // Boxes of the obstacles placed so far, for the gap rule
+    std::vector<Box> placedBoxes;
+    if(checkGap) placedBoxes.reserve(m_def.count);
+
+    for(uint32_t i = 0; i < m_def.count; ++i)
+    {
+        bool placed = false;
+        for(uint32_t t = 0; t < maxTries && !placed; ++t)
+        {
+            // Reverse order: the first versions drew them as the arguments
+            // of a single call, and gcc evaluates those right to left
+            Obstacle o;
+            o.height = std::abs(sizeDistribution(rng));
+            o.width = std::abs(sizeDistribution(rng));
+            o.angle = static_cast<float32>(angleDistribution(rng));
+            o.position.y = static_cast<float32>(heightDistribution(rng));
+            o.position.x = static_cast<float32>(widthDistribution(rng));
+
+            if(!checkGap && !checkKeepOut && !checkReachability)
+            {
+                m_obstacles.push_back(o);
+                placed = true;
+                continue;
+            }
+
+            Box const box(o);
+
+            if(checkKeepOut)
+            {
+                KeepOutQuery query(m_def.keepOut, box, m_def.keepOutRadius);
+                keepOut.query(&query, query.aabb);
+                if(query.rejected)
+                {
+                    ++m_rejections.keepOut;
+                    continue;
+                }
+            }
+
+            if(checkGap)
+            {
+                GapQuery query(placedBoxes, box, m_def.minGap);
+                boxes.query(&query, box.getAABB(m_def.minGap));
+                if(query.rejected)
+                {
+                    ++m_rejections.gap;
+                    continue;
+                }
+            }
+
+            if(checkReachability && !grid->tryBlock(box))
+            {
+                ++m_rejections.reachability;
+                continue;
+            }
+
+            if(checkGap)
+            {
+                boxes.insert(static_cast<uint32_t>(placedBoxes.size()), box.getAABB(0.0f));
+                placedBoxes.push_back(box);
+            }
+            m_obstacles.push_back(o);
+            placed = true;
+        }
+
+        if(!placed) ++m_rejections.dropped;
+    }
+
+    return m_obstacles;
+}
+
+std::vector<ObstacleGenerator::Obstacle> const & ObstacleGenerator::getObstacles() const
+{
+    return m_obstacles;
+}
+
+ObstacleGenerator::Rejections const & ObstacleGenerator::getRejections() const
+{
+    return m_rejections;
+}
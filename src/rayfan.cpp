@@ -0,0 +1,444 @@
+#include <rayfan.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+
+#include <distancefield.hpp>
+#include <sensortable.hpp>
+#include <sensortracker.hpp>
+#include <simd.hpp>
+#include <statictree.hpp>
+
+namespace
+{
+    // Windows cast exactly once a ray got close to the geometry, in cells,
+    // and number of them before the rest of the ray is cast at once
+    float32 const WINDOW_CELLS = 8.0f;
+    uint32_t const NB_WINDOWS = 2;
+
+    // Avoid infinities in the slab test for axis aligned rays
+    float32 safeInverse(float32 d)
+    {
+        float32 const epsilon = 1e-12f;
+        if(std::abs(d) < epsilon)
+        {
+            d = d < 0.0f ? -epsilon : epsilon;
+        }
+        return 1.0f / d;
+    }
+}
+
+uint32_t const RayFan::MAX_RAYS;
+
+RayFan::RayFan()
+    : m_broadPhase(nullptr)
+    , m_skipped(nullptr)
+    , m_owner(nullptr)
+    , m_origin(0.0f, 0.0f)
+    , m_nbRays(0)
+    , m_nbGroups(0)
+    , m_endX()
+    , m_endY()
+    , m_invDirX()
+    , m_invDirY()
+    , m_fractions()
+    , m_starts()
+    , m_fixtures()
+    , m_childIndices()
+    , m_nodeMasks()
+{
+
+}
+
+RayFan::~RayFan()
+{
+
+}
+
+void RayFan::reset(b2Vec2 const & origin, uint32_t nbRays, void const * owner)
+{
+    assert(nbRays <= MAX_RAYS && "Too many rays");
+
+    m_owner = owner;
+    m_origin = origin;
+    m_nbRays = nbRays;
+    m_nbGroups = (nbRays + 3) / 4;
+
+    uint32_t padded = 4 * m_nbGroups;
+
+    // Padding rays are degenerated and can never hit anything
+    std::fill(m_endX, m_endX + padded, origin.x);
+    std::fill(m_endY, m_endY + padded, origin.y);
+    std::fill(m_invDirX, m_invDirX + padded, 0.0f);
+    std::fill(m_invDirY, m_invDirY + padded, 0.0f);
+    std::fill(m_fractions, m_fractions + padded, -1.0f);
+    std::fill(m_starts, m_starts + padded, 0.0f);
+    std::fill(m_fixtures, m_fixtures + padded, nullptr);
+    std::fill(m_childIndices, m_childIndices + padded, 0);
+    std::fill(m_nodeMasks, m_nodeMasks + m_nbGroups, 0);
+}
+
+void RayFan::setEnd(uint32_t i, b2Vec2 const & end)
+{
+    assert(i < m_nbRays);
+
+    m_endX[i] = end.x;
+    m_endY[i] = end.y;
+    m_invDirX[i] = safeInverse(end.x - m_origin.x);
+    m_invDirY[i] = safeInverse(end.y - m_origin.y);
+    m_fractions[i] = 1.0f;
+}
+
+void RayFan::cast(b2World const * w, std::vector<b2Body *> const * skipped)
+{
+    assert(w && "b2World is null");
+
+    if(m_nbRays == 0) return;
+
+    m_broadPhase = &w->GetContactManager().m_broadPhase;
+    m_skipped = skipped && !skipped->empty() ? skipped : nullptr;
+    m_broadPhase->Traverse(this);
+    m_broadPhase = nullptr;
+    m_skipped = nullptr;
+}
+
+void RayFan::cast(StaticTree const * tree)
+{
+    assert(tree && "StaticTree is null");
+
+    if(m_nbRays == 0) return;
+
+    tree->traverse(this);
+}
+
+void RayFan::cast(DistanceField const * field, StaticTree const * tree)
+{
+    assert(field && "DistanceField is null");
+    assert(tree && "StaticTree is null");
+
+    if(m_nbRays == 0) return;
+
+    float32 const threshold = field->getCellSize();
+
+    // Fractions before the static geometry, and fixtures hit so far
+    float32 ends[MAX_RAYS];
+    b2Fixture * fixtures[MAX_RAYS];
+    bool pending[MAX_RAYS];
+    for(uint32_t i = 0; i < m_nbRays; ++i)
+    {
+        ends[i] = m_fractions[i];
+        pending[i] = true;
+    }
+
+    for(uint32_t window = 0; window <= NB_WINDOWS; ++window)
+    {
+        bool any = false;
+        for(uint32_t i = 0; i < m_nbRays; ++i)
+        {
+            if(!pending[i]) continue;
+
+            b2Vec2 const end(m_endX[i], m_endY[i]);
+            float32 const start = field->march(m_origin, end, m_starts[i], ends[i], threshold);
+
+            // Rays that are done fail the slab test from now on
+            if(start >= ends[i])
+            {
+                pending[i] = false;
+                m_starts[i] = b2_maxFloat;
+                continue;
+            }
+
+            // [0, start] is free: the first hit is at most a window ahead,
+            // the last window goes to the end of the ray
+            float32 const length = b2Distance(m_origin, end);
+            m_starts[i] = start;
+            m_fractions[i] = window < NB_WINDOWS ? std::min(ends[i], start + WINDOW_CELLS * threshold / length) : ends[i];
+            fixtures[i] = m_fixtures[i];
+            any = true;
+        }
+
+        if(!any) break;
+
+        tree->traverse(this);
+
+        for(uint32_t i = 0; i < m_nbRays; ++i)
+        {
+            if(!pending[i]) continue;
+
+            if(m_fixtures[i] != fixtures[i])
+            {
+                pending[i] = false;
+                m_starts[i] = b2_maxFloat;
+                continue;
+            }
+
+            // Nothing in the window, the ray goes on from its end
+            m_starts[i] = m_fractions[i];
+            m_fractions[i] = ends[i];
+        }
+    }
+
+    std::fill(m_starts, m_starts + 4 * m_nbGroups, 0.0f);
+}
+
+void RayFan::lookUp(SensorTable const * table, float32 angle)
+{
+    assert(table && "SensorTable is null");
+
+    if(m_nbRays == 0) return;
+
+    float32 fractions[MAX_RAYS];
+    table->lookUp(m_origin, angle, fractions);
+
+    for(uint32_t i = 0; i < m_nbRays; ++i)
+    {
+        if(fractions[i] < m_fractions[i])
+        {
+            m_fractions[i] = fractions[i];
+            m_fixtures[i] = nullptr;
+        }
+    }
+}
+
+void RayFan::castHints(SensorTracker const & tracker, uint32_t & nbHinted, uint32_t & nbHits)
+{
+    nbHinted = 0;
+    nbHits = 0;
+
+    bool done[MAX_RAYS] = {};
+    for(uint32_t i = 0; i < m_nbRays; ++i)
+    {
+        b2Fixture * fixture = tracker.getFixture(i);
+        int32 const childIndex = tracker.getChildIndex(i);
+        if(!fixture || done[i]) continue;
+
+        // Every ray hinted with this primitive is cast at once
+        std::fill(m_nodeMasks, m_nodeMasks + m_nbGroups, 0);
+        for(uint32_t j = i; j < m_nbRays; ++j)
+        {
+            if(done[j] || tracker.getFixture(j) != fixture || tracker.getChildIndex(j) != childIndex) continue;
+
+            m_nodeMasks[j / 4] |= 1 << (j % 4);
+            done[j] = true;
+            ++nbHinted;
+        }
+
+        this->TraverseFixture(fixture, childIndex);
+    }
+
+    for(uint32_t i = 0; i < m_nbRays; ++i)
+    {
+        if(done[i] && m_fixtures[i] == tracker.getFixture(i)) ++nbHits;
+    }
+}
+
+b2Vec2 const & RayFan::getOrigin() const
+{
+    return m_origin;
+}
+
+uint32_t RayFan::size() const
+{
+    return m_nbRays;
+}
+
+float32 RayFan::getFraction(uint32_t i) const
+{
+    assert(i < m_nbRays);
+    return m_fractions[i];
+}
+
+b2Fixture * RayFan::getFixture(uint32_t i) const
+{
+    assert(i < m_nbRays);
+    return m_fixtures[i];
+}
+
+int32 RayFan::getChildIndex(uint32_t i) const
+{
+    assert(i < m_nbRays);
+    return m_childIndices[i];
+}
+
+b2Vec2 RayFan::getEnd(uint32_t i) const
+{
+    assert(i < m_nbRays);
+    return b2Vec2(m_endX[i], m_endY[i]);
+}
+
+bool RayFan::TraverseNode(b2AABB const & aabb)
+{
+    using namespace simd;
+
+    f32x4 const px = set1(m_origin.x);
+    f32x4 const py = set1(m_origin.y);
+    f32x4 const lowX = set1(aabb.lowerBound.x) - px;
+    f32x4 const lowY = set1(aabb.lowerBound.y) - py;
+    f32x4 const upX = set1(aabb.upperBound.x) - px;
+    f32x4 const upY = set1(aabb.upperBound.y) - py;
+
+    int32_t any = 0;
+    for(uint32_t g = 0; g < m_nbGroups; ++g)
+    {
+        uint32_t const o = 4 * g;
+        f32x4 invX = load(&m_invDirX[o]);
+        f32x4 invY = load(&m_invDirY[o]);
+        f32x4 start = load(&m_starts[o]);
+        f32x4 fraction = load(&m_fractions[o]);
+
+        // Slab test on the [start, fraction] part of every ray
+        f32x4 tx1 = lowX * invX;
+        f32x4 tx2 = upX * invX;
+        f32x4 ty1 = lowY * invY;
+        f32x4 ty2 = upY * invY;
+
+        f32x4 tmin = max(min(tx1, tx2), min(ty1, ty2));
+        f32x4 tmax = min(max(tx1, tx2), max(ty1, ty2));
+
+        f32x4 hit = (tmin <= tmax) & (start <= tmax) & (tmin <= fraction) & (start <= fraction);
+
+        m_nodeMasks[g] = bits(hit);
+        any |= m_nodeMasks[g];
+    }
+
+    return any != 0;
+}
+
+bool RayFan::TraverseProxy(int32 proxyId)
+{
+    assert(m_broadPhase && "Broad-phase is null");
+
+    b2FixtureProxy * proxy = static_cast<b2FixtureProxy *>(m_broadPhase->GetUserData(proxyId));
+
+    b2Body * body = proxy->fixture->GetBody();
+    if(m_skipped && body->GetType() == b2_staticBody
+    && std::binary_search(m_skipped->begin(), m_skipped->end(), body, std::less<b2Body *>()))
+    {
+        return true;
+    }
+
+    return this->TraverseFixture(proxy->fixture, proxy->childIndex);
+}
+
+bool RayFan::TraverseFixture(b2Fixture * fixture, int32 childIndex)
+{
+    // Skipping the owner before the exact test also drops the rays starting
+    // inside its own polygon
+    if(fixture->GetUserData() == m_owner)
+    {
+        return true;
+    }
+
+    if(fixture->GetType() == b2Shape::e_polygon)
+    {
+        b2PolygonShape const * shape = static_cast<b2PolygonShape const *>(fixture->GetShape());
+        this->castPolygon(fixture, shape, fixture->GetBody()->GetTransform());
+    }
+    else
+    {
+        this->castShape(fixture, childIndex);
+    }
+
+    return true;
+}
+
+void RayFan::castPolygon(b2Fixture * fixture, b2PolygonShape const * shape, b2Transform const & xf)
+{
+    using namespace simd;
+
+    // Same operations as b2PolygonShape::RayCast, one ray per lane, so that
+    // the fractions are bit identical to the ones of b2World::RayCast
+
+    // Put the rays into the polygon's frame of reference
+    b2Vec2 const p1 = b2MulT(xf.q, m_origin - xf.p);
+
+    f32x4 const zero = set1(0.0f);
+    f32x4 const c = set1(xf.q.c);
+    f32x4 const s = set1(xf.q.s);
+    f32x4 const ms = set1(-xf.q.s);
+    f32x4 const tx = set1(xf.p.x);
+    f32x4 const ty = set1(xf.p.y);
+    f32x4 const p1x = set1(p1.x);
+    f32x4 const p1y = set1(p1.y);
+
+    for(uint32_t g = 0; g < m_nbGroups; ++g)
+    {
+        if(m_nodeMasks[g] == 0) continue;
+
+        uint32_t const o = 4 * g;
+
+        f32x4 ex = load(&m_endX[o]) - tx;
+        f32x4 ey = load(&m_endY[o]) - ty;
+        f32x4 dx = (c * ex + s * ey) - p1x;
+        f32x4 dy = (ms * ex + c * ey) - p1y;
+
+        f32x4 lower = zero;
+        f32x4 upper = load(&m_fractions[o]);
+        f32x4 entered = zero < zero;
+        f32x4 failed = entered;
+
+        for(int32 i = 0; i < shape->m_count; ++i)
+        {
+            b2Vec2 const & n = shape->m_normals[i];
+
+            f32x4 numerator = set1(b2Dot(n, shape->m_vertices[i] - p1));
+            f32x4 denominator = set1(n.x) * dx + set1(n.y) * dy;
+
+            f32x4 parallel = denominator == zero;
+            failed = failed | (parallel & (numerator < zero));
+
+            f32x4 enter = (denominator < zero) & (numerator < lower * denominator);
+            f32x4 leave = andNot(enter, (zero < denominator) & (numerator < upper * denominator));
+
+            f32x4 t = numerator / denominator;
+            lower = select(enter, t, lower);
+            upper = select(leave, t, upper);
+            entered = entered | enter;
+
+            failed = failed | (upper < lower);
+        }
+
+        int32_t hits = bits(andNot(failed, entered)) & m_nodeMasks[g];
+        if(hits == 0) continue;
+
+        float32 fractions[4];
+        store(fractions, lower);
+        for(uint32_t k = 0; k < 4; ++k)
+        {
+            if(hits & (1 << k))
+            {
+                m_fractions[o + k] = fractions[k];
+                m_fixtures[o + k] = fixture;
+                m_childIndices[o + k] = 0;
+            }
+        }
+    }
+}
+
+void RayFan::castShape(b2Fixture * fixture, int32 childIndex)
+{
+    for(uint32_t g = 0; g < m_nbGroups; ++g)
+    {
+        for(uint32_t k = 0; k < 4; ++k)
+        {
+            if(!(m_nodeMasks[g] & (1 << k))) continue;
+
+            uint32_t const i = 4 * g + k;
+
+            b2RayCastInput input;
+            input.p1 = m_origin;
+            input.p2.Set(m_endX[i], m_endY[i]);
+            input.maxFraction = m_fractions[i];
+
+            b2RayCastOutput output;
+            if(fixture->RayCast(&output, input, childIndex))
+            {
+                m_fractions[i] = output.fraction;
+                m_fixtures[i] = fixture;
+                m_childIndices[i] = childIndex;
+            }
+        }
+    }
+}
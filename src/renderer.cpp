@@ -2,6 +2,7 @@
 
 #include <renderer.hpp>
 
+#include <carfleet.hpp>
 #include <drawable.hpp>
 
 #include <SFML/Window/Keyboard.hpp>
@@ -31,6 +32,15 @@ Renderer::~Renderer()
 }
 
 bool Renderer::update(std::vector<std::shared_ptr<Drawable> > const & actorList, bool draw)
+{
+    return this->update(actorList, std::vector<std::shared_ptr<CarFleet> >(), draw);
+}
+
+bool Renderer::update(
+    std::vector<std::shared_ptr<Drawable> > const & actorList,
+    std::vector<std::shared_ptr<CarFleet> > const & fleetList,
+    bool draw
+)
 {
     if(m_window.isOpen())
     {
@@ -84,6 +94,19 @@ bool Renderer::update(std::vector<std::shared_ptr<Drawable> > const & actorList,
                 }
             }
 
+            // Draw fleets
+            std::vector<sf::ConvexShape> shapes;
+            for(auto const & fleet: fleetList)
+            {
+                shapes.clear();
+                fleet->getShapes(m_scale, shapes);
+                for(auto & shape: shapes)
+                {
+                    shape.scale(m_scale, m_scale);
+                    m_window.draw(shape);
+                }
+            }
+
             m_window.display();
         }
 
@@ -0,0 +1,482 @@
+#include <sensortable.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <rayfan.hpp>
+#include <statictree.hpp>
+
+namespace
+{
+    // Samples start a page into the file, so that they are mapped aligned
+    std::size_t const HEADER_SIZE = 4096;
+
+    char const MAGIC[8] = {'C', 'P', 'S', 'E', 'N', 'S', 'O', 'R'};
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t bits;
+        uint64_t key;
+        uint64_t checksum;
+        uint32_t width;
+        uint32_t height;
+        uint32_t nbHeadings;
+        uint32_t nbRays;
+    };
+
+    static_assert(sizeof(FileHeader) <= HEADER_SIZE, "Header does not fit");
+
+    // FNV-1a
+    uint64_t hashBytes(uint64_t hash, void const * data, std::size_t size)
+    {
+        uint8_t const * bytes = static_cast<uint8_t const *>(data);
+        for(std::size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    uint64_t const HASH_SEED = 14695981039346656037ull;
+
+    uint64_t getKey(SensorTableDef const & def)
+    {
+        uint64_t key = HASH_SEED;
+        key = hashBytes(key, &def.area, sizeof(def.area));
+        key = hashBytes(key, &def.cellSize, sizeof(def.cellSize));
+        key = hashBytes(key, &def.nbHeadings, sizeof(def.nbHeadings));
+        key = hashBytes(key, &def.bits, sizeof(def.bits));
+        key = hashBytes(key, &def.seed, sizeof(def.seed));
+        key = hashBytes(key, &def.raycastDist, sizeof(def.raycastDist));
+        return hashBytes(key, def.raycastAngles.data(), def.raycastAngles.size() * sizeof(float32));
+    }
+
+    uint32_t getSampleCount(float32 extent, float32 cellSize)
+    {
+        return std::max(static_cast<uint32_t>(std::ceil(extent / cellSize)) + 1, 2u);
+    }
+
+    // Fills the ends of a car fan, as Car::doRaycast does
+    void setEnds(RayFan & fan, SensorTableDef const & def, float32 angle)
+    {
+        b2Vec2 const point1 = fan.getOrigin();
+        for(auto i = 0u; i < def.raycastAngles.size(); ++i)
+        {
+            float32 rayAngle = def.raycastAngles[i] + angle + M_PI/2.0;
+            b2Vec2 point2 = b2Vec2(std::cos(rayAngle), std::sin(rayAngle));
+            point2 *= def.raycastDist;
+            point2 += point1;
+            fan.setEnd(i, point2);
+        }
+    }
+
+    template <typename T>
+    void quantize(RayFan const & fan, T * samples)
+    {
+        float32 const scale = std::numeric_limits<T>::max();
+        for(uint32_t i = 0; i < fan.size(); ++i)
+        {
+            samples[i] = static_cast<T>(fan.getFraction(i) * scale + 0.5f);
+        }
+    }
+}
+
+uint32_t const SensorTable::VERSION;
+
+SensorTable::SensorTable()
+    : m_def()
+    , m_checksum(0)
+    , m_invCellSize(0.0f)
+    , m_headingsPerRadian(0.0f)
+    , m_width(0)
+    , m_height(0)
+    , m_nbRays(0)
+    , m_samples()
+    , m_data(nullptr)
+    , m_mapping(nullptr)
+    , m_mappingSize(0)
+{
+
+}
+
+SensorTable::~SensorTable()
+{
+    this->unmap();
+}
+
+void SensorTable::build(StaticTree const & tree, SensorTableDef const & def)
+{
+    assert(def.cellSize > 0.0f && "Cell size must be positive");
+    assert(def.nbHeadings > 0 && "No heading");
+    assert((def.bits == 8 || def.bits == 16) && "Distances are stored on 8 or 16 bits");
+    assert(def.raycastAngles.size() <= RayFan::MAX_RAYS && "Too many rays");
+
+    this->clear();
+
+    b2Vec2 const extents = def.area.upperBound - def.area.lowerBound;
+
+    m_def = def;
+    m_checksum = SensorTable::getChecksum(tree);
+    m_invCellSize = 1.0f / def.cellSize;
+    m_headingsPerRadian = def.nbHeadings / (2.0f * b2_pi);
+    m_width = getSampleCount(extents.x, def.cellSize);
+    m_height = getSampleCount(extents.y, def.cellSize);
+    m_nbRays = static_cast<uint32_t>(def.raycastAngles.size());
+
+    m_samples.resize(static_cast<std::size_t>(m_width) * m_height * def.nbHeadings * m_nbRays * (def.bits / 8));
+    m_data = m_samples.data();
+
+    uint8_t * samples = m_samples.data();
+    int32_t const height = static_cast<int32_t>(m_height);
+
+    #pragma omp parallel
+    {
+        RayFan fan;
+
+        #pragma omp for schedule(dynamic, 1)
+        for(int32_t y = 0; y < height; ++y)
+        {
+            for(uint32_t x = 0; x < m_width; ++x)
+            {
+                b2Vec2 const p = def.area.lowerBound + def.cellSize * b2Vec2(static_cast<float32>(x), static_cast<float32>(y));
+                for(uint32_t heading = 0; heading < def.nbHeadings; ++heading)
+                {
+                    fan.reset(p, m_nbRays, nullptr);
+                    setEnds(fan, def, heading / m_headingsPerRadian);
+                    fan.cast(&tree);
+
+                    std::size_t const offset = this->getOffset(x, y, heading);
+                    if(def.bits == 8)
+                    {
+                        quantize(fan, samples + offset);
+                    }
+                    else
+                    {
+                        quantize(fan, reinterpret_cast<uint16_t *>(samples) + offset);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool SensorTable::save(std::string const & path) const
+{
+    assert(!this->empty() && "Table is empty");
+
+    FileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.bits = m_def.bits;
+    header.key = getKey(m_def);
+    header.checksum = m_checksum;
+    header.width = m_width;
+    header.height = m_height;
+    header.nbHeadings = m_def.nbHeadings;
+    header.nbRays = m_nbRays;
+
+    std::vector<char> page(HEADER_SIZE, 0);
+    std::memcpy(page.data(), &header, sizeof(header));
+
+    // Written aside then renamed: a reader never maps half a table
+    std::string const temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(page.data(), page.size());
+        file.write(reinterpret_cast<char const *>(m_data), this->getMemorySize());
+        if(!file.good()) return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool SensorTable::load(std::string const & path, SensorTableDef const & def, uint64_t checksum)
+{
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat info;
+    bool const sized = ::fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) > HEADER_SIZE;
+    void * mapping = sized ? ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if(mapping == MAP_FAILED) return false;
+
+    std::size_t const size = info.st_size;
+    FileHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+
+    b2Vec2 const extents = def.area.upperBound - def.area.lowerBound;
+    uint32_t const width = getSampleCount(extents.x, def.cellSize);
+    uint32_t const height = getSampleCount(extents.y, def.cellSize);
+    std::size_t const expected = HEADER_SIZE + static_cast<std::size_t>(width) * height * def.nbHeadings * def.raycastAngles.size() * (def.bits / 8);
+
+    bool const valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+        && header.version == VERSION
+        && header.bits == def.bits
+        && header.key == getKey(def)
+        && header.checksum == checksum
+        && header.width == width
+        && header.height == height
+        && header.nbHeadings == def.nbHeadings
+        && header.nbRays == def.raycastAngles.size()
+        && size == expected;
+
+    if(!valid)
+    {
+        ::munmap(mapping, size);
+        return false;
+    }
+
+    this->clear();
+
+    m_def = def;
+    m_checksum = checksum;
+    m_invCellSize = 1.0f / def.cellSize;
+    m_headingsPerRadian = def.nbHeadings / (2.0f * b2_pi);
+    m_width = width;
+    m_height = height;
+    m_nbRays = header.nbRays;
+    m_mapping = mapping;
+    m_mappingSize = size;
+    m_data = static_cast<uint8_t const *>(mapping) + HEADER_SIZE;
+    return true;
+}
+
+bool SensorTable::open(std::string const & directory, StaticTree const & tree, SensorTableDef const & def)
+{
+    std::string const path = directory + "/" + SensorTable::getCacheName(def);
+    if(this->load(path, def, SensorTable::getChecksum(tree))) return true;
+
+    this->build(tree, def);
+    this->save(path);
+    return false;
+}
+
+void SensorTable::clear()
+{
+    this->unmap();
+
+    m_def = SensorTableDef();
+    m_checksum = 0;
+    m_invCellSize = 0.0f;
+    m_headingsPerRadian = 0.0f;
+    m_width = 0;
+    m_height = 0;
+    m_nbRays = 0;
+    m_samples.clear();
+    m_data = nullptr;
+}
+
+bool SensorTable::empty() const
+{
+    return m_data == nullptr;
+}
+
+bool SensorTable::isMapped() const
+{
+    return m_mapping != nullptr;
+}
+
+SensorTableDef const & SensorTable::getDef() const
+{
+    return m_def;
+}
+
+std::size_t SensorTable::getMemorySize() const
+{
+    return static_cast<std::size_t>(m_width) * m_height * m_def.nbHeadings * m_nbRays * (m_def.bits / 8);
+}
+
+std::string SensorTable::getCacheName(SensorTableDef const & def)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "sensors_%u_%016llx.bin", def.seed, static_cast<unsigned long long>(getKey(def)));
+    return name;
+}
+
+uint64_t SensorTable::getChecksum(StaticTree const & tree)
+{
+    uint64_t checksum = HASH_SEED;
+    for(uint32_t i = 0; i < tree.getPrimitiveCount(); ++i)
+    {
+        b2AABB const & bounds = tree.getPrimitiveBounds(static_cast<int32>(i));
+        checksum = hashBytes(checksum, &bounds, sizeof(bounds));
+    }
+    return checksum;
+}
+
+bool SensorTable::matches(float32 raycastDist, float32 const * angles, uint32_t nbRays) const
+{
+    // Bitwise: the table was cast for these exact rays
+    return !this->empty()
+        && nbRays == m_nbRays
+        && std::memcmp(&raycastDist, &m_def.raycastDist, sizeof(float32)) == 0
+        && std::memcmp(angles, m_def.raycastAngles.data(), nbRays * sizeof(float32)) == 0;
+}
+
+bool SensorTable::contains(b2Vec2 const & p) const
+{
+    b2Vec2 const lower = m_def.area.lowerBound;
+    return !this->empty()
+        && p.x >= lower.x && p.x <= lower.x + (m_width - 1) * m_def.cellSize
+        && p.y >= lower.y && p.y <= lower.y + (m_height - 1) * m_def.cellSize;
+}
+
+void SensorTable::lookUp(b2Vec2 const & p, float32 angle, float32 * fractions) const
+{
+    assert(this->contains(p) && "Pose out of the table");
+
+    if(m_def.bits == 8)
+    {
+        this->interpolate<uint8_t>(p, angle, fractions);
+    }
+    else
+    {
+        this->interpolate<uint16_t>(p, angle, fractions);
+    }
+}
+
+SensorTable::Errors SensorTable::measure(StaticTree const & tree, uint32_t nbPoses, uint32_t seed) const
+{
+    assert(!this->empty() && "Table is empty");
+
+    b2AABB const & area = m_def.area;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float32> xDistribution(area.lowerBound.x, area.upperBound.x);
+    std::uniform_real_distribution<float32> yDistribution(area.lowerBound.y, area.upperBound.y);
+    std::uniform_real_distribution<float32> angleDistribution(-b2_pi, b2_pi);
+
+    std::vector<b2Vec3> poses(nbPoses);
+    for(auto & pose: poses)
+    {
+        pose.x = xDistribution(rng);
+        pose.y = yDistribution(rng);
+        pose.z = angleDistribution(rng);
+    }
+
+    std::vector<float32> errors(static_cast<std::size_t>(nbPoses) * m_nbRays);
+    int32_t const count = static_cast<int32_t>(nbPoses);
+
+    #pragma omp parallel
+    {
+        RayFan fan;
+        float32 fractions[RayFan::MAX_RAYS];
+
+        #pragma omp for schedule(dynamic, 64)
+        for(int32_t i = 0; i < count; ++i)
+        {
+            b2Vec2 const p(poses[i].x, poses[i].y);
+            fan.reset(p, m_nbRays, nullptr);
+            setEnds(fan, m_def, poses[i].z);
+            fan.cast(&tree);
+
+            this->lookUp(p, poses[i].z, fractions);
+            for(uint32_t r = 0; r < m_nbRays; ++r)
+            {
+                errors[i * m_nbRays + r] = std::abs(fractions[r] - fan.getFraction(r)) * m_def.raycastDist;
+            }
+        }
+    }
+
+    Errors result;
+    result.nbRays = errors.size();
+    result.mean = 0.0f;
+    result.median = 0.0f;
+    result.p99 = 0.0f;
+    result.max = 0.0f;
+    result.overCell = 0.0f;
+    if(errors.empty()) return result;
+
+    double sum = 0.0;
+    uint64_t overCell = 0;
+    for(auto e: errors)
+    {
+        sum += e;
+        overCell += e > m_def.cellSize ? 1 : 0;
+    }
+
+    std::sort(errors.begin(), errors.end());
+    result.mean = static_cast<float32>(sum / errors.size());
+    result.median = errors[errors.size() / 2];
+    result.p99 = errors[errors.size() * 99 / 100];
+    result.max = errors.back();
+    result.overCell = static_cast<float32>(overCell) / errors.size();
+    return result;
+}
+
+std::size_t SensorTable::getOffset(uint32_t x, uint32_t y, uint32_t heading) const
+{
+    return ((static_cast<std::size_t>(y) * m_width + x) * m_def.nbHeadings + heading) * m_nbRays;
+}
+
+template <typename T>
+void SensorTable::interpolate(b2Vec2 const & p, float32 angle, float32 * fractions) const
+{
+    float32 const x = (p.x - m_def.area.lowerBound.x) * m_invCellSize;
+    float32 const y = (p.y - m_def.area.lowerBound.y) * m_invCellSize;
+    uint32_t const x0 = std::min(static_cast<uint32_t>(x), m_width - 2);
+    uint32_t const y0 = std::min(static_cast<uint32_t>(y), m_height - 2);
+    float32 const fx = x - x0;
+    float32 const fy = y - y0;
+
+    // Headings wrap around
+    uint32_t const nbHeadings = m_def.nbHeadings;
+    float32 h = angle * m_headingsPerRadian;
+    h -= std::floor(h / nbHeadings) * nbHeadings;
+    uint32_t const h0 = std::min(static_cast<uint32_t>(h), nbHeadings - 1);
+    uint32_t const h1 = h0 + 1 == nbHeadings ? 0 : h0 + 1;
+    float32 const fh = h - h0;
+
+    T const * samples = reinterpret_cast<T const *>(m_data);
+    T const * corners[8] = {
+        samples + this->getOffset(x0, y0, h0),
+        samples + this->getOffset(x0 + 1, y0, h0),
+        samples + this->getOffset(x0, y0 + 1, h0),
+        samples + this->getOffset(x0 + 1, y0 + 1, h0),
+        samples + this->getOffset(x0, y0, h1),
+        samples + this->getOffset(x0 + 1, y0, h1),
+        samples + this->getOffset(x0, y0 + 1, h1),
+        samples + this->getOffset(x0 + 1, y0 + 1, h1)
+    };
+
+    float32 const scale = 1.0f / std::numeric_limits<T>::max();
+    float32 weights[8];
+    for(uint32_t k = 0; k < 8; ++k)
+    {
+        weights[k] = ((k & 1) ? fx : 1.0f - fx) * ((k & 2) ? fy : 1.0f - fy) * ((k & 4) ? fh : 1.0f - fh) * scale;
+    }
+
+    for(uint32_t r = 0; r < m_nbRays; ++r)
+    {
+        float32 fraction = 0.0f;
+        for(uint32_t k = 0; k < 8; ++k)
+        {
+            fraction += weights[k] * corners[k][r];
+        }
+        fractions[r] = std::min(fraction, 1.0f);
+    }
+}
+
+void SensorTable::unmap()
+{
+    if(m_mapping)
+    {
+        ::munmap(m_mapping, m_mappingSize);
+        m_mapping = nullptr;
+        m_mappingSize = 0;
+    }
+}
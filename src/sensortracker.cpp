@@ -0,0 +1,71 @@
+#include <sensortracker.hpp>
+
+#include <cassert>
+
+#include <statictree.hpp>
+
+SensorTracker::SensorTracker()
+    : m_tree(nullptr)
+    , m_version(0)
+    , m_nbRays(0)
+    , m_fixtures()
+    , m_childIndices()
+    , m_counters()
+{
+
+}
+
+SensorTracker::~SensorTracker()
+{
+
+}
+
+void SensorTracker::reset()
+{
+    m_tree = nullptr;
+    m_version = 0;
+    m_nbRays = 0;
+}
+
+bool SensorTracker::isValid(StaticTree const * tree, uint32_t nbRays) const
+{
+    return m_tree && m_tree == tree && m_version == tree->getVersion() && m_nbRays == nbRays;
+}
+
+b2Fixture * SensorTracker::getFixture(uint32_t i) const
+{
+    assert(i < m_nbRays);
+    return m_fixtures[i];
+}
+
+int32 SensorTracker::getChildIndex(uint32_t i) const
+{
+    assert(i < m_nbRays);
+    return m_childIndices[i];
+}
+
+void SensorTracker::record(RayFan const & fan, StaticTree const * tree)
+{
+    assert(tree && "StaticTree is null");
+
+    for(uint32_t i = 0; i < fan.size(); ++i)
+    {
+        m_fixtures[i] = fan.getFixture(i);
+        m_childIndices[i] = fan.getChildIndex(i);
+    }
+
+    m_tree = tree;
+    m_version = tree->getVersion();
+    m_nbRays = fan.size();
+}
+
+void SensorTracker::count(uint32_t nbHinted, uint32_t nbHits)
+{
+    m_counters.nbHinted += nbHinted;
+    m_counters.nbHits += nbHits;
+}
+
+SensorTracker::Counters const & SensorTracker::getCounters() const
+{
+    return m_counters;
+}
@@ -0,0 +1,107 @@
+#include <simulationbatch.hpp>
+
+#include <cassert>
+#include <memory>
+
+#include <omp.h>
+
+#include <world.hpp>
+
+SimulationBatch::SimulationBatch(TrackDef const & track, uint32_t maxSteps)
+    : m_track(track)
+    , m_maxSteps(maxSteps)
+    , m_nbThreads(0)
+    , m_defs()
+    , m_controllers()
+{
+
+}
+
+SimulationBatch::~SimulationBatch()
+{
+
+}
+
+void SimulationBatch::add(CarDef const & def, Controller const * controller)
+{
+    m_defs.push_back(def);
+    m_controllers.push_back(controller);
+}
+
+void SimulationBatch::clear()
+{
+    m_defs.clear();
+    m_controllers.clear();
+}
+
+uint32_t SimulationBatch::size() const
+{
+    return static_cast<uint32_t>(m_defs.size());
+}
+
+void SimulationBatch::setThreadCount(uint32_t nbThreads)
+{
+    m_nbThreads = nbThreads;
+}
+
+std::vector<FitnessRecord> SimulationBatch::run() const
+{
+    std::vector<FitnessRecord> records(m_defs.size());
+
+    int32_t nbCars = static_cast<int32_t>(m_defs.size());
+    int32_t nbThreads = m_nbThreads > 0 ? static_cast<int32_t>(m_nbThreads) : omp_get_max_threads();
+
+    // Worlds do not share anything: one car per world, dynamic scheduling
+    // because cars die at very different times
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(nbThreads)
+    for(int32_t i = 0; i < nbCars; ++i)
+    {
+        records[i] = this->evaluate(static_cast<uint32_t>(i));
+    }
+
+    return records;
+}
+
+FitnessRecord SimulationBatch::evaluate(uint32_t index) const
+{
+    assert(index < m_defs.size());
+
+    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+    World w(8, 3, nullptr);
+    #else
+    World w(8, 3);
+    #endif
+
+    if(m_track.borders)
+    {
+        w.addBorders(m_track.width, m_track.height);
+    }
+    w.randomize(m_track.width, m_track.height, m_track.nbObstacles, m_track.seed);
+
+    std::shared_ptr<Car> car = w.create<Car>(m_defs[index], m_controllers[index]);
+    w.addRequiredDrawable(car);
+
+    FitnessRecord record;
+    record.index = index;
+
+    b2Vec2 lastPos = car->getInitPos();
+    while(record.steps < m_maxSteps && w.isRunning())
+    {
+        w.step();
+
+        // Position is refreshed by Car::act, even on the step it dies
+        b2Vec2 pos = car->getPos();
+        record.distance += (pos - lastPos).Length();
+        lastPos = pos;
+
+        ++record.steps;
+    }
+
+    // A sleeping car stops the episode early but is still alive
+    record.alive = w.isRunning() || car->isSleeping();
+    record.idle = car->isIdle();
+    record.finalPos = car->getPos();
+    record.displacement = (record.finalPos - car->getInitPos()).Length();
+
+    return record;
+}
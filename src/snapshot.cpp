@@ -0,0 +1,156 @@
+#include <snapshot.hpp>
+
+#include <algorithm>
+#include <functional>
+
+Snapshot::Snapshot()
+    : m_world(nullptr)
+    , m_nbDrawables(0)
+    , m_buffer()
+    , m_contacts()
+    , m_found()
+{
+
+}
+
+Snapshot::~Snapshot()
+{
+
+}
+
+void Snapshot::clear()
+{
+    m_world = nullptr;
+    m_nbDrawables = 0;
+    m_buffer.clear();
+    m_contacts.clear();
+}
+
+std::size_t Snapshot::getSize() const
+{
+    return m_buffer.size() + m_contacts.size() * sizeof(ContactRecord);
+}
+
+void Snapshot::writeBody(b2Body const * body)
+{
+    assert(body && "b2Body is null");
+
+    b2BodyState state;
+    body->GetState(&state);
+    this->write(state);
+
+    // Joint list order does not change as long as no joint is created or
+    // destroyed: joints are matched by their rank
+    for(b2JointEdge const * je = body->GetJointList(); je; je = je->next)
+    {
+        b2Joint * joint = je->joint;
+        if(joint->GetBodyA() != body || joint->GetType() != e_revoluteJoint) continue;
+
+        b2RevoluteJointState jointState;
+        static_cast<b2RevoluteJoint const *>(joint)->GetState(&jointState);
+        this->write(jointState);
+    }
+}
+
+void Snapshot::readBody(std::size_t & offset, b2Body * body) const
+{
+    assert(body && "b2Body is null");
+
+    b2BodyState state;
+    this->read(offset, state);
+    body->SetState(state);
+
+    for(b2JointEdge * je = body->GetJointList(); je; je = je->next)
+    {
+        b2Joint * joint = je->joint;
+        if(joint->GetBodyA() != body || joint->GetType() != e_revoluteJoint) continue;
+
+        b2RevoluteJointState jointState;
+        this->read(offset, jointState);
+        static_cast<b2RevoluteJoint *>(joint)->SetState(jointState);
+    }
+}
+
+bool Snapshot::lessThan(ContactRecord const & a, ContactRecord const & b)
+{
+    std::less<b2Fixture *> less;
+
+    if(a.fixtureA != b.fixtureA) return less(a.fixtureA, b.fixtureA);
+    if(a.fixtureB != b.fixtureB) return less(a.fixtureB, b.fixtureB);
+    if(a.indexA != b.indexA)     return a.indexA < b.indexA;
+    return a.indexB < b.indexB;
+}
+
+void Snapshot::writeContacts(b2World * w)
+{
+    assert(w && "b2World is null");
+
+    for(b2Contact * c = w->GetContactList(); c; c = c->GetNext())
+    {
+        ContactRecord record;
+        record.fixtureA = c->GetFixtureA();
+        record.fixtureB = c->GetFixtureB();
+        record.indexA = c->GetChildIndexA();
+        record.indexB = c->GetChildIndexB();
+        record.manifold = *c->GetManifold();
+        record.touching = c->IsTouching();
+        m_contacts.push_back(record);
+    }
+
+    std::sort(m_contacts.begin(), m_contacts.end(), Snapshot::lessThan);
+}
+
+void Snapshot::readContacts(b2World * w) const
+{
+    assert(w && "b2World is null");
+
+    b2ContactManager & manager = w->GetContactManager();
+
+    m_found.assign(m_contacts.size(), 0);
+    if(this->matchContacts(w) == m_contacts.size()) return;
+
+    // Contacts destroyed since the snapshot: touching the proxies of one of
+    // their fixtures makes the broad-phase find the pair again
+    for(std::size_t i = 0; i < m_contacts.size(); ++i)
+    {
+        if(!m_found[i]) m_contacts[i].fixtureA->Refilter();
+    }
+    manager.FindNewContacts();
+
+    this->matchContacts(w);
+}
+
+std::size_t Snapshot::matchContacts(b2World * w) const
+{
+    b2ContactManager & manager = w->GetContactManager();
+    std::size_t nbFound = 0;
+
+    b2Contact * c = w->GetContactList();
+    while(c)
+    {
+        b2Contact * next = c->GetNext();
+
+        ContactRecord key;
+        key.fixtureA = c->GetFixtureA();
+        key.fixtureB = c->GetFixtureB();
+        key.indexA = c->GetChildIndexA();
+        key.indexB = c->GetChildIndexB();
+
+        auto it = std::lower_bound(m_contacts.begin(), m_contacts.end(), key, Snapshot::lessThan);
+        if(it != m_contacts.end() && !Snapshot::lessThan(key, *it))
+        {
+            *c->GetManifold() = it->manifold;
+            c->SetTouching(it->touching);
+            m_found[it - m_contacts.begin()] = 1;
+            ++nbFound;
+        }
+        else
+        {
+            manager.Destroy(c);
+        }
+
+        c = next;
+    }
+
+    return nbFound;
+}
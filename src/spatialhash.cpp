@@ -0,0 +1,73 @@
+#include <spatialhash.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+SpatialHash::SpatialHash(float32 cellSize, uint32_t nbBuckets)
+    : m_invCellSize(1.0f / cellSize)
+    , m_mask(0)
+    , m_heads()
+    , m_entries()
+    , m_stamps()
+    , m_queryId(0)
+{
+    assert(cellSize > 0.0f && "Cell size must be positive");
+
+    uint32_t size = 1;
+    while(size < nbBuckets) size <<= 1;
+
+    m_mask = size - 1;
+    m_heads.assign(size, -1);
+}
+
+SpatialHash::~SpatialHash()
+{
+
+}
+
+void SpatialHash::insert(uint32_t item, b2AABB const & aabb)
+{
+    if(item >= m_stamps.size())
+    {
+        m_stamps.resize(item + 1, 0);
+    }
+
+    int32 const x0 = this->getCell(aabb.lowerBound.x);
+    int32 const x1 = this->getCell(aabb.upperBound.x);
+    int32 const y0 = this->getCell(aabb.lowerBound.y);
+    int32 const y1 = this->getCell(aabb.upperBound.y);
+
+    for(int32 y = y0; y <= y1; ++y)
+    {
+        for(int32 x = x0; x <= x1; ++x)
+        {
+            uint32_t const bucket = this->getBucket(x, y);
+
+            Entry entry;
+            entry.item = item;
+            entry.next = m_heads[bucket];
+            m_heads[bucket] = static_cast<int32>(m_entries.size());
+            m_entries.push_back(entry);
+        }
+    }
+}
+
+void SpatialHash::clear()
+{
+    std::fill(m_heads.begin(), m_heads.end(), -1);
+    m_entries.clear();
+    m_stamps.clear();
+    m_queryId = 0;
+}
+
+int32 SpatialHash::getCell(float32 v) const
+{
+    return static_cast<int32>(std::floor(v * m_invCellSize));
+}
+
+uint32_t SpatialHash::getBucket(int32 x, int32 y) const
+{
+    uint32_t const h = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u;
+    return h & m_mask;
+}
@@ -0,0 +1,294 @@
+#include <statictree.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+
+namespace
+{
+    // Relative costs of a node visit and of a primitive test
+    float32 const TRAVERSAL_COST = 1.0f;
+    float32 const INTERSECTION_COST = 1.0f;
+
+    b2Vec2 centroid(b2AABB const & aabb)
+    {
+        return 0.5f * (aabb.lowerBound + aabb.upperBound);
+    }
+
+    float32 axisValue(b2Vec2 const & v, uint32_t axis)
+    {
+        return axis == 0 ? v.x : v.y;
+    }
+}
+
+uint32_t const StaticTree::CACHE_LINE;
+uint32_t const StaticTree::MAX_LEAF_SIZE;
+
+StaticTree::StaticTree()
+    : m_primitives()
+    , m_primitiveBounds()
+    , m_order()
+    , m_storage()
+    , m_nodes(nullptr)
+    , m_nbNodes(0)
+    , m_version(0)
+{
+    static_assert(sizeof(Node) == CACHE_LINE, "A node must fill a cache line");
+}
+
+StaticTree::~StaticTree()
+{
+
+}
+
+void StaticTree::build(std::vector<b2Fixture *> const & fixtures)
+{
+    this->clear();
+
+    for(auto f: fixtures)
+    {
+        assert(f && "Fixture is null");
+
+        b2Transform const & xf = f->GetBody()->GetTransform();
+        for(int32 c = 0; c < f->GetShape()->GetChildCount(); ++c)
+        {
+            Primitive p;
+            p.fixture = f;
+            p.childIndex = c;
+            m_primitives.push_back(p);
+
+            b2AABB aabb;
+            f->GetShape()->ComputeAABB(&aabb, xf, c);
+            m_primitiveBounds.push_back(aabb);
+        }
+    }
+
+    if(m_primitives.empty()) return;
+
+    uint32_t const nbPrimitives = static_cast<uint32_t>(m_primitives.size());
+
+    m_order.resize(nbPrimitives);
+    for(uint32_t i = 0; i < nbPrimitives; ++i)
+    {
+        m_order[i] = static_cast<int32>(i);
+    }
+
+    // At most 2n - 1 nodes, the storage is never reallocated while building
+    uint32_t const maxNodes = 2 * nbPrimitives - 1;
+    m_storage.resize(maxNodes * sizeof(Node) + CACHE_LINE);
+
+    void * memory = m_storage.data();
+    std::size_t space = m_storage.size();
+    m_nodes = static_cast<Node *>(std::align(CACHE_LINE, maxNodes * sizeof(Node), memory, space));
+    assert(m_nodes && "Failed to align the nodes");
+
+    this->buildNode(0, nbPrimitives, m_primitiveBounds);
+
+    std::vector<int32>().swap(m_order);
+}
+
+void StaticTree::buildNode(uint32_t begin, uint32_t end, std::vector<b2AABB> const & bounds)
+{
+    uint32_t const index = m_nbNodes++;
+    Node & node = m_nodes[index];
+    uint32_t const count = end - begin;
+
+    node.aabb = bounds[m_order[begin]];
+    for(uint32_t i = begin + 1; i < end; ++i)
+    {
+        node.aabb.Combine(bounds[m_order[i]]);
+    }
+    node.count = 0;
+
+    // Best split along x then y, primitives sorted by their centroid
+    float32 const leafCost = INTERSECTION_COST * count;
+    float32 bestCost = b2_maxFloat;
+    uint32_t bestAxis = 0;
+    uint32_t bestSplit = 0;
+
+    if(count > 1)
+    {
+        float32 const invPerimeter = 1.0f / std::max(node.aabb.GetPerimeter(), b2_epsilon);
+        std::vector<float32> leftPerimeters(count);
+
+        for(uint32_t axis = 0; axis < 2; ++axis)
+        {
+            std::sort(m_order.begin() + begin, m_order.begin() + end, [&](int32 a, int32 b)
+            {
+                return axisValue(centroid(bounds[a]), axis) < axisValue(centroid(bounds[b]), axis);
+            });
+
+            b2AABB left = bounds[m_order[begin]];
+            for(uint32_t i = 1; i < count; ++i)
+            {
+                leftPerimeters[i] = left.GetPerimeter();
+                left.Combine(bounds[m_order[begin + i]]);
+            }
+
+            // Split i: [0, i) on the left, [i, count) on the right
+            b2AABB right = bounds[m_order[end - 1]];
+            for(uint32_t i = count - 1; i > 0; --i)
+            {
+                float32 cost = TRAVERSAL_COST + INTERSECTION_COST * invPerimeter * (
+                    leftPerimeters[i] * i + right.GetPerimeter() * (count - i)
+                );
+
+                if(cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+
+                right.Combine(bounds[m_order[begin + i - 1]]);
+            }
+        }
+    }
+
+    if(count == 1 || (count <= MAX_LEAF_SIZE && leafCost <= bestCost))
+    {
+        node.count = static_cast<int32>(count);
+        for(uint32_t i = 0; i < count; ++i)
+        {
+            node.primitives[i] = m_order[begin + i];
+        }
+        node.escape = static_cast<int32>(m_nbNodes);
+        return;
+    }
+
+    // Primitives are still sorted along y, the last axis tried
+    if(bestAxis == 0)
+    {
+        std::sort(m_order.begin() + begin, m_order.begin() + end, [&](int32 a, int32 b)
+        {
+            return centroid(bounds[a]).x < centroid(bounds[b]).x;
+        });
+    }
+
+    this->buildNode(begin, begin + bestSplit, bounds);
+    this->buildNode(begin + bestSplit, end, bounds);
+
+    node.escape = static_cast<int32>(m_nbNodes);
+}
+
+void StaticTree::clear()
+{
+    m_primitives.clear();
+    m_primitiveBounds.clear();
+    m_order.clear();
+    m_storage.clear();
+    m_nodes = nullptr;
+    m_nbNodes = 0;
+    ++m_version;
+}
+
+bool StaticTree::empty() const
+{
+    return m_nbNodes == 0;
+}
+
+uint32_t StaticTree::getNodeCount() const
+{
+    return m_nbNodes;
+}
+
+uint32_t StaticTree::getPrimitiveCount() const
+{
+    return static_cast<uint32_t>(m_primitives.size());
+}
+
+int32 StaticTree::getHeight() const
+{
+    // Depth first order: a node is one level below the closest node before
+    // it whose subtree contains it
+    std::vector<int32> depths(m_nbNodes, 0);
+    std::vector<uint32_t> parents;
+    int32 height = 0;
+
+    for(uint32_t i = 0; i < m_nbNodes; ++i)
+    {
+        while(!parents.empty() && static_cast<uint32_t>(m_nodes[parents.back()].escape) <= i)
+        {
+            parents.pop_back();
+        }
+
+        depths[i] = parents.empty() ? 0 : depths[parents.back()] + 1;
+        height = std::max(height, depths[i]);
+
+        if(m_nodes[i].count == 0) parents.push_back(i);
+    }
+
+    return height;
+}
+
+uint32_t StaticTree::getVersion() const
+{
+    return m_version;
+}
+
+StaticTree::Primitive const & StaticTree::getPrimitive(int32 i) const
+{
+    assert(i >= 0 && static_cast<uint32_t>(i) < m_primitives.size());
+    return m_primitives[i];
+}
+
+b2AABB const & StaticTree::getPrimitiveBounds(int32 i) const
+{
+    assert(i >= 0 && static_cast<uint32_t>(i) < m_primitiveBounds.size());
+    return m_primitiveBounds[i];
+}
+
+void StaticTree::rayCast(b2RayCastCallback * callback, b2RayCastInput const & input) const
+{
+    assert(callback && "Callback is null");
+
+    b2Vec2 const p1 = input.p1;
+    b2Vec2 const p2 = input.p2;
+    float32 maxFraction = input.maxFraction;
+
+    // Bounding box of the remaining part of the segment
+    b2AABB segment;
+    b2Vec2 t = p1 + maxFraction * (p2 - p1);
+    segment.lowerBound = b2Min(p1, t);
+    segment.upperBound = b2Max(p1, t);
+
+    uint32_t i = 0;
+    while(i < m_nbNodes)
+    {
+        Node const & node = m_nodes[i];
+
+        if(!b2TestOverlap(node.aabb, segment))
+        {
+            i = static_cast<uint32_t>(node.escape);
+            continue;
+        }
+
+        for(int32 k = 0; k < node.count; ++k)
+        {
+            Primitive const & p = m_primitives[node.primitives[k]];
+
+            b2RayCastInput subInput;
+            subInput.p1 = p1;
+            subInput.p2 = p2;
+            subInput.maxFraction = maxFraction;
+
+            b2RayCastOutput output;
+            if(!p.fixture->RayCast(&output, subInput, p.childIndex)) continue;
+
+            float32 fraction = output.fraction;
+            b2Vec2 point = (1.0f - fraction) * p1 + fraction * p2;
+            float32 value = callback->ReportFixture(p.fixture, point, output.normal, fraction);
+
+            // -1: ignored, 0: terminated, otherwise the new clip
+            if(value < 0.0f) continue;
+            if(!(value > 0.0f)) return;
+
+            maxFraction = value;
+            t = p1 + maxFraction * (p2 - p1);
+            segment.lowerBound = b2Min(p1, t);
+            segment.upperBound = b2Max(p1, t);
+        }
+
+        ++i;
+    }
+}
@@ -0,0 +1,285 @@
+#include <stats.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+    uint64_t msToNs(float32 ms)
+    {
+        return ms > 0.0f ? static_cast<uint64_t>(ms * 1.0e6f) : 0;
+    }
+}
+
+uint32_t const Histogram::NB_BUCKETS;
+
+Histogram::Histogram()
+    : m_count(0)
+    , m_total(0)
+    , m_min(0)
+    , m_max(0)
+    , m_buckets()
+{
+
+}
+
+void Histogram::add(uint64_t ns)
+{
+    uint32_t bucket = 0;
+    while(bucket + 1 < NB_BUCKETS && (ns >> bucket) != 0) ++bucket;
+
+    ++m_buckets[bucket];
+    m_min = m_count == 0 ? ns : std::min(m_min, ns);
+    m_max = std::max(m_max, ns);
+    m_total += ns;
+    ++m_count;
+}
+
+void Histogram::clear()
+{
+    m_count = 0;
+    m_total = 0;
+    m_min = 0;
+    m_max = 0;
+    std::fill(m_buckets, m_buckets + NB_BUCKETS, 0);
+}
+
+uint64_t Histogram::getCount() const
+{
+    return m_count;
+}
+
+uint64_t Histogram::getTotal() const
+{
+    return m_total;
+}
+
+uint64_t Histogram::getMin() const
+{
+    return m_min;
+}
+
+uint64_t Histogram::getMax() const
+{
+    return m_max;
+}
+
+double Histogram::getMean() const
+{
+    return m_count ? static_cast<double>(m_total) / m_count : 0.0;
+}
+
+uint64_t Histogram::getPercentile(double p) const
+{
+    if(m_count == 0) return 0;
+
+    uint64_t rank = static_cast<uint64_t>(p * (m_count - 1)) + 1;
+    uint64_t seen = 0;
+    for(uint32_t i = 0; i < NB_BUCKETS; ++i)
+    {
+        seen += m_buckets[i];
+        if(seen >= rank)
+        {
+            // Never above the largest sample
+            uint64_t upper = i == 0 ? 0 : (uint64_t(1) << i) - 1;
+            return std::min(upper, m_max);
+        }
+    }
+
+    return m_max;
+}
+
+uint64_t Histogram::getBucket(uint32_t i) const
+{
+    assert(i < NB_BUCKETS);
+    return m_buckets[i];
+}
+
+Stats::Stats()
+    : m_histograms()
+    , m_calls()
+    , m_stepTimes()
+    , m_stepCalls()
+    , m_counters()
+{
+    this->clear();
+}
+
+Stats::~Stats()
+{
+
+}
+
+char const * Stats::getPhaseName(Phase phase)
+{
+    switch(phase)
+    {
+        case STEP:              return "step";
+        case SENSE:             return "sense";
+        case RAYCAST:           return "raycast";
+        case CONTROLLER:        return "controller";
+        case ACT:               return "act";
+        case FRICTION:          return "friction";
+        case REMOVE_DRAWABLES:  return "remove_drawables";
+        case PHYSICS:           return "physics";
+        case B2_COLLIDE:        return "b2_collide";
+        case B2_SOLVE:          return "b2_solve";
+        case B2_SOLVE_TOI:      return "b2_solve_toi";
+        case B2_BROADPHASE:     return "b2_broadphase";
+        default:                return "unknown";
+    }
+}
+
+char const * Stats::getCounterName(Counter counter)
+{
+    switch(counter)
+    {
+        case STEPS:             return "steps";
+        case RAYCASTS:          return "raycasts";
+        case RAYS:              return "rays";
+        case CONTROLLER_CALLS:  return "controller_calls";
+        case REMOVED_DRAWABLES: return "removed_drawables";
+        case KILLED_FLEET_CARS: return "killed_fleet_cars";
+        case IDLE_CARS:         return "idle_cars";
+        case HINTED_RAYS:       return "hinted_rays";
+        case HINT_HITS:         return "hint_hits";
+        default:                return "unknown";
+    }
+}
+
+void Stats::endStep(b2Profile const & profile)
+{
+    this->addTime(B2_COLLIDE, msToNs(profile.collide));
+    this->addTime(B2_SOLVE, msToNs(profile.solve));
+    this->addTime(B2_SOLVE_TOI, msToNs(profile.solveTOI));
+    this->addTime(B2_BROADPHASE, msToNs(profile.broadphase));
+
+    for(uint32_t i = 0; i < NB_PHASES; ++i)
+    {
+        uint64_t calls = m_stepCalls[i].exchange(0, std::memory_order_relaxed);
+        uint64_t ns = m_stepTimes[i].exchange(0, std::memory_order_relaxed);
+        if(calls == 0) continue;
+
+        m_histograms[i].add(ns);
+        m_calls[i] += calls;
+    }
+
+    this->count(STEPS);
+}
+
+void Stats::clear()
+{
+    for(uint32_t i = 0; i < NB_PHASES; ++i)
+    {
+        m_histograms[i].clear();
+        m_calls[i] = 0;
+        m_stepTimes[i].store(0, std::memory_order_relaxed);
+        m_stepCalls[i].store(0, std::memory_order_relaxed);
+    }
+
+    for(uint32_t i = 0; i < NB_COUNTERS; ++i)
+    {
+        m_counters[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+Histogram const & Stats::getHistogram(Phase phase) const
+{
+    assert(phase < NB_PHASES);
+    return m_histograms[phase];
+}
+
+uint64_t Stats::getCalls(Phase phase) const
+{
+    assert(phase < NB_PHASES);
+    return m_calls[phase];
+}
+
+uint64_t Stats::getCount(Counter counter) const
+{
+    assert(counter < NB_COUNTERS);
+    return m_counters[counter].load(std::memory_order_relaxed);
+}
+
+void Stats::dumpJson(std::ostream & out) const
+{
+    out << "{\n";
+    out << "  \"enabled\": " << (CAR_PHYSICS_STATS ? "true" : "false") << ",\n";
+    out << "  \"phases\": {\n";
+
+    for(uint32_t i = 0; i < NB_PHASES; ++i)
+    {
+        Phase phase = static_cast<Phase>(i);
+        Histogram const & h = m_histograms[i];
+
+        out << "    \"" << Stats::getPhaseName(phase) << "\": {";
+        out << "\"steps\": " << h.getCount();
+        out << ", \"calls\": " << m_calls[i];
+        out << ", \"total_ns\": " << h.getTotal();
+        out << ", \"mean_ns\": " << h.getMean();
+        out << ", \"min_ns\": " << h.getMin();
+        out << ", \"max_ns\": " << h.getMax();
+        out << ", \"p50_ns\": " << h.getPercentile(0.5);
+        out << ", \"p90_ns\": " << h.getPercentile(0.9);
+        out << ", \"p99_ns\": " << h.getPercentile(0.99);
+
+        // Buckets up to the last non empty one
+        uint32_t last = 0;
+        for(uint32_t b = 0; b < Histogram::NB_BUCKETS; ++b)
+        {
+            if(h.getBucket(b)) last = b + 1;
+        }
+
+        out << ", \"buckets\": [";
+        for(uint32_t b = 0; b < last; ++b)
+        {
+            out << (b ? ", " : "") << h.getBucket(b);
+        }
+        out << "]}" << (i + 1 < NB_PHASES ? "," : "") << "\n";
+    }
+
+    out << "  },\n";
+    out << "  \"counters\": {\n";
+
+    for(uint32_t i = 0; i < NB_COUNTERS; ++i)
+    {
+        Counter counter = static_cast<Counter>(i);
+        out << "    \"" << Stats::getCounterName(counter) << "\": " << this->getCount(counter);
+        out << (i + 1 < NB_COUNTERS ? "," : "") << "\n";
+    }
+
+    out << "  }\n";
+    out << "}\n";
+}
+
+void Stats::dumpCsv(std::ostream & out) const
+{
+    out << "kind,name,steps,calls,total_ns,mean_ns,min_ns,max_ns,p50_ns,p90_ns,p99_ns\n";
+
+    for(uint32_t i = 0; i < NB_PHASES; ++i)
+    {
+        Phase phase = static_cast<Phase>(i);
+        Histogram const & h = m_histograms[i];
+
+        out << "phase," << Stats::getPhaseName(phase)
+            << "," << h.getCount()
+            << "," << m_calls[i]
+            << "," << h.getTotal()
+            << "," << h.getMean()
+            << "," << h.getMin()
+            << "," << h.getMax()
+            << "," << h.getPercentile(0.5)
+            << "," << h.getPercentile(0.9)
+            << "," << h.getPercentile(0.99)
+            << "\n";
+    }
+
+    // Counters only fill the calls column
+    for(uint32_t i = 0; i < NB_COUNTERS; ++i)
+    {
+        Counter counter = static_cast<Counter>(i);
+        out << "counter," << Stats::getCounterName(counter) << ",," << this->getCount(counter)
+            << ",,,,,,,\n";
+    }
+}
@@ -0,0 +1,212 @@
+#include <threadallocator.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <Box2D/Box2D.h>
+
+namespace
+{
+    // Classes of 64 bytes to MAX_CACHED_SIZE
+    uint32_t const MIN_CLASS_SHIFT = 6;
+    uint32_t const NB_CLASSES = 12;
+    uint32_t const NO_CLASS = NB_CLASSES;
+
+    // Keeps the alignment of malloc
+    std::size_t const HEADER_SIZE = 16;
+
+    struct Header
+    {
+        uint32_t sizeClass;
+    };
+
+    struct FreeBlock
+    {
+        FreeBlock * next;
+    };
+
+    std::atomic<std::size_t> g_cacheLimit(ThreadAllocator::DEFAULT_CACHE_LIMIT);
+    std::atomic<bool> g_firstTouch(false);
+
+    class ThreadCache
+    {
+    public:
+        ThreadCache();
+        ~ThreadCache();
+
+        void release();
+
+        FreeBlock * freeLists[NB_CLASSES];
+        ThreadAllocator::Counters counters;
+    };
+
+    thread_local ThreadCache t_cache;
+
+    // Set once the cache of the thread is gone, the blocks freed by the
+    // thread_local and static destructors running after it are not cached
+    thread_local bool t_cacheDestroyed = false;
+
+    std::size_t getClassSize(uint32_t c)
+    {
+        return std::size_t(1) << (c + MIN_CLASS_SHIFT);
+    }
+
+    uint32_t getSizeClass(std::size_t size)
+    {
+        uint32_t c = 0;
+        while(c < NB_CLASSES && getClassSize(c) < size) ++c;
+        return c;
+    }
+
+    ThreadCache::ThreadCache()
+        : freeLists()
+        , counters()
+    {
+
+    }
+
+    ThreadCache::~ThreadCache()
+    {
+        this->release();
+        t_cacheDestroyed = true;
+    }
+
+    void ThreadCache::release()
+    {
+        for(uint32_t c = 0; c < NB_CLASSES; ++c)
+        {
+            while(freeLists[c])
+            {
+                FreeBlock * block = freeLists[c];
+                freeLists[c] = block->next;
+                std::free(reinterpret_cast<char *>(block) - HEADER_SIZE);
+                ++counters.systemFrees;
+            }
+        }
+        counters.cachedBytes = 0;
+    }
+}
+
+std::size_t const ThreadAllocator::DEFAULT_CACHE_LIMIT;
+std::size_t const ThreadAllocator::MAX_CACHED_SIZE;
+
+void * ThreadAllocator::allocate(std::size_t size)
+{
+    static_assert(sizeof(Header) <= HEADER_SIZE, "Header does not fit");
+
+    uint32_t const c = getSizeClass(size);
+    std::size_t const blockSize = c == NO_CLASS ? size : getClassSize(c);
+
+    if(!t_cacheDestroyed)
+    {
+        ThreadCache & cache = t_cache;
+        ++cache.counters.allocations;
+
+        if(c != NO_CLASS && cache.freeLists[c])
+        {
+            FreeBlock * block = cache.freeLists[c];
+            cache.freeLists[c] = block->next;
+            ++cache.counters.cacheHits;
+            cache.counters.cachedBytes -= blockSize;
+            return block;
+        }
+
+        ++cache.counters.systemAllocations;
+    }
+
+    char * memory = static_cast<char *>(std::malloc(HEADER_SIZE + blockSize));
+    assert(memory && "Out of memory");
+
+    if(g_firstTouch.load(std::memory_order_relaxed))
+    {
+        std::memset(memory, 0, HEADER_SIZE + blockSize);
+    }
+
+    reinterpret_cast<Header *>(memory)->sizeClass = c;
+    return memory + HEADER_SIZE;
+}
+
+void ThreadAllocator::deallocate(void * p)
+{
+    if(!p) return;
+
+    char * memory = static_cast<char *>(p) - HEADER_SIZE;
+    uint32_t const c = reinterpret_cast<Header *>(memory)->sizeClass;
+
+    if(t_cacheDestroyed)
+    {
+        std::free(memory);
+        return;
+    }
+
+    ThreadCache & cache = t_cache;
+    if(c == NO_CLASS || cache.counters.cachedBytes + getClassSize(c) > g_cacheLimit.load(std::memory_order_relaxed))
+    {
+        std::free(memory);
+        ++cache.counters.systemFrees;
+        return;
+    }
+
+    FreeBlock * block = static_cast<FreeBlock *>(p);
+    block->next = cache.freeLists[c];
+    cache.freeLists[c] = block;
+    cache.counters.cachedBytes += getClassSize(c);
+}
+
+void ThreadAllocator::setCacheLimit(std::size_t bytes)
+{
+    g_cacheLimit.store(bytes, std::memory_order_relaxed);
+}
+
+std::size_t ThreadAllocator::getCacheLimit()
+{
+    return g_cacheLimit.load(std::memory_order_relaxed);
+}
+
+void ThreadAllocator::setFirstTouch(bool enabled)
+{
+    g_firstTouch.store(enabled, std::memory_order_relaxed);
+}
+
+bool ThreadAllocator::getFirstTouch()
+{
+    return g_firstTouch.load(std::memory_order_relaxed);
+}
+
+ThreadAllocator::Counters ThreadAllocator::getThreadCounters()
+{
+    return t_cacheDestroyed ? Counters() : t_cache.counters;
+}
+
+void ThreadAllocator::releaseThreadCache()
+{
+    if(!t_cacheDestroyed) t_cache.release();
+}
+
+/// Box2D hooks ///
+// These replace the whole b2Settings.cpp of the Box2D library, so that
+// its object is never linked in: b2_version and b2Log come along.
+
+b2Version b2_version = {2, 3, 1};
+
+void * b2Alloc(int32 size)
+{
+    return ThreadAllocator::allocate(static_cast<std::size_t>(size));
+}
+
+void b2Free(void * mem)
+{
+    ThreadAllocator::deallocate(mem);
+}
+
+void b2Log(char const * string, ...)
+{
+    va_list args;
+    va_start(args, string);
+    std::vprintf(string, args);
+    va_end(args);
+}
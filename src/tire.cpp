@@ -3,35 +3,18 @@
 #include <cassert>
 
 Tire::Tire(b2Vec2 const & initPos, float32 initAngle, float32 w, float32 h, bool motor)
-    : m_width(w)
+    : m_initPos(initPos)
+    , m_initAngle(initAngle)
+    , m_width(w)
     , m_height(h)
     , m_motor(motor)
+    , m_recyclable(false)
 {
     #if CAR_PHYSICS_GRAPHIC_MODE_SFML
     m_color = sf::Color(0, 255, 0, 128);
     #endif
 
-    m_bodyDef.type = b2_dynamicBody;
-    m_bodyDef.position.Set(initPos.x, initPos.y);
-    m_bodyDef.angle = initAngle;
-
-    float32 halfWidth  = m_width / 2.0f;
-    float32 halfHeight = m_height / 2.0f;
-
-    m_shape.SetAsBox(halfWidth, halfHeight);
-
-    m_fixtureDef.shape = &m_shape;
-    m_fixtureDef.density = 1.0f;
-    m_fixtureDef.friction = 0.3f;
-
-    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
-    // Creating vertices in CCW order
-    m_vertices.reserve(4);
-    m_vertices.push_back(std::make_pair(+halfWidth, -halfHeight));
-    m_vertices.push_back(std::make_pair(-halfWidth, -halfHeight));
-    m_vertices.push_back(std::make_pair(-halfWidth, +halfHeight));
-    m_vertices.push_back(std::make_pair(+halfWidth, +halfHeight));
-    #endif
+    this->reshape(m_width, m_height);
 }
 
 Tire::~Tire()
@@ -45,13 +28,18 @@ void Tire::accelerate(float32 power) const
 
     if(this->hasMotor())
     {
-        b2Vec2 direction = m_body->GetWorldVector(b2Vec2(0, 1));
-        direction.Normalize();
-        direction *= power;
-        m_body->ApplyForceToCenter(direction, true);
+        Tire::applyAcceleration(m_body, power);
     }
 }
 
+void Tire::applyAcceleration(b2Body * body, float32 power)
+{
+    b2Vec2 direction = body->GetWorldVector(b2Vec2(0, 1));
+    direction.Normalize();
+    direction *= power;
+    body->ApplyForceToCenter(direction, true);
+}
+
 void Tire::attachJointAsB(b2JointDef & jointDef)
 {
     jointDef.bodyB = m_body;
@@ -70,17 +58,29 @@ void Tire::setMotor(bool motor)
 void Tire::simulateFriction()
 {
     assert(m_body && "Tire has no body");
+    Tire::applyFriction(m_body);
+}
 
+void Tire::sleep()
+{
+    assert(m_body && "Tire has no body");
+    m_body->SetAwake(false);
+}
+
+void Tire::applyFriction(b2Body * body)
+{
     // Keep only the forward velocity to remove drifting lateraly
-    b2Vec2 forVel = this->getForwardVelocity();
-    m_body->SetLinearVelocity(forVel);
+    b2Vec2 forward = body->GetWorldVector(b2Vec2(0, 1));
+    forward.Normalize();
+    b2Vec2 forVel = b2Dot(body->GetLinearVelocity(), forward) * forward;
+    body->SetLinearVelocity(forVel);
 
     // Simulate drag by applying impulse in direction opposing to movement
     // Impulse is proportional to velocity squared
-    b2Vec2 drag = m_body->GetLinearVelocity();
+    b2Vec2 drag = body->GetLinearVelocity();
     drag *= 0.0005 * drag.Length();
     drag = -drag;
-    m_body->ApplyLinearImpulse(drag, m_body->GetWorldCenter(), true);
+    body->ApplyLinearImpulse(drag, body->GetWorldCenter(), true);
 }
 
 b2Vec2 Tire::getForwardVelocity() const
@@ -98,3 +98,59 @@ b2Vec2 Tire::getLateralVelocity() const
     right.Normalize();
     return b2Dot(m_body->GetLinearVelocity(), right) * right;
 }
+
+void Tire::reshape(float32 w, float32 h)
+{
+    m_width = w;
+    m_height = h;
+
+    float32 halfWidth  = m_width / 2.0f;
+    float32 halfHeight = m_height / 2.0f;
+
+    if(m_body)
+    {
+        b2Fixture * fixture = m_body->GetFixtureList();
+        assert(fixture && "Tire has no fixture");
+        static_cast<b2PolygonShape *>(fixture->GetShape())->SetAsBox(halfWidth, halfHeight);
+        m_body->ResetMassData();
+    }
+
+    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+    // Vertices in CCW order
+    m_vertices.clear();
+    m_vertices.push_back(std::make_pair(+halfWidth, -halfHeight));
+    m_vertices.push_back(std::make_pair(-halfWidth, -halfHeight));
+    m_vertices.push_back(std::make_pair(-halfWidth, +halfHeight));
+    m_vertices.push_back(std::make_pair(+halfWidth, +halfHeight));
+    #endif
+}
+
+void Tire::setRecyclable(bool recyclable)
+{
+    m_recyclable = recyclable;
+}
+
+void Tire::rearm(b2Vec2 const & pos, float32 angle)
+{
+    assert(m_body && "Tire has no body");
+    assert(m_recyclable && "Tire is not recyclable");
+
+    m_initPos = pos;
+    m_initAngle = angle;
+    this->resetBody(pos, angle);
+}
+
+void Tire::define(DrawableDef & def) const
+{
+    Drawable::define(def);
+
+    def.body.type = b2_dynamicBody;
+    def.body.position = m_initPos;
+    def.body.angle = m_initAngle;
+    def.shape.SetAsBox(m_width / 2.0f, m_height / 2.0f);
+}
+
+bool Tire::recycle()
+{
+    return m_recyclable;
+}
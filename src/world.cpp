@@ -3,46 +3,277 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <ctime>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <random>
-#include <thread>
 
 #if CAR_PHYSICS_GRAPHIC_MODE_SFML
 #include <renderer.hpp>
 #endif
 
+#include <carfleet.hpp>
+#include <clock.hpp>
 #include <drawable.hpp>
-#include <raycastcallback.hpp>
+#include <rayfan.hpp>
+#include <sensortable.hpp>
+#include <sensortracker.hpp>
+#include <snapshot.hpp>
 #include <staticbox.hpp>
+#include <threadallocator.hpp>
 
 
+namespace
+{
+    // Below this number of drawables, threads cost more than they save
+    int32_t const PARALLEL_SENSE_THRESHOLD = 64;
+
+    // Keeps track of the clip of a ray cast, to go on with the same ray in
+    // another tree
+    class ClipTracker : public b2RayCastCallback
+    {
+    public:
+        explicit ClipTracker(b2RayCastCallback * callback)
+            : callback(callback)
+            , maxFraction(1.0f)
+            , terminated(false)
+        {
+
+        }
+
+        float32 ReportFixture(b2Fixture * f, b2Vec2 const & point, b2Vec2 const & normal, float32 fraction) override
+        {
+            float32 value = callback->ReportFixture(f, point, normal, fraction);
+
+            if(value < 0.0f)       return value;
+            else if(value > 0.0f)  maxFraction = value;
+            else                   terminated = true;
+
+            return value;
+        }
+
+        b2RayCastCallback * callback;
+        float32 maxFraction;
+        bool terminated;
+    };
+
+    // Overlap of a shape with the static tree primitives
+    class OverlapQuery
+    {
+    public:
+        OverlapQuery(b2Shape const * shape, int32 childIndex, b2Transform const & xf)
+            : shape(shape)
+            , childIndex(childIndex)
+            , xf(xf)
+            , overlap(false)
+        {
+
+        }
+
+        bool QueryFixture(b2Fixture * fixture, int32 index)
+        {
+            overlap = b2TestOverlap(
+                shape, childIndex, fixture->GetShape(), index, xf, fixture->GetBody()->GetTransform()
+            );
+            return !overlap;
+        }
+
+        b2Shape const * shape;
+        int32 childIndex;
+        b2Transform xf;
+        bool overlap;
+    };
+
+    // Overlap of a shape with the fixtures of the broad-phase. The query
+    // reports fixtures, not children: all of them are tested.
+    class FixtureOverlapQuery : public b2QueryCallback
+    {
+    public:
+        FixtureOverlapQuery(b2Shape const * shape, b2Transform const & xf)
+            : shape(shape)
+            , xf(xf)
+            , overlap(false)
+        {
+
+        }
+
+        bool ReportFixture(b2Fixture * fixture) override
+        {
+            if(fixture->IsSensor()) return true;
+
+            b2Shape const * other = fixture->GetShape();
+            b2Transform const & otherXf = fixture->GetBody()->GetTransform();
+            for(int32 c = 0; c < other->GetChildCount() && !overlap; ++c)
+            {
+                overlap = b2TestOverlap(shape, 0, other, c, xf, otherXf);
+            }
+            return !overlap;
+        }
+
+        b2Shape const * shape;
+        b2Transform xf;
+        bool overlap;
+    };
+
+    // Chassis then tires of a car at its initial pose, as Car::setBody
+    // creates them
+    struct CarShapes
+    {
+        static uint32_t const NB_SHAPES = 5;
+
+        explicit CarShapes(CarDef const & def)
+        {
+            shapes[0].SetAsBox(def.width / 2.0f, def.height / 2.0f);
+            transforms[0].Set(def.initPos, def.initAngle);
+
+            for(uint32_t t = 0; t < 4; ++t)
+            {
+                shapes[t + 1].SetAsBox(def.width / 8.0f, def.height / 8.0f);
+                transforms[t + 1].Set(Car::getTireInitPos(def, t / 2, t % 2), def.initAngle);
+            }
+
+            shapes[0].ComputeAABB(&aabb, transforms[0], 0);
+            for(uint32_t s = 1; s < NB_SHAPES; ++s)
+            {
+                b2AABB box;
+                shapes[s].ComputeAABB(&box, transforms[s], 0);
+                aabb.Combine(box);
+            }
+        }
+
+        bool overlaps(CarShapes const & other) const
+        {
+            if(!b2TestOverlap(aabb, other.aabb)) return false;
+
+            for(uint32_t a = 0; a < NB_SHAPES; ++a)
+            {
+                for(uint32_t b = 0; b < NB_SHAPES; ++b)
+                {
+                    if(b2TestOverlap(&shapes[a], 0, &other.shapes[b], 0, transforms[a], other.transforms[b]))
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        b2PolygonShape shapes[NB_SHAPES];
+        b2Transform transforms[NB_SHAPES];
+        b2AABB aabb;
+    };
+
+    // Overlap of a car with the ones already placed, proxies of a b2DynamicTree
+    class PlacedCarsQuery
+    {
+    public:
+        PlacedCarsQuery(b2DynamicTree const & tree, CarShapes const & car)
+            : tree(tree)
+            , car(car)
+            , overlap(false)
+        {
+
+        }
+
+        bool QueryCallback(int32 proxyId)
+        {
+            overlap = car.overlaps(*static_cast<CarShapes const *>(tree.GetUserData(proxyId)));
+            return !overlap;
+        }
+
+        b2DynamicTree const & tree;
+        CarShapes const & car;
+        bool overlap;
+    };
+
+    std::once_flag contactRegistersFlag;
+
+    // Box2D fills its table of contact types (b2Contact::s_registers) the
+    // first time a contact is created, without any lock: worlds stepped in
+    // parallel would race on it. One contact created here, once, fills it.
+    void initializeContactRegisters()
+    {
+        std::unique_ptr<b2World> world(new b2World(b2Vec2(0.0f, 0.0f)));
+
+        b2CircleShape circle;
+        circle.m_radius = 1.0f;
+
+        b2BodyDef bodyDef;
+        world->CreateBody(&bodyDef)->CreateFixture(&circle, 0.0f);
+        bodyDef.type = b2_dynamicBody;
+        world->CreateBody(&bodyDef)->CreateFixture(&circle, 1.0f);
+
+        world->Step(0.01f, 1, 1);
+        assert(world->GetContactCount() == 1 && "No contact created");
+    }
+}
+
 #if CAR_PHYSICS_GRAPHIC_MODE_SFML
 World::World(
     int32 vIter, int32 pIter, Renderer* r, uint32_t simulationRate, uint32_t frameRate
 )
-    : m_world(nullptr)
+    : m_arena(std::make_shared<Arena>())
+    , m_world(nullptr)
     , m_velocityIterations(vIter)
     , m_positionIterations(pIter)
     , m_simulationRate(simulationRate)
     , m_drawableList()
     , m_requiredDrawables()
+    , m_fleetList()
+    , m_requiredFleets()
+    , m_staticTree()
+    , m_bakedBodies()
+    , m_deactivateBaked(false)
+    , m_distanceField()
+    , m_distanceFieldCellSize(0.0f)
+    , m_sensorTable()
+    , m_sensorTracking(false)
+    , m_stats()
+    , m_destructionQueue()
+    , m_keepDeadBodies(false)
+    , m_drawableHistory()
     , m_renderer(r)
     , m_frameRate(frameRate)
 {
+    // Before any world of any thread steps
+    std::call_once(contactRegistersFlag, initializeContactRegisters);
+
+    // The stack allocator of the b2World is part of it
     b2Vec2 gravity(0.0f, 0.0f);
-    m_world = new b2World(gravity);
+    m_world = new (ThreadAllocator::allocate(sizeof(b2World))) b2World(gravity);
 }
 #else
 World::World(int32 vIter, int32 pIter, uint32_t simulationRate)
-    : m_world(nullptr)
+    : m_arena(std::make_shared<Arena>())
+    , m_world(nullptr)
     , m_velocityIterations(vIter)
     , m_positionIterations(pIter)
     , m_simulationRate(simulationRate)
     , m_drawableList()
     , m_requiredDrawables()
+    , m_fleetList()
+    , m_requiredFleets()
+    , m_staticTree()
+    , m_bakedBodies()
+    , m_deactivateBaked(false)
+    , m_distanceField()
+    , m_distanceFieldCellSize(0.0f)
+    , m_sensorTable()
+    , m_sensorTracking(false)
+    , m_stats()
+    , m_destructionQueue()
+    , m_keepDeadBodies(false)
+    , m_drawableHistory()
 {
+    // Before any world of any thread steps
+    std::call_once(contactRegistersFlag, initializeContactRegisters);
+
+    // The stack allocator of the b2World is part of it
     b2Vec2 gravity(0.0f, 0.0f);
-    m_world = new b2World(gravity);
+    m_world = new (ThreadAllocator::allocate(sizeof(b2World))) b2World(gravity);
 }
 #endif // CAR_PHYSICS_GRAPHIC_MODE_SFML
 
@@ -50,23 +281,38 @@ World::~World()
 {
     assert(m_world && "m_world is null");
 
-    for(auto d: m_drawableList)
+    // Dead drawables kept for snapshots are only in the history
+    for(auto d: m_keepDeadBodies ? m_drawableHistory : m_drawableList)
     {
         assert(d && "Drawable is null");
         d->onRemoveFromWorld(m_world);
     }
     m_drawableList.clear();
+    m_drawableHistory.clear();
 
     m_requiredDrawables.clear();
 
-    delete m_world;
+    for(auto f: m_fleetList)
+    {
+        f->detach();
+    }
+    m_fleetList.clear();
+    m_requiredFleets.clear();
+
+    m_world->~b2World();
+    ThreadAllocator::deallocate(m_world);
 }
 
 void World::addDrawable(std::shared_ptr<Drawable> drawable)
 {
     assert(drawable && "Drawable is null");
-    drawable->setBody(m_world->CreateBody(drawable->getBodyDef()), this);
+    drawable->setBody(drawable->createBody(m_world), this);
     m_drawableList.push_back(drawable);
+
+    if(m_keepDeadBodies)
+    {
+        m_drawableHistory.push_back(drawable);
+    }
 }
 
 void World::addRequiredDrawable(std::shared_ptr<Drawable> drawable)
@@ -77,32 +323,141 @@ void World::addRequiredDrawable(std::shared_ptr<Drawable> drawable)
 }
 
 
+void World::addRecycledDrawable(std::shared_ptr<Drawable> drawable, bool required)
+{
+    assert(drawable && "Drawable is null");
+    assert(drawable->getBody() && drawable->getBody()->IsActive() && "Drawable was not reactivated");
+
+    drawable->setMarkedForDeath(false);
+    if(required) m_requiredDrawables.push_back(drawable);
+    m_drawableList.push_back(drawable);
+
+    if(m_keepDeadBodies)
+    {
+        m_drawableHistory.push_back(drawable);
+    }
+}
+
+void World::addFleet(std::shared_ptr<CarFleet> fleet, bool required)
+{
+    assert(fleet && "Fleet is null");
+    fleet->attach(m_world);
+    fleet->m_keepDeadBodies = m_keepDeadBodies;
+    m_fleetList.push_back(fleet);
+    if(required)
+    {
+        m_requiredFleets.push_back(fleet);
+    }
+}
+
 void World::removeDrawables()
 {
     assert(m_world && "World is null");
 
-    auto it = std::remove_if(
-        m_drawableList.begin(),
-        m_drawableList.end(),
-        [](std::shared_ptr<Drawable> d){return d->isMarkedForDeath();}
-    );
+    CAR_PHYSICS_SCOPED_TIMER(&m_stats, Stats::REMOVE_DRAWABLES);
 
-    while(it != m_drawableList.end())
+    // One compaction pass: live drawables move down in order, dead ones
+    // go to the destruction queue
+    std::size_t nbAlive = 0;
+    for(std::size_t i = 0; i < m_drawableList.size(); ++i)
     {
-        (*it)->onRemoveFromWorld(m_world);
-        m_drawableList.erase(it);
+        std::shared_ptr<Drawable> & d = m_drawableList[i];
+        assert(d && "Drawable is null");
+
+        if(d->isMarkedForDeath())
+        {
+            m_destructionQueue.push_back(std::move(d));
+        }
+        else
+        {
+            if(nbAlive != i) m_drawableList[nbAlive] = std::move(d);
+            ++nbAlive;
+        }
     }
+    m_drawableList.resize(nbAlive);
 
-    auto it2 = std::remove_if(
-        m_requiredDrawables.begin(),
-        m_requiredDrawables.end(),
-        [](std::shared_ptr<Drawable> d){return d->isMarkedForDeath();}
-    );
+    if(m_destructionQueue.empty()) return;
+
+    CAR_PHYSICS_COUNT(&m_stats, Stats::REMOVED_DRAWABLES, m_destructionQueue.size());
 
-    while(it2 != m_requiredDrawables.end())
+    nbAlive = 0;
+    for(std::size_t i = 0; i < m_requiredDrawables.size(); ++i)
     {
-        m_requiredDrawables.erase(it2);
+        if(m_requiredDrawables[i]->isMarkedForDeath()) continue;
+
+        if(nbAlive != i) m_requiredDrawables[nbAlive] = std::move(m_requiredDrawables[i]);
+        ++nbAlive;
     }
+    m_requiredDrawables.resize(nbAlive);
+
+    this->destroyQueuedBodies(m_keepDeadBodies);
+}
+
+void World::destroyQueuedBodies(bool keepBodies)
+{
+    if(keepBodies)
+    {
+        for(auto const & d: m_destructionQueue)
+        {
+            d->getBody()->SetActive(false);
+        }
+        m_destructionQueue.clear();
+        return;
+    }
+
+    // Pooled drawables only leave the broad-phase
+    std::size_t nbDestroyed = 0;
+    for(std::size_t i = 0; i < m_destructionQueue.size(); ++i)
+    {
+        std::shared_ptr<Drawable> & d = m_destructionQueue[i];
+        if(d->recycle())
+        {
+            d->getBody()->SetActive(false);
+        }
+        else
+        {
+            if(nbDestroyed != i) m_destructionQueue[nbDestroyed] = std::move(d);
+            ++nbDestroyed;
+        }
+    }
+    m_destructionQueue.resize(nbDestroyed);
+
+    if(m_destructionQueue.empty()) return;
+
+    // Baked bodies leave the static tree, rebuilt once for the whole batch
+    std::vector<b2Body *> unbaked;
+    for(auto const & d: m_destructionQueue)
+    {
+        if(this->isBaked(d->getBody())) unbaked.push_back(d->getBody());
+    }
+
+    if(!unbaked.empty())
+    {
+        std::sort(unbaked.begin(), unbaked.end(), std::less<b2Body *>());
+
+        auto isUnbaked = [&unbaked](b2Body * b)
+        {
+            return std::binary_search(unbaked.begin(), unbaked.end(), b, std::less<b2Body *>());
+        };
+
+        m_bakedBodies.erase(
+            std::remove_if(m_bakedBodies.begin(), m_bakedBodies.end(), isUnbaked),
+            m_bakedBodies.end()
+        );
+    }
+
+    // Each destroyed proxy is searched in the broad-phase move buffer.
+    // Proxies created since the last step are still in there: finding their
+    // pairs now, as the next step would, keeps the batch linear.
+    m_world->GetContactManager().FindNewContacts();
+
+    for(auto const & d: m_destructionQueue)
+    {
+        d->onRemoveFromWorld(m_world);
+    }
+    m_destructionQueue.clear();
+
+    if(!unbaked.empty()) this->buildStaticTree();
 }
 
 b2Joint * World::createJoint(b2RevoluteJointDef* jointDef)
@@ -111,10 +466,236 @@ b2Joint * World::createJoint(b2RevoluteJointDef* jointDef)
     return m_world->CreateJoint(jointDef);
 }
 
-void World::rayCast(RaycastCallback * cb, b2Vec2 const & p1, b2Vec2 const & p2) const
+void World::rayCast(b2RayCastCallback * cb, b2Vec2 const & p1, b2Vec2 const & p2) const
 {
     assert(m_world && "World is null");
-    m_world->RayCast(cb, p1, p2);
+
+    // Baked bodies still in the broad-phase are cast there
+    if(m_staticTree.empty() || !m_deactivateBaked)
+    {
+        m_world->RayCast(cb, p1, p2);
+        return;
+    }
+
+    ClipTracker tracker(cb);
+    m_world->RayCast(&tracker, p1, p2);
+    if(tracker.terminated) return;
+
+    b2RayCastInput input;
+    input.p1 = p1;
+    input.p2 = p2;
+    input.maxFraction = tracker.maxFraction;
+    m_staticTree.rayCast(cb, input);
+}
+
+void World::rayCast(RayFan * fan) const
+{
+    assert(m_world && "World is null");
+    assert(fan && "RayFan is null");
+
+    // Baked bodies still in the broad-phase are cast there, unless the
+    // distance field saves the walk of their tree
+    if(!m_deactivateBaked && m_distanceField.empty())
+    {
+        fan->cast(m_world);
+        return;
+    }
+
+    fan->cast(m_world, this->getActiveBakedBodies());
+    this->castStaticGeometry(fan);
+}
+
+void World::rayCast(RayFan * fan, float32 angle) const
+{
+    assert(m_world && "World is null");
+    assert(fan && "RayFan is null");
+
+    if(!m_sensorTable || !m_sensorTable->contains(fan->getOrigin()))
+    {
+        this->rayCast(fan);
+        return;
+    }
+
+    // The other cars, and the static bodies left out of the tree
+    fan->cast(m_world, this->getActiveBakedBodies());
+    fan->lookUp(m_sensorTable.get(), angle);
+}
+
+void World::rayCast(RayFan * fan, SensorTracker * tracker) const
+{
+    assert(m_world && "World is null");
+    assert(fan && "RayFan is null");
+    assert(tracker && "SensorTracker is null");
+
+    if(!m_sensorTracking || m_staticTree.empty())
+    {
+        this->rayCast(fan);
+        return;
+    }
+
+    // Static geometry first, so that the hits kept are static ones
+    uint32_t nbHinted = 0;
+    uint32_t nbHits = 0;
+    if(tracker->isValid(&m_staticTree, fan->size()))
+    {
+        fan->castHints(*tracker, nbHinted, nbHits);
+    }
+
+    this->castStaticGeometry(fan);
+    tracker->record(*fan, &m_staticTree);
+
+    tracker->count(nbHinted, nbHits);
+    CAR_PHYSICS_COUNT(this->getRecorder(), Stats::HINTED_RAYS, nbHinted);
+    CAR_PHYSICS_COUNT(this->getRecorder(), Stats::HINT_HITS, nbHits);
+
+    fan->cast(m_world, this->getActiveBakedBodies());
+}
+
+void World::bakeStaticGeometry(bool deactivate)
+{
+    assert(m_world && "World is null");
+    assert(!m_world->IsLocked() && "Baking during a step");
+    assert((m_bakedBodies.empty() || deactivate == m_deactivateBaked) && "Baked bodies are deactivated or not, all of them");
+
+    m_deactivateBaked = deactivate;
+
+    std::vector<b2Body *> baked;
+    for(b2Body * b = m_world->GetBodyList(); b; b = b->GetNext())
+    {
+        if(b->GetType() == b2_staticBody && b->IsActive() && b->GetFixtureList() && !this->isBaked(b))
+        {
+            baked.push_back(b);
+        }
+    }
+
+    for(auto b: baked)
+    {
+        // Removes its proxies from the broad-phase, and its contacts
+        if(deactivate) b->SetActive(false);
+        m_bakedBodies.push_back(b);
+    }
+
+    std::sort(m_bakedBodies.begin(), m_bakedBodies.end(), std::less<b2Body *>());
+    this->buildStaticTree();
+}
+
+bool World::isBaked(b2Body const * body) const
+{
+    return std::binary_search(
+        m_bakedBodies.begin(), m_bakedBodies.end(), body, std::less<b2Body const *>()
+    );
+}
+
+std::vector<b2Body *> const * World::getActiveBakedBodies() const
+{
+    return m_deactivateBaked ? nullptr : &m_bakedBodies;
+}
+
+void World::castStaticGeometry(RayFan * fan) const
+{
+    if(!m_distanceField.empty())
+    {
+        fan->cast(&m_distanceField, &m_staticTree);
+    }
+    else if(!m_staticTree.empty())
+    {
+        fan->cast(&m_staticTree);
+    }
+}
+
+void World::buildStaticTree()
+{
+    std::vector<b2Fixture *> fixtures;
+    for(auto b: m_bakedBodies)
+    {
+        for(b2Fixture * f = b->GetFixtureList(); f; f = f->GetNext())
+        {
+            fixtures.push_back(f);
+        }
+    }
+
+    m_staticTree.build(fixtures);
+
+    // The field points into the tree, it is sampled again
+    if(m_distanceFieldCellSize > 0.0f)
+    {
+        m_distanceField.build(m_staticTree, m_distanceFieldCellSize);
+    }
+}
+
+void World::bakeDistanceField(float32 cellSize)
+{
+    assert(cellSize >= 0.0f && "Cell size must be positive");
+
+    m_distanceFieldCellSize = cellSize;
+
+    if(cellSize > 0.0f)
+    {
+        this->bakeStaticGeometry(m_deactivateBaked);
+    }
+    else
+    {
+        m_distanceField.clear();
+    }
+}
+
+DistanceField const & World::getDistanceField() const
+{
+    return m_distanceField;
+}
+
+void World::setSensorTracking(bool enabled)
+{
+    m_sensorTracking = enabled;
+}
+
+void World::setSensorTable(std::shared_ptr<SensorTable const> table)
+{
+    m_sensorTable = table;
+}
+
+SensorTable const * World::getSensorTable() const
+{
+    return m_sensorTable.get();
+}
+
+bool World::isStaticGeometryDeactivated() const
+{
+    return m_deactivateBaked && !m_bakedBodies.empty();
+}
+
+bool World::overlapsStaticGeometry(b2Body const * body) const
+{
+    assert(body && "b2Body is null");
+
+    if(m_staticTree.empty()) return false;
+
+    b2Transform const & xf = body->GetTransform();
+    for(b2Fixture const * f = body->GetFixtureList(); f; f = f->GetNext())
+    {
+        b2Shape const * shape = f->GetShape();
+        for(int32 c = 0; c < shape->GetChildCount(); ++c)
+        {
+            b2AABB aabb;
+            shape->ComputeAABB(&aabb, xf, c);
+
+            OverlapQuery query(shape, c, xf);
+            m_staticTree.query(&query, aabb);
+            if(query.overlap) return true;
+        }
+    }
+
+    return false;
+}
+
+Arena const & World::getArena() const
+{
+    return *m_arena;
+}
+
+StaticTree const & World::getStaticTree() const
+{
+    return m_staticTree;
 }
 
 void World::addBorders(uint32_t width, uint32_t height)
@@ -124,156 +705,431 @@ void World::addBorders(uint32_t width, uint32_t height)
     float32 w2 = w / 2.0f;
     float32 h2 = h / 2.0f;
 
-    std::shared_ptr<StaticBox> boxL = std::make_shared<StaticBox> (b2Vec2(0.0f, h2), 0.0f, 1.0f, h);
+    std::shared_ptr<StaticBox> boxL = this->create<StaticBox> (b2Vec2(0.0f, h2), 0.0f, 1.0f, h);
     addDrawable(boxL);
 
-    std::shared_ptr<StaticBox> boxU = std::make_shared<StaticBox>(b2Vec2(w2, 0.0f), 0.0f, w, 1.0f);
+    std::shared_ptr<StaticBox> boxU = this->create<StaticBox>(b2Vec2(w2, 0.0f), 0.0f, w, 1.0f);
     addDrawable(boxU);
 
-    std::shared_ptr<StaticBox> boxR = std::make_shared<StaticBox>(b2Vec2(w, h2), 0.0f, 1.0f, h);
+    std::shared_ptr<StaticBox> boxR = this->create<StaticBox>(b2Vec2(w, h2), 0.0f, 1.0f, h);
     addDrawable(boxR);
 
-    std::shared_ptr<StaticBox> boxD = std::make_shared<StaticBox>(b2Vec2(w2, h), 0.0f, w, 1.0f);
+    std::shared_ptr<StaticBox> boxD = this->create<StaticBox>(b2Vec2(w2, h), 0.0f, w, 1.0f);
     addDrawable(boxD);
 }
 
 void World::randomize(uint32_t width, uint32_t height, uint32_t nbObstacles, uint32_t seed)
 {
-    if(seed == 0)
+    ObstacleDef def;
+    def.width = width;
+    def.height = height;
+    def.count = nbObstacles;
+    def.seed = seed;
+
+    this->randomize(def);
+}
+
+ObstacleGenerator::Rejections World::randomize(ObstacleDef const & def)
+{
+    assert(m_world && "World is null");
+    assert(!m_world->IsLocked() && "Adding obstacles during a step");
+
+    ObstacleGenerator generator(def);
+    std::vector<ObstacleGenerator::Obstacle> const & obstacles = generator.generate();
+
+    m_drawableList.reserve(m_drawableList.size() + obstacles.size());
+    if(def.bake) m_bakedBodies.reserve(m_bakedBodies.size() + obstacles.size());
+
+    for(auto const & o: obstacles)
     {
-        seed = static_cast<uint32_t>(std::time(0));
-    }
+        std::shared_ptr<StaticBox> box = this->create<StaticBox>(o.position, o.angle, o.width, o.height);
 
-    std::mt19937 rng(seed);
+        if(!def.bake)
+        {
+            addDrawable(box);
+            continue;
+        }
 
-    std::uniform_int_distribution<uint32_t> heightDistribution(0, height);
-    std::uniform_int_distribution<uint32_t> widthDistribution(0, width);
-    std::uniform_int_distribution<uint32_t> angleDistribution(0, 359);
-    std::normal_distribution<float32> sizeDistribution(10.0, 5.0);
+        box->setBody(box->createBody(m_world, !m_deactivateBaked), this);
+        m_drawableList.push_back(box);
+        m_bakedBodies.push_back(box->getBody());
 
-    for(uint32_t i = 0; i < nbObstacles; ++i)
+        if(m_keepDeadBodies)
+        {
+            m_drawableHistory.push_back(box);
+        }
+    }
+
+    if(def.bake && !obstacles.empty())
     {
-        std::shared_ptr<StaticBox> box = std::make_shared<StaticBox>(
-            b2Vec2(widthDistribution(rng), heightDistribution(rng)),
-            angleDistribution(rng),
-            std::abs(sizeDistribution(rng)),
-            std::abs(sizeDistribution(rng))
-        );
-        addDrawable(box);
+        std::sort(m_bakedBodies.begin(), m_bakedBodies.end(), std::less<b2Body *>());
+        this->buildStaticTree();
     }
+
+    return generator.getRejections();
 }
 
-bool World::willCollide(std::shared_ptr<Drawable> d)
+bool World::overlaps(b2Shape const * shape, b2Transform const & xf) const
 {
-    assert(d && "Drawable is null");
+    assert(shape && "b2Shape is null");
     assert(m_world && "World is null");
-    addDrawable(d);
-    m_world->Step(m_simulationRate/1000.0, m_velocityIterations, m_positionIterations);
 
-    bool result = d->isColliding();
+    b2AABB aabb;
+    shape->ComputeAABB(&aabb, xf, 0);
+
+    // Dead bodies, and deactivated baked ones, are out of the broad-phase
+    FixtureOverlapQuery query(shape, xf);
+    m_world->QueryAABB(&query, aabb);
+    if(query.overlap) return true;
 
-    d->die(this);
-    this->removeDrawables();
-    d->setMarkedForDeath(false);
+    if(m_staticTree.empty() || !m_deactivateBaked) return false;
 
-    return result;
+    OverlapQuery staticQuery(shape, 0, xf);
+    m_staticTree.query(&staticQuery, aabb);
+    return staticQuery.overlap;
 }
 
-#if CAR_PHYSICS_GRAPHIC_MODE_SFML
-void World::run()
+bool World::isSpawnFree(CarDef const & def) const
 {
-    assert(m_world && "World is null");
-    assert(m_renderer && "Renderer is null");
+    CarShapes car(def);
+    for(uint32_t s = 0; s < CarShapes::NB_SHAPES; ++s)
+    {
+        if(this->overlaps(&car.shapes[s], car.transforms[s])) return false;
+    }
+    return true;
+}
+
+std::vector<CarDef> World::findSpawnPoses(
+    CarDef const & def, b2AABB const & area, uint32_t count, uint32_t seed, uint32_t maxTries
+) const
+{
+    if(seed == 0)
+    {
+        seed = static_cast<uint32_t>(std::time(0));
+    }
 
-    double timeAccumulator = 0.0;
-    double renderTimeAccumulator = 0.0;
-    double totalTime = 0.0;
-    auto oldTime = std::chrono::high_resolution_clock::now();
+    if(maxTries == 0)
+    {
+        maxTries = 100 * count;
+    }
 
-    bool stop = false;
+    std::mt19937 rng(seed);
 
-    while(!stop && m_requiredDrawables.size() > 0)
+    std::uniform_real_distribution<float32> xDistribution(area.lowerBound.x, area.upperBound.x);
+    std::uniform_real_distribution<float32> yDistribution(area.lowerBound.y, area.upperBound.y);
+    std::uniform_real_distribution<float32> angleDistribution(-b2_pi, b2_pi);
+
+    std::vector<CarDef> poses;
+    poses.reserve(count);
+
+    // Reserved: the tree refers to the placed cars by address
+    std::vector<CarShapes> placed;
+    placed.reserve(count);
+    b2DynamicTree placedTree;
+
+    CarDef candidate = def;
+    for(uint32_t t = 0; t < maxTries && poses.size() < count; ++t)
     {
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(currentTime - oldTime);
-        oldTime = currentTime;
+        candidate.initPos.Set(xDistribution(rng), yDistribution(rng));
+        candidate.initAngle = angleDistribution(rng);
 
-        int32_t timeDiff = duration.count();
-        timeAccumulator += timeDiff;
-        renderTimeAccumulator += timeDiff;
-        totalTime += timeDiff;
+        CarShapes car(candidate);
 
-        // Simulation
-        while(timeAccumulator >= m_simulationRate)
+        PlacedCarsQuery query(placedTree, car);
+        placedTree.Query(&query, car.aabb);
+        if(query.overlap) continue;
+
+        bool free = true;
+        for(uint32_t s = 0; s < CarShapes::NB_SHAPES && free; ++s)
+        {
+            free = !this->overlaps(&car.shapes[s], car.transforms[s]);
+        }
+        if(!free) continue;
+
+        placed.push_back(car);
+        placedTree.CreateProxy(car.aabb, &placed.back());
+        poses.push_back(candidate);
+    }
+
+    return poses;
+}
+
+void World::step()
+{
+    assert(m_world && "World is null");
+
+    {
+        CAR_PHYSICS_SCOPED_TIMER(&m_stats, Stats::STEP);
+
+        // Sense: read-only queries (raycasts, controllers), in parallel.
+        // Each drawable only writes its own state: results do not depend on
+        // the number of threads.
+        {
+            CAR_PHYSICS_SCOPED_TIMER(&m_stats, Stats::SENSE);
+
+            int32_t nbDrawables = static_cast<int32_t>(m_drawableList.size());
+
+            #pragma omp parallel for schedule(static) if(nbDrawables >= PARALLEL_SENSE_THRESHOLD)
+            for(int32_t i = 0; i < nbDrawables; ++i)
+            {
+                assert(m_drawableList[i] && "Drawable is null");
+                m_drawableList[i]->sense(this);
+            }
+
+            for(auto const & f: m_fleetList)
+            {
+                f->sense(this);
+            }
+        }
+
+        // Act: forces and world changes, serially in list order
         {
-            //std::cout << "updating: " << timeAccumulator << std::endl;
+            CAR_PHYSICS_SCOPED_TIMER(&m_stats, Stats::ACT);
 
-            // Update drawables
             for(auto it = m_drawableList.begin(); it != m_drawableList.end(); ++it)
             {
                 assert((*it) && "Drawable is null");
-               (*it)->update(this);
+               (*it)->act(this);
+            }
+
+            for(auto const & f: m_fleetList)
+            {
+                f->act(this);
             }
+        }
+
+        // Remove the one marked for death
+        this->removeDrawables();
 
-            // Remove the one marked for death
-            this->removeDrawables();
+        // Simulate one step of physics
+        {
+            CAR_PHYSICS_SCOPED_TIMER(&m_stats, Stats::PHYSICS);
 
-            // Simulate one step of physics
             double sr = static_cast<double>(m_simulationRate) / 1000.0;
             m_world->Step(sr, m_velocityIterations, m_positionIterations);
-
-            timeAccumulator -= m_simulationRate;
         }
+    }
+
+    #if CAR_PHYSICS_STATS
+    m_stats.endStep(m_world->GetProfile());
+    #endif
+}
+
+uint32_t World::simulate(uint32_t maxSteps)
+{
+    FixedStepsClock clock(maxSteps);
+    return static_cast<uint32_t>(this->run(clock));
+}
 
-        // Rendering
-        while(renderTimeAccumulator >= m_frameRate)
+b2Profile const & World::getProfile() const
+{
+    assert(m_world && "World is null");
+    return m_world->GetProfile();
+}
+
+void World::setParallelIslands(bool enabled)
+{
+    assert(m_world && "World is null");
+    m_world->SetParallelIslands(enabled);
+}
+
+void World::setWideContactSolver(bool enabled)
+{
+    assert(m_world && "World is null");
+    m_world->SetWideContactSolver(enabled);
+}
+
+Stats const & World::stats() const
+{
+    return m_stats;
+}
+
+void World::resetStats()
+{
+    m_stats.clear();
+}
+
+Stats * World::getRecorder() const
+{
+    return &m_stats;
+}
+
+bool World::isRunning() const
+{
+    for(auto const & d: m_requiredDrawables)
+    {
+        if(!d->isSleeping()) return true;
+    }
+
+    for(auto const & f: m_requiredFleets)
+    {
+        if(f->getAliveCount() > f->getSleepingCount()) return true;
+    }
+    return false;
+}
+
+void World::snapshot(Snapshot & s)
+{
+    assert(m_world && "World is null");
+    assert(!m_world->IsLocked() && "Snapshot during a step");
+
+    if(!m_keepDeadBodies)
+    {
+        m_keepDeadBodies = true;
+        m_drawableHistory = m_drawableList;
+
+        for(auto const & f: m_fleetList)
         {
-            //std::cout << "rendering: " << renderTimeAccumulator << std::endl;
-            stop = !(m_renderer->update(m_drawableList));
-            renderTimeAccumulator -= m_frameRate;
+            f->m_keepDeadBodies = true;
+        }
+    }
 
-            // Consume remaining time: no need to render the same thing
-            while(renderTimeAccumulator >= m_frameRate)
-            {
-                renderTimeAccumulator -= m_frameRate;
-            }
+    s.clear();
+    s.m_world = this;
+    s.m_nbDrawables = m_drawableHistory.size();
+
+    // Which drawables of the history are alive (1) and required (2). The
+    // lists are in the history order.
+    auto alive = m_drawableList.begin();
+    auto required = m_requiredDrawables.begin();
+    for(auto const & d: m_drawableHistory)
+    {
+        uint8_t status = 0;
+        if(alive != m_drawableList.end() && *alive == d)
+        {
+            status = 1;
+            ++alive;
         }
+        if(required != m_requiredDrawables.end() && *required == d)
+        {
+            status = 2;
+            ++required;
+        }
+        s.write(status);
+    }
+    assert(alive == m_drawableList.end() && required == m_requiredDrawables.end());
 
-        // Sleep to free CPU
-        int32_t delay = std::min(
-            (m_frameRate - renderTimeAccumulator),
-            (m_simulationRate - timeAccumulator)
-        );
+    for(auto const & d: m_drawableList)
+    {
+        d->saveState(s);
+    }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+    s.write(static_cast<uint32_t>(m_fleetList.size()));
+    for(auto const & f: m_fleetList)
+    {
+        f->saveState(s);
     }
+
+    s.writeContacts(m_world);
 }
-#else
-void World::run()
+
+void World::restore(Snapshot const & s)
 {
     assert(m_world && "World is null");
+    assert(!m_world->IsLocked() && "Restore during a step");
+    assert(s.m_world == this && "Snapshot of another world");
+    assert(s.m_nbDrawables <= m_drawableHistory.size());
 
-    int32_t updateCount = 0;
-    while(updateCount < 5000 && m_requiredDrawables.size() > 0)
+    // Drawables added since the snapshot
+    for(std::size_t i = s.m_nbDrawables; i < m_drawableHistory.size(); ++i)
     {
-        // Simulation
+        m_destructionQueue.push_back(std::move(m_drawableHistory[i]));
+    }
+    m_drawableHistory.resize(s.m_nbDrawables);
+    this->destroyQueuedBodies(false);
+
+    std::size_t offset = 0;
 
-        for(auto it = m_drawableList.begin(); it != m_drawableList.end(); ++it)
+    m_drawableList.clear();
+    m_requiredDrawables.clear();
+    for(auto const & d: m_drawableHistory)
+    {
+        uint8_t status = 0;
+        s.read(offset, status);
+
+        b2Body * body = d->getBody();
+        assert(body && "Drawable body was destroyed");
+
+        // Deactivated baked bodies stay out of the broad-phase
+        bool active = status != 0 && !(m_deactivateBaked && this->isBaked(body));
+        if(body->IsActive() != active)
         {
-            assert((*it) && "Drawable is null");
-           (*it)->update(this);
+            body->SetActive(active);
         }
+        d->setMarkedForDeath(false);
 
-        // Remove the one marked for death
-        this->removeDrawables();
+        if(status != 0) m_drawableList.push_back(d);
+        if(status == 2) m_requiredDrawables.push_back(d);
+    }
 
-        // Simulate one step of physics
-        double sr = static_cast<double>(m_simulationRate) / 1000.0;
-        m_world->Step(sr, m_velocityIterations, m_positionIterations);
+    for(auto const & d: m_drawableList)
+    {
+        d->restoreState(s, offset);
+    }
+
+    uint32_t nbFleets = 0;
+    s.read(offset, nbFleets);
+    assert(nbFleets == m_fleetList.size() && "Fleets were added since the snapshot");
+    for(auto const & f: m_fleetList)
+    {
+        f->restoreState(s, offset);
+    }
+
+    assert(offset == s.m_buffer.size());
+
+    s.readContacts(m_world);
+}
+
+void World::run()
+{
+    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+    RealTimeClock clock;
+    #else
+    FixedStepsClock clock(5000);
+    #endif
+
+    this->run(clock);
+}
+
+uint64_t World::run(Clock & clock)
+{
+    assert(m_world && "World is null");
+
+    double const stepDuration = static_cast<double>(m_simulationRate) / 1000.0;
+    uint64_t stepCount = 0;
+    bool stop = false;
+
+    #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+    double const frameDuration = static_cast<double>(m_frameRate) / 1000.0;
+    auto lastFrameTime = std::chrono::steady_clock::now();
+    #endif
 
-        ++updateCount;
+    clock.start();
+
+    while(!stop && this->isRunning() && clock.keepRunning(*this, stepCount))
+    {
+        // Simulation
+        uint32_t nbSteps = clock.advance(stepDuration);
+        for(uint32_t i = 0; i < nbSteps && this->isRunning() && clock.keepRunning(*this, stepCount); ++i)
+        {
+            this->step();
+            ++stepCount;
+        }
 
-        //if(updateCount % 10 == 0) std::cout << updateCount << std::endl;
+        // Rendering, paced by the wall clock whatever the stepping policy
+        #if CAR_PHYSICS_GRAPHIC_MODE_SFML
+        if(m_renderer)
+        {
+            auto currentTime = std::chrono::steady_clock::now();
+            if(std::chrono::duration<double>(currentTime - lastFrameTime).count() >= frameDuration)
+            {
+                // Remaining time is dropped: no need to render the same thing
+                stop = !(m_renderer->update(m_drawableList, m_fleetList));
+                lastFrameTime = currentTime;
+            }
+        }
+        #endif
     }
+
+    return stepCount;
 }
-#endif // CAR_PHYSICS_GRAPHIC_MODE_SFML